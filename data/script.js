@@ -8,7 +8,7 @@ class Loco {
         this.address = address;
         this.speed = 0;
         this.direction = 0;
-        this.functions = Array(10).fill(false);
+        this.functions = Array(32).fill(false);
     }
 
     setSpeed(speed) {
@@ -22,6 +22,13 @@ class Loco {
     setFunction(index, state) {
         this.functions[index] = state;
     }
+
+    // Bit n of the bitmap is the state of Fn
+    setFunctions(bitmap) {
+        for (let i = 0; i < 32; i++) {
+            this.functions[i] = ((bitmap >>> i) & 1) === 1;
+        }
+    }
 }
 
 // Créer des instances de Loco pour chaque bouton image
@@ -30,6 +37,20 @@ document.querySelectorAll('.address-button').forEach(button => {
     locos[address] = new Loco(address);
 });
 
+// Les adresses de la configuration du réseau (config.bin) remplacent celles de la page
+fetch('/getLocos')
+    .then(response => response.json())
+    .then(config => {
+        const buttons = document.querySelectorAll('.address-button');
+        config.locos.forEach(([address, name], index) => {
+            if (index < buttons.length) {
+                buttons[index].setAttribute('data-address', address);
+                buttons[index].title = name;
+                locos[address] = new Loco(String(address));
+            }
+        });
+    });
+
 // Fonction pour mettre à jour l'affichage avec les valeurs de la locomotive sélectionnée
 function updateUI() {
     if (selectedLoco) {
@@ -59,6 +80,14 @@ function addLogMessage(message) {
     logWindow.textContent = message;  // Remplace le contenu du log par le nouveau message
 }
 
+// État de l'alimentation au chargement de la page, conservé par le contrôleur
+fetch('/getPower')
+    .then(response => response.text())
+    .then(state => {
+        isPowerOn = state === 'true';
+        document.getElementById('powerButton').classList.add(isPowerOn ? 'power-on' : 'power-off');
+    });
+
 // Gestionnaire d'événement pour le bouton d'alimentation
 document.getElementById('powerButton').addEventListener('click', () => {
     fetch('/setPower', { method: 'POST' })
@@ -150,6 +179,16 @@ document.querySelectorAll('.address-button').forEach(button => {
         // Mettre à jour l'interface utilisateur avec les valeurs de la locomotive sélectionnée
         updateUI();
         addLogMessage(`Locomotive selected with address ${address}`);
+        // Relire l'état des fonctions F0 à F31 connu du serveur, en une seule requête
+        const loco = selectedLoco;
+        fetch(`/getFunctions?address=${address}`)
+            .then(response => response.json())
+            .then(state => {
+                loco.setFunctions(state.functions);
+                if (loco === selectedLoco) {
+                    updateUI();
+                }
+            });
     });
 });
 
@@ -158,7 +197,8 @@ document.querySelectorAll('.function-button').forEach(button => {
         if (selectedLoco) {
             const functionId = button.getAttribute('data-function');
             const newState = !selectedLoco.functions[functionId];
-            fetch(`/setFunction?address=${selectedLoco.address}&function=${functionId}&power=${newState ? 1 : 0}`, { method: 'POST' })
+            const mask = (1 << functionId) >>> 0;
+            fetch(`/setFunctions?address=${selectedLoco.address}&mask=${mask}&values=${newState ? mask : 0}`, { method: 'POST' })
                 .then(() => {
                     selectedLoco.setFunction(functionId, newState);
                     if (newState) {
@@ -178,3 +218,18 @@ function updateSpeedValue(speed) {
     const percentage = (speed / 1000) * 100;
     speedValue.textContent = Math.round(percentage);
 }
+
+// Mesures de la Gleisbox (courant, tension, température), relues toutes les 2 s
+function updateTelemetry() {
+    fetch('/getTelemetry')
+        .then(response => response.json())
+        .then(channels => {
+            const telemetry = document.getElementById('telemetry');
+            telemetry.textContent = channels
+                .map(c => `${(c.latest / 1000).toFixed(2)} ${c.unit} (max ${(c.max / 1000).toFixed(2)})${c.alarm ? ' !' : ''}`)
+                .join(' | ');
+            telemetry.classList.toggle('alarm', channels.some(c => c.alarm));
+        })
+        .catch(() => {});
+}
+setInterval(updateTelemetry, 2000);
@@ -24,6 +24,7 @@
     power 1
     speed 16391 100
     function 16391 0 1
+    power 1; speed 0x4007 100; function 0x4007 0 1
 */
 
 #include "Config.h"
@@ -44,12 +45,34 @@ void setup()
   ctrl.begin();
 }
 
+char line[128];   // Line being received, without dynamic memory
+size_t length = 0;
+bool tooLong = false; // Line overflowed, discarded up to its end
+
 void loop()
 {
-  if (Serial.available())
+  while (Serial.available())
   {
-    String command = Serial.readStringUntil('\n');
-    Serial.println(command);
-    ctrl.handleUserCommands(command);
+    char c = Serial.read();
+    if (c == '\r')
+      continue;
+    if (c == '\n')
+    {
+      if (tooLong)
+        Serial.println(F("!!! Line too long, ignored"));
+      else
+      {
+        line[length] = '\0';
+        ctrl.queueUserCommands(line, &Serial); // Never blocks, errors are printed
+      }
+      length = 0;
+      tooLong = false;
+    }
+    else if (length < sizeof(line) - 1)
+      line[length++] = c;
+    else
+      tooLong = true; // Never run the start of a longer command
   }
+
+  ctrl.update(); // Executes the queued commands one by one
 }
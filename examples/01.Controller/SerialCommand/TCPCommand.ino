@@ -71,20 +71,41 @@ void setup()
   ctrl.begin();
 }
 
+char line[256];   // Line being received, without dynamic memory
+size_t length = 0;
+bool tooLong = false; // Line overflowed, discarded up to its end
+
 void loop()
 {
-  while (!client) // listen for incoming clients
+  if (!client) // listen for incoming clients
     client = server.available();
-  if (client.connected())
+  if (client && client.connected())
   {
-    if (client.available())
+    while (client.available())
     {
-      String command = client.readStringUntil('\n');
-
-      Serial.println(command);
-      ctrl.handleUserCommands(command);
+      char c = client.read();
+      if (c == '\r')
+        continue;
+      if (c == '\n')
+      {
+        if (tooLong)
+          client.println(F("!!! Line too long, ignored"));
+        else
+        {
+          line[length] = '\0';
+          ctrl.queueUserCommands(line, &client); // Never blocks, errors go back to the client
+        }
+        length = 0;
+        tooLong = false;
+      }
+      else if (length < sizeof(line) - 1)
+        line[length++] = c;
+      else
+        tooLong = true; // Never run the start of a longer command
     }
   }
+
+  ctrl.update(); // Executes the queued commands one by one
 }
 
 // if (!client.connected())
@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Block interlock on a simulated bus: three blocks in a line, a
+ * train waiting in the last one and a second train driving into the
+ * middle one, again and again. Each time the interlock stops it and
+ * the reaction and confirmation latencies are printed. Runs against
+ * TrackSimulator with loopback on, so no layout is needed; for a real
+ * layout set LOOPBACK to false, drop the simulator and the contact
+ * events, and give your own contacts and addresses. The same run is
+ * checked on the PC with: pio test -e native -f test_interlock -v
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackSimulator.h"
+#include "TrackInterlock.h"
+
+const uint16_t LOCO_1 = ADDR_MFX + 7; // Change with your own addresses
+const uint16_t LOCO_2 = ADDR_MM2 + 24;
+const uint16_t S88 = 0x0001;          // Device sending the contact events
+const uint16_t CONTACT_FIRST = 1;
+const uint16_t CONTACT_MIDDLE = 2;
+const uint16_t CONTACT_LAST = 3;
+const uint16_t RUNS = 100;
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 50; // ms
+const uint16_t HASH = 0xDF24; // Fixed, so begin() does not ping for a hash
+const bool LOOPBACK = true;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK);
+TrackSimulator gleisbox(ctrl);
+TrackInterlock interlock(ctrl);
+
+int8_t first, middle, last;
+
+/*
+ * Puts a contact event on the receive path, as an S88 module would.
+ */
+void contact(uint16_t number, uint8_t state)
+{
+  ctrl.injectMessage(FeedbackEvent::make(S88, number, state));
+  ctrl.update();
+}
+
+void printStats(const char *name, const TrackInterlockStats &stats)
+{
+  Serial.print(name);
+  Serial.print(stats.count);
+  Serial.print(" stops, min ");
+  Serial.print(stats.minimum);
+  Serial.print(" us, avg ");
+  Serial.print(stats.average);
+  Serial.print(" us, max ");
+  Serial.print(stats.maximum);
+  Serial.println(" us");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrl.begin();
+
+  last = interlock.addBlock(CONTACT_LAST);
+  middle = interlock.addBlock(CONTACT_MIDDLE, last);
+  first = interlock.addBlock(CONTACT_FIRST, middle);
+
+  interlock.setLoco(last, LOCO_2);
+  contact(CONTACT_LAST, 1);
+
+  for (uint16_t i = 0; i < RUNS; i++)
+  {
+    interlock.setLoco(first, LOCO_1);
+    interlock.setLoco(middle, 0);
+    contact(CONTACT_FIRST, 1);
+    ctrl.setLocoSpeed(LOCO_1, 400);
+    contact(CONTACT_MIDDLE, 1); // Stops LOCO_1, LOCO_2 is still in the last block
+    contact(CONTACT_FIRST, 0);
+    contact(CONTACT_MIDDLE, 0);
+  }
+
+  TrackInterlockStats stats;
+  Serial.println("\nRailuino interlock");
+  Serial.println("------------------------------------------------------------------");
+  if (interlock.getReaction(stats))
+    printStats("Reaction:     ", stats);
+  if (interlock.getConfirmation(stats))
+    printStats("Confirmation: ", stats);
+}
+
+void loop()
+{
+}
@@ -0,0 +1,85 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Ramps 32 locos up and down with TrackRamp and prints what one tick
+ * costs in CPU time and how many frames went out on the bus. The same
+ * measurement runs on the PC with: pio test -e native -f test_ramp -v
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackRamp.h"
+
+const uint16_t FIRST_LOCO = ADDR_MFX + 1; // Locos FIRST_LOCO to FIRST_LOCO + 31
+const uint8_t LOCOS = 32;
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 500; // ms
+const uint16_t HASH = 0x00;
+const bool LOOPBACK = false;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK); // Instance de la classe TrackController, création de l'objet ctrl.
+TrackRamp ramp(ctrl, 100, 8);                         // 100 ms tick, 8 frames per tick at most
+
+uint32_t maxTickMicros = 0;
+uint32_t lastReport = 0;
+bool up = true;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrl.begin();
+  Serial.println("Power on");
+  ctrl.setPower(true);
+
+  for (uint8_t i = 0; i < LOCOS; i++)
+  {
+    ramp.setRate(FIRST_LOCO + i, 100 + 10 * i, 300);
+    ramp.setTarget(FIRST_LOCO + i, 600);
+  }
+}
+
+void loop()
+{
+  ctrl.update();
+  ramp.update();
+
+  if (ramp.getTickMicros() > maxTickMicros)
+    maxTickMicros = ramp.getTickMicros();
+
+  if (millis() - lastReport >= 5000)
+  {
+    lastReport = millis();
+    Serial.print("Tick: ");
+    Serial.print(ramp.getTickMicros());
+    Serial.print(" us (max ");
+    Serial.print(maxTickMicros);
+    Serial.print(" us), frames sent: ");
+    Serial.println(ramp.getFramesSent());
+
+    if (!ramp.isRamping(FIRST_LOCO + LOCOS - 1))
+    {
+      up = !up;
+      for (uint8_t i = 0; i < LOCOS; i++)
+        ramp.setTarget(FIRST_LOCO + i, up ? 600 : 0);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Two shuttle trains run by TrackAutomation, without delay(). Each
+ * train runs until it reaches the contact at the end of its line,
+ * waits, reverses and goes back. The second train also sets a
+ * turnout on its way. Contacts are S88 contacts reported on the bus.
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackAutomation.h"
+
+const uint16_t LOCO_1 = ADDR_MFX + 7;  // Change with your own addresses
+const uint16_t LOCO_2 = ADDR_MM2 + 24;
+const uint16_t TURNOUT = ADDR_ACC_MM2 + 1;
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 500; // ms
+const uint16_t HASH = 0x00;
+const bool LOOPBACK = false;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK); // Instance de la classe TrackController, création de l'objet ctrl.
+TrackAutomation automation(ctrl);
+
+const TrackStep SHUTTLE_1[] = {
+    STEP_FUNCTION(0, 1),        // 0: headlights on
+    STEP_DIRECTION(DIR_FORWARD),
+    STEP_SPEED(400),            // 2: go
+    STEP_WAIT_CONTACT(1, 1),    // until contact 1 is occupied
+    STEP_SPEED(0),
+    STEP_WAIT_S(20),
+    STEP_DIRECTION(DIR_CHANGE),
+    STEP_SPEED(400),
+    STEP_WAIT_CONTACT(2, 1),    // until contact 2 is occupied
+    STEP_SPEED(0),
+    STEP_WAIT_S(20),
+    STEP_DIRECTION(DIR_CHANGE),
+    STEP_JUMP(2)};
+
+const TrackStep SHUTTLE_2[] = {
+    STEP_ACCESSORY(TURNOUT, ACC_ROUND), // 0
+    STEP_SPEED(300),
+    STEP_WAIT_CONTACT(3, 1),
+    STEP_SPEED(0),
+    STEP_WAIT_S(15),
+    STEP_ACCESSORY(TURNOUT, ACC_STRAIGHT),
+    STEP_DIRECTION(DIR_CHANGE),
+    STEP_SPEED(300),
+    STEP_WAIT_CONTACT(4, 1),
+    STEP_SPEED(0),
+    STEP_WAIT_S(15),
+    STEP_DIRECTION(DIR_CHANGE),
+    STEP_JUMP(0)};
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrl.begin();
+  Serial.println("Power on");
+  ctrl.setPower(true);
+
+  automation.start(SHUTTLE_1, sizeof(SHUTTLE_1) / sizeof(TrackStep), LOCO_1);
+  automation.start(SHUTTLE_2, sizeof(SHUTTLE_2) / sizeof(TrackStep), LOCO_2);
+}
+
+void loop()
+{
+  ctrl.update();       // Picks up the feedback events
+  automation.update(); // Advances both shuttles
+}
@@ -0,0 +1,172 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Benchmarks the protocol hot paths on the board itself and prints
+ * one line per benchmark: nanoseconds per operation and, when
+ * allocation counting is enabled, heap allocations per operation.
+ * The exchange round trip runs against TrackSimulator, so no layout
+ * is needed; leave the CAN bus disconnected.
+ *
+ * The same benchmarks run on a PC in test/test_benchmark:
+ *
+ *   pio test -e native -f test_benchmark -v
+ *
+ * Allocation counting (ESP32) needs the heap functions wrapped by the
+ * linker. Add to the environment in platformio.ini:
+ *
+ *   build_flags = -DBENCHMARK_COUNT_ALLOCATIONS -Wl,--wrap=malloc -Wl,--wrap=realloc
+ *
+ * Without it the allocation column shows "-".
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackSimulator.h"
+
+const uint16_t LOCO = ADDR_MFX + 7;
+const uint32_t RUNS = 10000;
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 50; // ms
+const uint16_t HASH = 0xDF24;  // Fixed, so begin() does not ping for a hash
+const bool LOOPBACK = true;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK); // Instance de la classe TrackController, création de l'objet ctrl.
+TrackSimulator gleisbox(ctrl);
+
+volatile uint32_t allocations = 0;
+volatile uint32_t sink = 0;
+
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_realloc(void *p, size_t size);
+
+  void *__wrap_malloc(size_t size)
+  {
+    allocations++;
+    return __real_malloc(size);
+  }
+
+  void *__wrap_realloc(void *p, size_t size)
+  {
+    allocations++;
+    return __real_realloc(p, size);
+  }
+}
+#endif
+
+/*
+ * Swallows everything, so printing costs no serial time.
+ */
+class NullPrint : public Print
+{
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t size) override { return size; }
+};
+
+NullPrint nullPrint;
+
+template <typename F>
+void run(const char *name, uint32_t runs, F body)
+{
+  body(); // Warm up caches and first-time allocations
+
+  const uint32_t before = allocations;
+  const uint32_t start = micros();
+  for (uint32_t i = 0; i < runs; i++)
+    body();
+  const uint32_t elapsed = micros() - start;
+  const uint32_t allocs = allocations - before;
+
+  Serial.print(name);
+  for (size_t i = strlen(name); i < 34; i++)
+    Serial.print(' ');
+  Serial.print(static_cast<uint32_t>((static_cast<uint64_t>(elapsed) * 1000) / runs));
+  Serial.print(" ns/op\t");
+#if defined(BENCHMARK_COUNT_ALLOCATIONS)
+  Serial.print(static_cast<float>(allocs) / runs, 2);
+#else
+  (void)allocs;
+  Serial.print("-");
+#endif
+  Serial.println(" allocs/op");
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrl.begin();
+  delay(100);
+
+  TrackMessage message = LocoSpeed::set(LOCO, 500);
+  message.hash = HASH;
+  const char *text = "df24   04 6 00 00 40 07 01 f4";
+  CANMessage frame;
+  TrackFrameView view(frame);
+  view.fromMessage(message);
+  const char *line = "speed 16391 500";
+  String legacy = line;
+  TrackUserCommand command;
+
+  Serial.println("\nRailuino benchmark");
+  Serial.println("------------------------------------------------------------------");
+
+  run("TrackMessage::printTo", RUNS, [&]()
+      { sink += message.printTo(nullPrint); });
+
+  run("TrackMessage::parseFrom", RUNS, [&]()
+      { TrackMessage m; sink += m.parseFrom(text); });
+
+  run("id packing (sendMessage)", RUNS * 10, [&]()
+      { view.fromMessage(message); sink += frame.id; });
+
+  run("frame decoding (receiveMessage)", RUNS * 10, [&]()
+      { TrackMessage m; view.toMessage(m); sink += m.command; });
+
+  run("receive path (inject + receive)", RUNS, [&]()
+      { TrackMessage m = message; ctrl.injectMessage(m); sink += ctrl.receiveMessage(m); });
+
+  run("text command parser", RUNS, [&]()
+      { sink += TrackUserCommandParser::parse(line, strlen(line), command); });
+
+  run("legacy startsWith/substring parse", RUNS, [&]()
+      {
+        if (legacy.startsWith("speed "))
+          sink += legacy.substring(6, 11).toInt() + legacy.substring(12).toInt();
+      });
+
+  run("exchangeMessage (simulated box)", RUNS / 10, [&]()
+      { TrackMessage m = LocoSpeed::set(LOCO, 500); sink += ctrl.exchangeMessage(m, m, TIMEOUT); });
+
+  Serial.println("------------------------------------------------------------------");
+  Serial.print("Simulated answers: ");
+  Serial.print(gleisbox.getAnswered());
+  Serial.print(", dropped: ");
+  Serial.println(gleisbox.getDropped());
+}
+
+void loop()
+{
+}
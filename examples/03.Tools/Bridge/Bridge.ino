@@ -0,0 +1,86 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Joins two CAN buses, each with its own booster, into one layout.
+ * On ESP32, segment A uses the built-in CAN controller and segment B
+ * an MCP2515 (ACAN2515 library required). On AVR, both segments use
+ * an MCP2515. Loco and accessory commands are forwarded both ways,
+ * everything else stays on its own bus. The counters are printed
+ * every 5 seconds.
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackBridge.h"
+
+#if defined ARDUINO_ARCH_ESP32
+TrackTransportESP32 busA(5, 4);         // RX, TX
+TrackTransportMCP2515 busB(15, 16);     // CS, INT (adapt to your design)
+#else
+TrackTransportMCP2515 busA(10, 2);      // CS, INT (adapt to your design)
+TrackTransportMCP2515 busB(9, 3);       // CS, INT (adapt to your design)
+#endif
+
+TrackController ctrlA(busA, 0xDF24);
+TrackController ctrlB(busB, 0xDF25);
+TrackBridge bridge(ctrlA, ctrlB);
+
+bool locoAndAccessories(const TrackMessage &message, bool fromA)
+{
+  switch (message.command)
+  {
+  case CMD_LOCO_SPEED:
+  case CMD_LOCO_DIR:
+  case CMD_LOCO_FUNC:
+  case CMD_ACCESSORY:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrlA.begin();
+  ctrlB.begin();
+  bridge.setFilter(locoAndAccessories);
+}
+
+void loop()
+{
+  static uint32_t next = 0;
+
+  ctrlA.update();
+  ctrlB.update();
+  bridge.update();
+
+  if (static_cast<int32_t>(millis() - next) >= 0)
+  {
+    next = millis() + 5000;
+    Serial.print("Forwarded ");
+    Serial.print(bridge.getForwarded());
+    Serial.print(", filtered ");
+    Serial.print(bridge.getFiltered());
+    Serial.print(", dropped ");
+    Serial.println(bridge.getDropped());
+  }
+}
@@ -0,0 +1,82 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Measures how far one controller scales with TrackLoadGenerator: a
+ * simulated connection box answers random throttle, accessory and
+ * contact traffic from several clients, and every step prints one
+ * line with throughput, latency percentiles, drops and the share of
+ * CPU time of each part. The steps form two scaling curves, one
+ * growing the layout, one growing the number of clients, so the
+ * point where latency collapses can be read off the output.
+ *
+ * The loco table keeps TRACK_MAX_LOCOS locos; steps with more are
+ * marked with a '*' after the number it kept.
+ *
+ * Leave the CAN bus disconnected; loopback is on. The same generator
+ * runs on the PC with: pio test -e native -f test_loadtest -v
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackLoadGenerator.h"
+
+const uint32_t STEP_MS = 2000;
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 50;  // ms
+const uint16_t HASH = 0xDF24; // Fixed, so begin() does not ping for a hash
+const bool LOOPBACK = true;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK);
+TrackLoadGenerator load(ctrl);
+
+void step(uint16_t locos, uint16_t accessories, uint16_t contacts, uint8_t clients)
+{
+  TrackLoadStats stats;
+  load.run(locos, accessories, contacts, clients, STEP_MS, stats);
+  TrackLoadGenerator::print(Serial, stats);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  ctrl.begin();
+
+  Serial.println("\nRailuino load test, CPU in % of each step");
+  TrackLoadGenerator::printHeader(Serial);
+
+  // Growing layout, as many clients as requests can be tracked
+  for (uint16_t n = 4; n <= 256; n *= 2)
+    step(n, 4 * n, n / 2, TRACK_MAX_REQUESTS);
+
+  // Growing number of clients on a mid-sized layout
+  for (uint8_t c = 1; c <= TRACK_MAX_REQUESTS; c++)
+    step(32, 128, 16, c);
+
+  Serial.print("* The loco table keeps ");
+  Serial.print(TRACK_MAX_LOCOS);
+  Serial.println(" locos and forgets the oldest beyond that.");
+  Serial.println("Done.");
+}
+
+void loop()
+{
+}
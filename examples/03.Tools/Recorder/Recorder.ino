@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * ESP32 only. Records all bus traffic into /session.rlog on SPIFFS
+ * while text commands typed on the serial port are executed.
+ * Commands of the sketch itself:
+ *
+ *   stop      stops recording and closes the file
+ *   replay    replays the file through the receive path, 10x faster
+ */
+
+#include <SPIFFS.h>
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackRecorder.h"
+
+const bool DEBUG = false;
+const uint64_t TIMEOUT = 500; // ms
+const uint16_t HASH = 0x00;
+const bool LOOPBACK = false;
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT, LOOPBACK); // Instance de la classe TrackController, création de l'objet ctrl.
+TrackRecorder recorder(ctrl);
+TrackReplayer replayer(ctrl);
+File file;
+
+char line[128];
+size_t length = 0;
+
+void handleLine()
+{
+  if (strcmp(line, "stop") == 0)
+  {
+    recorder.stop();
+    file.close();
+    Serial.print("Recorded ");
+    Serial.print(recorder.getRecords());
+    Serial.print(" messages in ");
+    Serial.print(recorder.getBytes());
+    Serial.println(" bytes");
+  }
+  else if (strcmp(line, "replay") == 0)
+  {
+    recorder.stop();
+    file.close();
+    file = SPIFFS.open("/session.rlog", "r");
+    if (!file || !replayer.start(file, 10))
+      Serial.println("No recording to replay");
+  }
+  else
+    ctrl.queueUserCommands(line, &Serial);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  if (!SPIFFS.begin(true))
+  {
+    Serial.print("An error has occurred while mounting SPIFFS\n");
+    return;
+  }
+
+  ctrl.begin();
+
+  file = SPIFFS.open("/session.rlog", "w");
+  recorder.start(file);
+  Serial.println("Recording");
+}
+
+void loop()
+{
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if (c == '\n' || length == sizeof(line) - 1)
+    {
+      line[length] = '\0';
+      handleLine();
+      length = 0;
+    }
+    else if (c != '\r')
+      line[length++] = c;
+  }
+
+  replayer.update();
+  ctrl.update();
+
+  if (file && !recorder.isRecording() && !replayer.isReplaying() && replayer.getRecords() > 0)
+  {
+    Serial.print("Replayed ");
+    Serial.print(replayer.getRecords());
+    Serial.println(" messages");
+    file.close();
+  }
+}
@@ -0,0 +1,56 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 Christophe Bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+ * Turns the board into a CAN adapter for a PC on the USB port: CAN
+ * frames go both ways in binary packets (see TrackSerialLink), at
+ * 921600 baud on an ESP32 and 1000000 baud on an AVR. Nothing else
+ * is printed, so the port carries packets only. On the PC side,
+ * tools/seriallink.py shows the traffic and sends frames.
+ */
+
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackSerialLink.h"
+
+#if defined ARDUINO_ARCH_ESP32
+const uint32_t BAUD = 921600;
+#else
+const uint32_t BAUD = 1000000; // Exact with the 16 MHz clock of an Uno
+#endif
+
+const bool DEBUG = false; // Debug output would end up among the packets
+const uint64_t TIMEOUT = 500; // ms
+const uint16_t HASH = 0xDF24; // Fixed, so begin() does not ping for a hash
+
+TrackController ctrl(HASH, DEBUG, TIMEOUT);
+TrackSerialLink serialLink(ctrl, Serial);
+
+void setup()
+{
+  Serial.begin(BAUD);
+  while (!Serial)
+    ;
+
+  ctrl.begin(); // Prints the CAN setup once, the PC skips it
+}
+
+void loop()
+{
+  ctrl.update();
+  serialLink.update();
+}
@@ -45,6 +45,33 @@
  #define ADDR_ACC_MM2 0x2FFF // MM2 magnetic accessory
  #define ADDR_ACC_DCC 0x3800 // DCC magnetic accessory
  
+ /**
+  * Constants for the command numbers of the CAN protocol (bits 17 to
+  * 24 of the CAN identifier).
+  */
+ #define CMD_SYSTEM       0x00 // System command, see SYS_* sub-commands
+ #define CMD_LOCO_SPEED   0x04 // Locomotive speed
+ #define CMD_LOCO_DIR     0x05 // Locomotive direction
+ #define CMD_LOCO_FUNC    0x06 // Locomotive function
+ #define CMD_READ_CONFIG  0x07 // Read config
+ #define CMD_WRITE_CONFIG 0x08 // Write config
+ #define CMD_ACCESSORY    0x0B // Switch or query magnetic accessory
+ #define CMD_S88_EVENT    0x11 // Feedback contact event
+ #define CMD_PING         0x18 // Ping, answered by every device on the bus
+ #define CMD_BOOTLOADER   0x1B // Bootloader CAN, wakes up the connection box
+ #define CMD_STATUS_CONFIG 0x1D // Description of a device and its measurement channels
+ 
+ /**
+  * Constants for the sub-commands of the system command (data[4]).
+  */
+ #define SYS_STOP         0x00 // System stop
+ #define SYS_GO           0x01 // System go
+ #define SYS_HALT         0x02 // System halt
+ #define SYS_LOCO_STOP    0x03 // Locomotive emergency stop
+ #define SYS_PROTOCOL     0x08 // Enable or disable track protocols
+ #define SYS_MFX_COUNTER  0x09 // MFX re-registration counter
+ #define SYS_STATUS       0x0B // Read a measurement channel of a device
+ 
  /**
   * Constants for classic MM2 Delta addresses.
   */
@@ -83,4 +110,173 @@
  #define ACC_SH0      3
  
  
+ // ===================================================================
+ // === Library limits ================================================
+ // ===================================================================
+ 
+ /**
+  * Sizes of the fixed tables and queues used by the library. They can
+  * be overridden from the build flags, for instance with
+  * -DTRACK_USER_QUEUE_SIZE=4 on small AVR boards.
+  *
+  * RAILUINO_LEAN, set by the uno_lean environment, picks defaults
+  * that fit the 2 KB of SRAM of an ATmega328 and leaves out the
+  * methods taking a String.
+  */
+ #ifdef RAILUINO_LEAN
+ #ifndef TRACK_USER_QUEUE_SIZE
+ #define TRACK_USER_QUEUE_SIZE 4
+ #endif
+ #ifndef TRACK_MAX_LISTENERS
+ #define TRACK_MAX_LISTENERS 2
+ #endif
+ #ifndef TRACK_MAX_SEQUENCES
+ #define TRACK_MAX_SEQUENCES 2
+ #endif
+ #ifndef TRACK_MAX_RAMPS
+ #define TRACK_MAX_RAMPS 4
+ #endif
+ #ifndef TRACK_MAX_LOCOS
+ #define TRACK_MAX_LOCOS 4
+ #endif
+ #ifndef TRACK_INJECT_QUEUE_SIZE
+ #define TRACK_INJECT_QUEUE_SIZE 2
+ #endif
+ #ifndef TRACK_MAX_REQUESTS
+ #define TRACK_MAX_REQUESTS 2
+ #endif
+ #ifndef TRACK_BRIDGE_QUEUE_SIZE
+ #define TRACK_BRIDGE_QUEUE_SIZE 2
+ #endif
+ #ifndef TRACK_TELEMETRY_WINDOW
+ #define TRACK_TELEMETRY_WINDOW 2
+ #endif
+ #ifndef TRACK_ACCESSORY_RANGE
+ #define TRACK_ACCESSORY_RANGE 32
+ #endif
+ #ifndef TRACK_MAX_CONSISTS
+ #define TRACK_MAX_CONSISTS 1
+ #endif
+ #ifndef TRACK_CONSIST_SIZE
+ #define TRACK_CONSIST_SIZE 2
+ #endif
+ #ifndef TRACK_HELD_FRAMES
+ #define TRACK_HELD_FRAMES 2
+ #endif
+ #ifndef TRACK_MAX_BLOCKS
+ #define TRACK_MAX_BLOCKS 4
+ #endif
+ #ifndef TRACK_LAYOUT_BLOCKS
+ #define TRACK_LAYOUT_BLOCKS 8
+ #endif
+ #ifndef TRACK_LAYOUT_EDGES
+ #define TRACK_LAYOUT_EDGES 12
+ #endif
+ #ifndef TRACK_ROUTE_CACHE
+ #define TRACK_ROUTE_CACHE 2
+ #endif
+ #ifndef TRACK_LINK_QUEUE_SIZE
+ #define TRACK_LINK_QUEUE_SIZE 4
+ #endif
+ #ifndef TRACK_CONFIG_ACCESSORIES
+ #define TRACK_CONFIG_ACCESSORIES 8
+ #endif
+ #endif
+ 
+ #ifndef TRACK_USER_QUEUE_SIZE
+ #define TRACK_USER_QUEUE_SIZE 16 // Queued text protocol commands, power of two
+ #endif
+ 
+ #ifndef TRACK_MAX_LISTENERS
+ #if defined ARDUINO_ARCH_AVR
+ #define TRACK_MAX_LISTENERS 4
+ #else
+ #define TRACK_MAX_LISTENERS 8 // Objects notified of every message sent or received
+ #endif
+ #endif
+ 
+ #ifndef TRACK_MAX_SEQUENCES
+ #define TRACK_MAX_SEQUENCES 10 // Sequences run concurrently by TrackAutomation
+ #endif
+ 
+ #ifndef TRACK_MAX_RAMPS
+ #define TRACK_MAX_RAMPS 32 // Locomotives ramped concurrently by TrackRamp
+ #endif
+ 
+ #ifndef TRACK_MAX_LOCOS
+ #define TRACK_MAX_LOCOS 16 // Locomotives whose state is kept by TrackLocoTable
+ #endif
+ 
+ #ifndef TRACK_MAX_REQUESTS
+ #define TRACK_MAX_REQUESTS 8 // Requests waiting for a response in TrackRequests
+ #endif
+ 
+ #ifndef TRACK_INJECT_QUEUE_SIZE
+ #define TRACK_INJECT_QUEUE_SIZE 8 // Messages injected into the receive path, power of two
+ #endif
+ 
+ #ifndef TRACK_BRIDGE_QUEUE_SIZE
+ #define TRACK_BRIDGE_QUEUE_SIZE 16 // Messages waiting to be forwarded by TrackBridge, power of two
+ #endif
+ 
+ #ifndef TRACK_TELEMETRY_CHANNELS
+ #define TRACK_TELEMETRY_CHANNELS 4 // Measurement channels polled by TrackTelemetry
+ #endif
+ 
+ #ifndef TRACK_TELEMETRY_WINDOW
+ #define TRACK_TELEMETRY_WINDOW 8 // Readings kept per channel by TrackTelemetry, power of two
+ #endif
+ 
+ #ifndef TRACK_ACCESSORY_RANGE
+ #if defined ARDUINO_ARCH_AVR
+ #define TRACK_ACCESSORY_RANGE 128 // 3 ranges of 128 addresses at 4 bits: 192 bytes
+ #else
+ #define TRACK_ACCESSORY_RANGE 1024 // Addresses followed by TrackAccessoryTable in each accessory range, multiple of 32
+ #endif
+ #endif
+ 
+ #ifndef TRACK_MAX_CONSISTS
+ #define TRACK_MAX_CONSISTS 4 // Consists kept by TrackController
+ #endif
+ 
+ #ifndef TRACK_CONSIST_SIZE
+ #define TRACK_CONSIST_SIZE 4 // Locomotives per consist, at most 8
+ #endif
+ 
+ #ifndef TRACK_HELD_FRAMES
+ #define TRACK_HELD_FRAMES 8 // Frames kept by TrackSupervisor while the bus is off, power of two
+ #endif
+ 
+ #ifndef TRACK_MAX_BLOCKS
+ #define TRACK_MAX_BLOCKS 16 // Blocks guarded by TrackInterlock
+ #endif
+ 
+ #ifndef TRACK_LAYOUT_BLOCKS
+ #define TRACK_LAYOUT_BLOCKS 32 // Blocks of the TrackLayout graph, at most 64
+ #endif
+ 
+ #ifndef TRACK_LAYOUT_EDGES
+ #define TRACK_LAYOUT_EDGES 64 // Connections between blocks in the TrackLayout graph
+ #endif
+ 
+ #ifndef TRACK_ROUTE_CACHE
+ #define TRACK_ROUTE_CACHE 8 // Routes remembered by TrackLayout
+ #endif
+ 
+ #ifndef TRACK_LINK_QUEUE_SIZE
+ #define TRACK_LINK_QUEUE_SIZE 16 // Frames waiting for the serial port in TrackSerialLink, power of two
+ #endif
+ 
+ #ifndef TRACK_CONFIG_ACCESSORIES
+ #define TRACK_CONFIG_ACCESSORIES 64 // Named accessories kept by TrackConfig
+ #endif
+ 
+ #ifndef TRACK_LOAD_SAMPLES
+ #if defined ARDUINO_ARCH_AVR
+ #define TRACK_LOAD_SAMPLES 64 // 256 bytes
+ #else
+ #define TRACK_LOAD_SAMPLES 2048 // Latencies kept per step by TrackLoadGenerator for the percentiles
+ #endif
+ #endif
+ 
  #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,211 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackAccessoryTable.h"
+#include "TrackCommand.h"
+
+/*
+   Cell layout: bit 3 known, bit 2 power, bits 0..1 position.
+*/
+static const uint8_t CELL_KNOWN = 0x08;
+static const uint8_t CELL_POWER = 0x04;
+static const uint8_t CELL_POSITION = 0x03;
+
+/*
+   First address of each range, in table order.
+*/
+static const uint16_t RANGE_BASES[3] = {ADDR_ACC_SX1, ADDR_ACC_MM2 + 1, ADDR_ACC_DCC};
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackAccessoryTable::TrackAccessoryTable(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mVersion(0)
+{
+    clear();
+    mCtrl.addListener(this);
+}
+
+TrackAccessoryTable::~TrackAccessoryTable()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::indexOf / addressOf
+-------------------------------------------------------------------  */
+
+int16_t TrackAccessoryTable::indexOf(uint16_t address)
+{
+    for (uint8_t range = 0; range < 3; range++)
+        if (address >= RANGE_BASES[range] && address - RANGE_BASES[range] < TRACK_ACCESSORY_RANGE)
+            return range * TRACK_ACCESSORY_RANGE + (address - RANGE_BASES[range]);
+    return -1;
+}
+
+uint16_t TrackAccessoryTable::addressOf(uint16_t index)
+{
+    return RANGE_BASES[index / TRACK_ACCESSORY_RANGE] + index % TRACK_ACCESSORY_RANGE;
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::cell / setCell
+-------------------------------------------------------------------  */
+
+uint8_t TrackAccessoryTable::cell(uint16_t index) const
+{
+    const uint8_t cells = mCells[index / 2];
+    return (index & 0x01) ? cells >> 4 : cells & 0x0F;
+}
+
+void TrackAccessoryTable::setCell(uint16_t index, uint8_t value)
+{
+    if (cell(index) == value)
+        return; // Repeated frames do not make a new version
+
+    uint8_t &cells = mCells[index / 2];
+    if (index & 0x01)
+        cells = (cells & 0x0F) | (value << 4);
+    else
+        cells = (cells & 0xF0) | value;
+    mStamps[index / BLOCK_ADDRESSES] = ++mVersion;
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::getPosition
+-------------------------------------------------------------------  */
+
+bool TrackAccessoryTable::getPosition(uint16_t address, uint8_t *position, uint8_t *power) const
+{
+    const int16_t index = indexOf(address);
+    if (index < 0)
+        return false;
+
+    const uint8_t value = cell(index);
+    if ((value & CELL_KNOWN) == 0)
+        return false;
+
+    *position = value & CELL_POSITION;
+    if (power != nullptr)
+        *power = (value & CELL_POWER) ? 1 : 0;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::getChanges
+-------------------------------------------------------------------  */
+
+uint8_t TrackAccessoryTable::getChanges(uint32_t version, uint16_t &cursor, TrackAccessoryState *states, uint8_t max) const
+{
+    static const uint16_t COUNT = 3 * TRACK_ACCESSORY_RANGE;
+    uint8_t found = 0;
+    uint16_t index = cursor;
+
+    while (index < COUNT)
+    {
+        if (mStamps[index / BLOCK_ADDRESSES] <= version)
+        {
+            index = (index / BLOCK_ADDRESSES + 1) * BLOCK_ADDRESSES; // Block unchanged, skip it
+            continue;
+        }
+
+        const uint8_t value = cell(index);
+        if (value & CELL_KNOWN)
+        {
+            if (found == max)
+            {
+                cursor = index; // Resume here on the next call
+                return found;
+            }
+            states[found].address = addressOf(index);
+            states[found].position = value & CELL_POSITION;
+            states[found].power = (value & CELL_POWER) ? 1 : 0;
+            found++;
+        }
+        index++;
+    }
+
+    cursor = 0;
+    return found;
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::clear
+-------------------------------------------------------------------  */
+
+void TrackAccessoryTable::clear()
+{
+    memset(mCells, 0x00, sizeof(mCells));
+    mVersion++;
+    for (uint8_t i = 0; i < BLOCKS; i++)
+        mStamps[i] = mVersion; // Clients drop what they knew
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::saveBlock
+-------------------------------------------------------------------  */
+
+void TrackAccessoryTable::saveBlock(uint8_t block, uint8_t *data) const
+{
+    memset(data, 0x00, 12);
+    for (uint8_t i = 0; i < BLOCK_ADDRESSES; i++)
+    {
+        const uint8_t value = cell(block * BLOCK_ADDRESSES + i);
+        if (value & CELL_KNOWN)
+            data[i / 8] |= 0x80 >> (i % 8);
+        data[4 + i / 4] |= (value & CELL_POSITION) << (2 * (i % 4));
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::loadBlock
+-------------------------------------------------------------------  */
+
+void TrackAccessoryTable::loadBlock(uint8_t block, const uint8_t *data)
+{
+    for (uint8_t i = 0; i < BLOCK_ADDRESSES; i++)
+    {
+        uint8_t value = (data[4 + i / 4] >> (2 * (i % 4))) & CELL_POSITION;
+        if (data[i / 8] & (0x80 >> (i % 8)))
+            value |= CELL_KNOWN;
+        else
+            value = 0;
+        setCell(block * BLOCK_ADDRESSES + i, value);
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackAccessoryTable::onMessage
+-------------------------------------------------------------------  */
+
+void TrackAccessoryTable::onMessage(const TrackMessage &message, bool)
+{
+    // Commands and responses carry the position; queries do not
+    if (message.command != CMD_ACCESSORY || message.length < 5)
+        return;
+
+    const int16_t index = indexOf(TrackCommand::address(message));
+    if (index < 0)
+        return;
+
+    uint8_t value = CELL_KNOWN | (Accessory::position(message) & CELL_POSITION);
+    if (message.length >= 6 && Accessory::power(message))
+        value |= CELL_POWER;
+    setCell(index, value);
+}
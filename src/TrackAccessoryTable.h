@@ -0,0 +1,112 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKACCESSORYTABLE_H
+ #define TRACKACCESSORYTABLE_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ /**
+  * One accessory as reported by TrackAccessoryTable::getChanges().
+  */
+ struct TrackAccessoryState
+ {
+   uint16_t address;
+   uint8_t position;
+   uint8_t power;
+ };
+
+ // ===================================================================
+ // === TrackAccessoryTable ===========================================
+ // ===================================================================
+
+ /**
+  * Keeps the position of the first TRACK_ACCESSORY_RANGE addresses
+  * of each accessory range (SX1, MM2 and DCC) in four bits: two for
+  * the position, one for the power and one telling whether anything
+  * is known. The table follows every accessory message the
+  * controller sends or receives, so turnouts switched from an MS2 or
+  * a CS2 show up as well, and a panel can show them without asking
+  * the bus.
+  *
+  * Addresses are grouped in blocks of 32, and every block carries
+  * the version of the table when it last changed. getChanges()
+  * returns the accessories in the blocks changed after a given
+  * version, so a client that remembers the version it last saw gets
+  * only what is new: everything for version 0, usually nothing.
+  */
+ class TrackAccessoryTable : public TrackListener
+ {
+ public:
+   static const uint8_t BLOCK_ADDRESSES = 32;
+   static const uint8_t BLOCKS = 3 * TRACK_ACCESSORY_RANGE / BLOCK_ADDRESSES;
+
+   static_assert(TRACK_ACCESSORY_RANGE % BLOCK_ADDRESSES == 0, "TRACK_ACCESSORY_RANGE must be a multiple of 32");
+   static_assert(3 * TRACK_ACCESSORY_RANGE / BLOCK_ADDRESSES <= 255, "TRACK_ACCESSORY_RANGE too large");
+
+ private:
+   TrackController &mCtrl;
+   uint8_t mCells[3 * TRACK_ACCESSORY_RANGE / 2]; // Two accessories per byte
+   uint32_t mStamps[BLOCKS];
+   uint32_t mVersion;
+
+   static int16_t indexOf(uint16_t address);
+   static uint16_t addressOf(uint16_t index);
+   uint8_t cell(uint16_t index) const;
+   void setCell(uint16_t index, uint8_t value);
+
+ public:
+   TrackAccessoryTable(TrackController &ctrl);
+   ~TrackAccessoryTable();
+
+   /**
+    * Gives the last position and power seen for an accessory.
+    * Returns false if it is unknown or outside the table.
+    */
+   bool getPosition(uint16_t address, uint8_t *position, uint8_t *power = nullptr) const;
+
+   /**
+    * Returns the version of the table, raised by every change.
+    */
+   uint32_t getVersion() const { return mVersion; }
+
+   /**
+    * Copies up to 'max' known accessories from the blocks changed
+    * after 'version' into 'states'. Start with 'cursor' at 0 and call
+    * again while it is not 0 to get the rest. Returns the number of
+    * accessories copied.
+    */
+   uint8_t getChanges(uint32_t version, uint16_t &cursor, TrackAccessoryState *states, uint8_t max) const;
+
+   /**
+    * Forgets all accessories.
+    */
+   void clear();
+
+   /**
+    * Packs a block into 12 bytes (known bitmap, then positions at two
+    * bits each) and back, without the power flags. Used by
+    * TrackSnapshot.
+    */
+   void saveBlock(uint8_t block, uint8_t *data) const;
+   void loadBlock(uint8_t block, const uint8_t *data);
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKACCESSORYTABLE_H
@@ -0,0 +1,239 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackAutomation.h"
+#include "TrackCommand.h"
+
+/*
+   Time (in ms) for which a magnetic accessory is powered when a
+   sequence switches it, as TrackController::setAccessory() does.
+*/
+static const uint16_t ACCESSORY_PULSE = 20;
+
+/* -------------------------------------------------------------------
+   TrackAutomation (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackAutomation::TrackAutomation(TrackController &ctrl)
+    : mCtrl(ctrl)
+{
+    for (uint8_t i = 0; i < TRACK_MAX_SEQUENCES; i++)
+        mSlots[i].state = IDLE;
+    mCtrl.addListener(this);
+}
+
+TrackAutomation::~TrackAutomation()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::start
+-------------------------------------------------------------------  */
+
+int8_t TrackAutomation::start(const TrackStep *steps, uint16_t count, uint16_t loco)
+{
+    for (uint8_t i = 0; i < TRACK_MAX_SEQUENCES; i++)
+    {
+        Slot &slot = mSlots[i];
+        if (slot.state == IDLE)
+        {
+            slot.steps = steps;
+            slot.count = count;
+            slot.pc = 0;
+            slot.loco = loco;
+            slot.state = READY;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::stop
+-------------------------------------------------------------------  */
+
+void TrackAutomation::stop(int8_t slot)
+{
+    if (slot < 0 || slot >= TRACK_MAX_SEQUENCES)
+        return;
+
+    Slot &s = mSlots[slot];
+    if (s.state == WAIT_PULSE)
+    {
+        // Never leave a coil powered: if the off frame cannot go out,
+        // update() sends it again and then ends the sequence.
+        s.pc = s.count;
+        TrackMessage message = Accessory::set(s.pulseAddress, s.pulsePosition, 0);
+        if (!mCtrl.sendMessage(message))
+            return;
+    }
+    s.state = IDLE;
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::isRunning
+-------------------------------------------------------------------  */
+
+bool TrackAutomation::isRunning(int8_t slot) const
+{
+    return slot >= 0 && slot < TRACK_MAX_SEQUENCES && mSlots[slot].state != IDLE;
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::position
+-------------------------------------------------------------------  */
+
+uint16_t TrackAutomation::position(int8_t slot) const
+{
+    return isRunning(slot) ? mSlots[slot].pc : 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::onContact
+-------------------------------------------------------------------  */
+
+void TrackAutomation::onContact(uint16_t contact, uint8_t state)
+{
+    for (uint8_t i = 0; i < TRACK_MAX_SEQUENCES; i++)
+    {
+        Slot &slot = mSlots[i];
+        if (slot.state == WAIT_CONTACT && slot.waitContact == contact && slot.waitState == (state ? 1 : 0))
+            slot.state = READY;
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::onMessage
+-------------------------------------------------------------------  */
+
+void TrackAutomation::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (!outgoing && message.command == CMD_S88_EVENT && message.length >= 6)
+        onContact(FeedbackEvent::contact(message), FeedbackEvent::state(message));
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::update
+-------------------------------------------------------------------  */
+
+void TrackAutomation::update()
+{
+    const uint32_t now = millis();
+
+    for (uint8_t i = 0; i < TRACK_MAX_SEQUENCES; i++)
+    {
+        Slot &slot = mSlots[i];
+
+        if (slot.state == WAIT_TIME && static_cast<int32_t>(now - slot.wakeAt) >= 0)
+            slot.state = READY;
+
+        if (slot.state == WAIT_PULSE && static_cast<int32_t>(now - slot.wakeAt) >= 0)
+        {
+            TrackMessage message = Accessory::set(slot.pulseAddress, slot.pulsePosition, 0);
+            if (mCtrl.sendMessage(message))
+                slot.state = READY; // Else the coil stays on until the next update()
+            continue;               // At most one frame per sequence and call
+        }
+
+        if (slot.state == READY)
+            step(slot, now);
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::step
+-------------------------------------------------------------------  */
+
+void TrackAutomation::step(Slot &slot, uint32_t now)
+{
+    /* Jumps and loco changes cost nothing, but a table made of jumps
+       only must not hang loop(): give up after one pass over it. */
+    for (uint16_t budget = slot.count; budget > 0; budget--)
+    {
+        if (slot.pc >= slot.count)
+        {
+            slot.state = IDLE;
+            return;
+        }
+
+        const TrackStep &s = slot.steps[slot.pc++];
+
+        switch (s.op)
+        {
+        case OP_END:
+            slot.state = IDLE;
+            return;
+        case OP_LOCO:
+            slot.loco = s.value;
+            break;
+        case OP_JUMP:
+            slot.pc = s.value;
+            break;
+        case OP_SPEED:
+            send(slot, LocoSpeed::set(slot.loco, s.value));
+            return;
+        case OP_DIRECTION:
+            send(slot, LocoDirection::set(slot.loco, s.arg));
+            return;
+        case OP_FUNCTION:
+            send(slot, LocoFunction::set(slot.loco, s.arg, s.value));
+            return;
+        case OP_ACCESSORY:
+            if (send(slot, Accessory::set(s.value, s.arg, 1)))
+            {
+                slot.pulseAddress = s.value;
+                slot.pulsePosition = s.arg;
+                slot.wakeAt = now + ACCESSORY_PULSE;
+                slot.state = WAIT_PULSE;
+            }
+            return;
+        case OP_STOP:
+            send(slot, SystemCommand::emergency(slot.loco));
+            return;
+        case OP_WAIT_MS:
+            slot.wakeAt = now + s.value;
+            slot.state = WAIT_TIME;
+            return;
+        case OP_WAIT_S:
+            slot.wakeAt = now + 1000UL * s.value;
+            slot.state = WAIT_TIME;
+            return;
+        case OP_WAIT_CONTACT:
+            slot.waitContact = s.value;
+            slot.waitState = s.arg ? 1 : 0;
+            slot.state = WAIT_CONTACT;
+            return;
+        default:
+            slot.state = IDLE; // Unknown operation, stop safely
+            return;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackAutomation::send
+-------------------------------------------------------------------  */
+
+bool TrackAutomation::send(Slot &slot, TrackMessage message)
+{
+    if (mCtrl.sendMessage(message))
+        return true;
+
+    slot.pc--;
+    return false;
+}
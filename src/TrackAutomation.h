@@ -0,0 +1,181 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKAUTOMATION_H
+ #define TRACKAUTOMATION_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "Config.h"
+
+ /**
+  * Constants for the operations of a sequence step.
+  */
+ #define OP_END         0 // Sequence is finished
+ #define OP_LOCO        1 // value = address used by the following steps
+ #define OP_SPEED       2 // value = speed
+ #define OP_DIRECTION   3 // arg = direction
+ #define OP_FUNCTION    4 // arg = function, value = power
+ #define OP_ACCESSORY   5 // arg = position, value = address
+ #define OP_WAIT_MS     6 // value = time in ms
+ #define OP_WAIT_S      7 // value = time in s
+ #define OP_WAIT_CONTACT 8 // arg = state, value = contact
+ #define OP_JUMP        9 // value = index of the next step
+ #define OP_STOP       10 // Emergency stop of the current loco
+
+ /**
+  * Helpers for writing sequence tables, for instance
+  *
+  * const TrackStep SHUTTLE[] = {
+  *   STEP_FUNCTION(0, 1),
+  *   STEP_SPEED(400),
+  *   STEP_WAIT_CONTACT(12, 1),
+  *   STEP_SPEED(0),
+  *   STEP_WAIT_S(30),
+  *   STEP_DIRECTION(DIR_CHANGE),
+  *   STEP_JUMP(1)
+  * };
+  */
+ #define STEP_END()               {OP_END, 0, 0}
+ #define STEP_LOCO(address)       {OP_LOCO, 0, (address)}
+ #define STEP_SPEED(speed)        {OP_SPEED, 0, (speed)}
+ #define STEP_DIRECTION(dir)      {OP_DIRECTION, (dir), 0}
+ #define STEP_FUNCTION(fn, power) {OP_FUNCTION, (fn), (power)}
+ #define STEP_ACCESSORY(address, position) {OP_ACCESSORY, (position), (address)}
+ #define STEP_WAIT_MS(ms)         {OP_WAIT_MS, 0, (ms)}
+ #define STEP_WAIT_S(s)           {OP_WAIT_S, 0, (s)}
+ #define STEP_WAIT_CONTACT(contact, state) {OP_WAIT_CONTACT, (state), (contact)}
+ #define STEP_JUMP(index)         {OP_JUMP, 0, (index)}
+ #define STEP_STOP()              {OP_STOP, 0, 0}
+
+ /**
+  * One step of a sequence: an operation and its two operands.
+  */
+ struct TrackStep
+ {
+   uint8_t op;
+   uint8_t arg;
+   uint16_t value;
+ };
+
+ // ===================================================================
+ // === TrackAutomation ===============================================
+ // ===================================================================
+
+ /**
+  * Runs many sequences of TrackSteps side by side without threads
+  * and without delay(). Each call to update() advances every running
+  * sequence until it has to wait, sending at most one frame per
+  * sequence. Frames go out without waiting for the answer, so
+  * update() never blocks; a frame the bus cannot take is sent again
+  * on the next call. An accessory is switched off by its sequence
+  * once its pulse is over, like a wait. Waits for time or for a
+  * feedback contact cost nothing while they last. Contact events are
+  * picked up from the 0x11 messages seen by the controller, or can
+  * be reported by the sketch with onContact() when contacts are read
+  * locally.
+  */
+ class TrackAutomation : public TrackListener
+ {
+ private:
+   /**
+    * States of a sequence slot.
+    */
+   enum
+   {
+     IDLE,
+     READY,
+     WAIT_TIME,
+     WAIT_CONTACT,
+     WAIT_PULSE // An accessory is powered until wakeAt
+   };
+
+   struct Slot
+   {
+     const TrackStep *steps;
+     uint16_t count;
+     uint16_t pc;
+     uint16_t loco;
+     uint8_t state;
+     uint8_t waitState;
+     uint16_t waitContact;
+     uint32_t wakeAt;
+     uint16_t pulseAddress;
+     uint8_t pulsePosition;
+   };
+
+   TrackController &mCtrl;
+   Slot mSlots[TRACK_MAX_SEQUENCES];
+
+   /**
+    * Executes steps of the given slot until it waits or a command
+    * has been sent.
+    */
+   void step(Slot &slot, uint32_t now);
+
+   /**
+    * Sends a frame for the step just taken, or takes the step back
+    * to try again on the next update(). Returns true if it was sent.
+    */
+   bool send(Slot &slot, TrackMessage message);
+
+ public:
+   /**
+    * Creates an automation engine driving the given controller and
+    * registers it as a listener, so it sees feedback events.
+    */
+   TrackAutomation(TrackController &ctrl);
+   ~TrackAutomation();
+
+   /**
+    * Starts the given sequence of 'count' steps for the given loco.
+    * Returns the slot number, or -1 if all slots are busy.
+    */
+   int8_t start(const TrackStep *steps, uint16_t count, uint16_t loco);
+
+   /**
+    * Stops the sequence in the given slot. The loco keeps its speed.
+    * An accessory still powered by the sequence is switched off.
+    */
+   void stop(int8_t slot);
+
+   /**
+    * Reports whether the given slot runs a sequence.
+    */
+   bool isRunning(int8_t slot) const;
+
+   /**
+    * Returns the index of the next step of the given slot.
+    */
+   uint16_t position(int8_t slot) const;
+
+   /**
+    * Reports a feedback contact event: 'state' is 1 for occupied and
+    * 0 for free. Wakes all sequences waiting for it.
+    */
+   void onContact(uint16_t contact, uint8_t state);
+
+   /**
+    * Advances all sequences. Call this as often as possible from
+    * loop(), after TrackController::update().
+    */
+   void update();
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKAUTOMATION_H
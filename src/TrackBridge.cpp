@@ -0,0 +1,101 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackBridge.h"
+
+/* -------------------------------------------------------------------
+   TrackBridge::Side::onMessage
+-------------------------------------------------------------------  */
+
+void TrackBridge::Side::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (!outgoing)
+        mBridge.receive(message, mFromA);
+}
+
+/* -------------------------------------------------------------------
+   TrackBridge (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackBridge::TrackBridge(TrackController &a, TrackController &b, uint8_t budget, uint16_t maxLatency)
+    : mA(a),
+      mB(b),
+      mSideA(*this, true),
+      mSideB(*this, false),
+      mFilter(nullptr),
+      mMaxLatency(maxLatency),
+      mBudget(budget ? budget : 1),
+      mForwarded(0),
+      mFiltered(0),
+      mDropped(0)
+{
+    mA.addListener(&mSideA);
+    mB.addListener(&mSideB);
+}
+
+TrackBridge::~TrackBridge()
+{
+    mA.removeListener(&mSideA);
+    mB.removeListener(&mSideB);
+}
+
+/* -------------------------------------------------------------------
+   TrackBridge::receive
+-------------------------------------------------------------------  */
+
+void TrackBridge::receive(const TrackMessage &message, bool fromA)
+{
+    if (mFilter != nullptr && !mFilter(message, fromA))
+    {
+        mFiltered++;
+        return;
+    }
+
+    Pending pending;
+    pending.message = message;
+    pending.time = millis();
+    pending.toB = fromA;
+    if (!mPending.push(pending))
+        mDropped++;
+}
+
+/* -------------------------------------------------------------------
+   TrackBridge::update
+-------------------------------------------------------------------  */
+
+void TrackBridge::update()
+{
+    const uint32_t now = millis();
+
+    for (uint8_t n = 0; n < mBudget && !mPending.isEmpty(); n++)
+    {
+        const Pending &pending = mPending[0];
+
+        if (now - pending.time <= mMaxLatency)
+        {
+            TrackController &target = pending.toB ? mB : mA;
+            if (!target.forwardMessage(pending.message))
+                return; // Transmit buffer full, try again on the next call
+            mForwarded++;
+        }
+        else
+            mDropped++;
+
+        Pending done;
+        mPending.pop(done);
+    }
+}
@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKBRIDGE_H
+ #define TRACKBRIDGE_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ /**
+  * Decides whether a message received on one side of a bridge is
+  * passed on to the other side. 'fromA' tells where it came from.
+  */
+ typedef bool (*TrackBridgeFilter)(const TrackMessage &message, bool fromA);
+
+ // ===================================================================
+ // === TrackBridge ===================================================
+ // ===================================================================
+
+ /**
+  * Forwards messages between the buses of two TrackControllers, so a
+  * large layout can be split into segments that still share loco and
+  * accessory commands. Messages received on one side are queued and
+  * sent on the other side by update(), at most 'budget' per call.
+  * Messages that could not be sent within 'maxLatency' ms are
+  * dropped rather than delivered late. Messages a controller sends
+  * itself are not forwarded, so nothing bounces between the buses.
+  */
+ class TrackBridge
+ {
+ private:
+   /**
+    * Listens on one of the two controllers.
+    */
+   class Side : public TrackListener
+   {
+   private:
+     TrackBridge &mBridge;
+     bool mFromA;
+
+   public:
+     Side(TrackBridge &bridge, bool fromA) : mBridge(bridge), mFromA(fromA) {}
+     void onMessage(const TrackMessage &message, bool outgoing) override;
+   };
+
+   struct Pending
+   {
+     TrackMessage message;
+     uint32_t time;
+     bool toB;
+   };
+
+   TrackController &mA;
+   TrackController &mB;
+   Side mSideA;
+   Side mSideB;
+   TrackRing<Pending, TRACK_BRIDGE_QUEUE_SIZE> mPending;
+   TrackBridgeFilter mFilter;
+   uint16_t mMaxLatency;
+   uint8_t mBudget;
+   uint32_t mForwarded;
+   uint32_t mFiltered;
+   uint32_t mDropped;
+
+   void receive(const TrackMessage &message, bool fromA);
+
+ public:
+   /**
+    * Connects the two controllers. 'budget' is the number of
+    * messages sent per update(), 'maxLatency' the time in ms a
+    * message may wait before it is dropped.
+    */
+   TrackBridge(TrackController &a, TrackController &b, uint8_t budget = 4, uint16_t maxLatency = 50);
+   ~TrackBridge();
+
+   /**
+    * Sets the filter applied to every received message. Without a
+    * filter, everything is forwarded.
+    */
+   void setFilter(TrackBridgeFilter filter) { mFilter = filter; }
+
+   /**
+    * Sends queued messages. Call this as often as possible from
+    * loop(), after the update() of both controllers.
+    */
+   void update();
+
+   uint32_t getForwarded() const { return mForwarded; }
+   uint32_t getFiltered() const { return mFiltered; }
+   uint32_t getDropped() const { return mDropped; }
+ };
+
+ #endif // TRACKBRIDGE_H
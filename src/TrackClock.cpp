@@ -0,0 +1,39 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackClock.h"
+
+#if defined ARDUINO
+#include <Arduino.h>
+#else
+#include <time.h>
+#endif
+
+/* -------------------------------------------------------------------
+   TrackClock::now
+-------------------------------------------------------------------  */
+
+uint32_t TrackClock::now()
+{
+#if defined ARDUINO
+    return micros();
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<uint32_t>(time.tv_sec) * 1000000UL + time.tv_nsec / 1000;
+#endif
+}
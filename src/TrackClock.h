@@ -0,0 +1,67 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKCLOCK_H
+ #define TRACKCLOCK_H
+
+ #include <stdint.h>
+
+ // ===================================================================
+ // === TrackClock ====================================================
+ // ===================================================================
+
+ /**
+  * The time base of the library: a monotonic microsecond counter,
+  * micros() on a microcontroller and clock_gettime() when built on a
+  * host. The counter is 32 bits wide and wraps every 71 minutes, so
+  * times must only be compared through reached() and before(), which
+  * stay correct across the wrap for spans of up to 35 minutes.
+  */
+ class TrackClock
+ {
+ public:
+   /**
+    * Returns the current time in microseconds.
+    */
+   static uint32_t now();
+
+   /**
+    * Returns the deadline lying 'micros' microseconds from 'start'.
+    */
+   static constexpr uint32_t deadline(uint32_t start, uint32_t micros)
+   {
+     return start + micros;
+   }
+
+   /**
+    * Tells whether 'deadline' has been reached at time 'now'.
+    */
+   static constexpr bool reached(uint32_t now, uint32_t deadline)
+   {
+     return static_cast<int32_t>(now - deadline) >= 0;
+   }
+
+   /**
+    * Tells whether time 'a' comes before time 'b'.
+    */
+   static constexpr bool before(uint32_t a, uint32_t b)
+   {
+     return static_cast<int32_t>(a - b) < 0;
+   }
+ };
+
+ #endif // TRACKCLOCK_H
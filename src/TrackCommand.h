@@ -0,0 +1,366 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKCOMMAND_H
+ #define TRACKCOMMAND_H
+
+ #include <Arduino.h>
+ #include "TrackMessage.h"
+ #include "Config.h"
+
+ // ===================================================================
+ // === TrackCommand ==================================================
+ // ===================================================================
+
+ /**
+  * Encodes and decodes the fields shared by all commands: the 29 bit
+  * CAN identifier and the 32 bit address in data[0..3]. Everything is
+  * constexpr, so a command built from constant arguments is folded
+  * into a constant by the compiler and costs no code at all.
+  *
+  * See https://streaming.maerklin.de/public-media/cs2/cs2CAN-Protokoll-2_0.pdf
+  * -> 1.1 Aufbau des Identifiers
+  */
+ class TrackCommand
+ {
+ public:
+     /**
+      * Returns the high and the low byte of a 16 bit value, in the
+      * order they are sent on the bus (big endian).
+      */
+     static constexpr uint8_t high(uint16_t value) { return (value >> 8) & 0xFF; }
+     static constexpr uint8_t low(uint16_t value) { return value & 0xFF; }
+
+     /**
+      * Packs the fields of a message into the 29 bit CAN identifier:
+      * prio in bits 25..28, command in bits 17..24, response flag in
+      * bit 16 and hash in bits 0..15.
+      */
+     static constexpr uint32_t canId(uint8_t prio, uint8_t command, bool response, uint16_t hash)
+     {
+         return (static_cast<uint32_t>(prio & 0x0F) << 25) | (static_cast<uint32_t>(command) << 17) | (static_cast<uint32_t>(response) << 16) | hash;
+     }
+     static constexpr uint32_t canId(const TrackMessage &message)
+     {
+         return canId(message.prio, message.command, message.response, message.hash);
+     }
+
+     /**
+      * Extracts the individual fields from a 29 bit CAN identifier.
+      */
+     static constexpr uint8_t prio(uint32_t id) { return (id >> 25) & 0x0F; }
+     static constexpr uint8_t command(uint32_t id) { return (id >> 17) & 0xFF; }
+     static constexpr bool response(uint32_t id) { return (id >> 16) & 0x01; }
+     static constexpr uint16_t hash(uint32_t id) { return id & 0xFFFF; }
+
+     /**
+      * Builds a message from its raw fields. The hash is left at zero,
+      * sendMessage() fills in the hash of the controller.
+      */
+     static constexpr TrackMessage make(uint8_t prio, uint8_t command, uint8_t length,
+                                        uint8_t d0 = 0, uint8_t d1 = 0, uint8_t d2 = 0, uint8_t d3 = 0,
+                                        uint8_t d4 = 0, uint8_t d5 = 0, uint8_t d6 = 0, uint8_t d7 = 0)
+     {
+         return TrackMessage{prio, command, false, 0, length, {d0, d1, d2, d3, d4, d5, d6, d7}};
+     }
+
+     /**
+      * Builds a message addressed to the given locomotive or accessory
+      * (data[2..3]) followed by up to four parameter bytes.
+      */
+     static constexpr TrackMessage forAddress(uint8_t command, uint8_t length, uint16_t address,
+                                              uint8_t d4 = 0, uint8_t d5 = 0, uint8_t d6 = 0, uint8_t d7 = 0)
+     {
+         return make(0x00, command, length, 0, 0, high(address), low(address), d4, d5, d6, d7);
+     }
+
+     /**
+      * Builds a message addressed to the device with the given UID
+      * (data[0..3]) followed by up to four parameter bytes.
+      */
+     static constexpr TrackMessage forUid(uint8_t command, uint8_t length, uint32_t uid,
+                                          uint8_t d4 = 0, uint8_t d5 = 0, uint8_t d6 = 0, uint8_t d7 = 0)
+     {
+         return make(0x00, command, length, (uid >> 24) & 0xFF, (uid >> 16) & 0xFF, (uid >> 8) & 0xFF, uid & 0xFF, d4, d5, d6, d7);
+     }
+
+     /**
+      * Returns the locomotive or accessory address of a message.
+      */
+     static constexpr uint16_t address(const TrackMessage &message)
+     {
+         return (static_cast<uint16_t>(message.data[2]) << 8) | message.data[3];
+     }
+
+     /**
+      * Returns the full 32 bit UID of a message (data[0..3]).
+      */
+     static constexpr uint32_t uid(const TrackMessage &message)
+     {
+         return (static_cast<uint32_t>(message.data[0]) << 24) | (static_cast<uint32_t>(message.data[1]) << 16) | (static_cast<uint32_t>(message.data[2]) << 8) | message.data[3];
+     }
+
+     /**
+      * Reports whether the message is a response to the given command.
+      */
+     static constexpr bool isResponse(const TrackMessage &message, uint8_t command)
+     {
+         return message.response && message.command == command;
+     }
+
+     /**
+      * Tells whether 'response' answers 'request': same command with
+      * the response bit set and, when the request carries a UID, the
+      * same UID. Pings are answered with the UID of each device.
+      */
+     static constexpr bool isResponseTo(const TrackMessage &request, const TrackMessage &response)
+     {
+         return isResponse(response, request.command) && (request.length < 4 || request.command == CMD_PING || uid(request) == uid(response));
+     }
+ };
+
+ // ===================================================================
+ // === Typed commands ================================================
+ // ===================================================================
+
+ /**
+  * Locomotive speed (0x04). Speeds are 0 to 1023 (inclusive).
+  */
+ class LocoSpeed
+ {
+ public:
+     static constexpr TrackMessage set(uint16_t address, uint16_t speed)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_SPEED, 6, address, TrackCommand::high(speed), TrackCommand::low(speed));
+     }
+     static constexpr TrackMessage get(uint16_t address)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_SPEED, 4, address);
+     }
+     static constexpr uint16_t speed(const TrackMessage &message)
+     {
+         return (static_cast<uint16_t>(message.data[4]) << 8) | message.data[5];
+     }
+ };
+
+ /**
+  * Locomotive direction (0x05). Directions are the DIR_* constants.
+  */
+ class LocoDirection
+ {
+ public:
+     static constexpr TrackMessage set(uint16_t address, uint8_t direction)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_DIR, 5, address, direction);
+     }
+     static constexpr TrackMessage get(uint16_t address)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_DIR, 4, address);
+     }
+     static constexpr uint8_t direction(const TrackMessage &message)
+     {
+         return message.data[4];
+     }
+ };
+
+ /**
+  * Locomotive function (0x06). Functions are 0 to 31, values 0 to 31.
+  */
+ class LocoFunction
+ {
+ public:
+     static constexpr TrackMessage set(uint16_t address, uint8_t function, uint8_t power)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_FUNC, 6, address, function, power);
+     }
+     static constexpr TrackMessage get(uint16_t address, uint8_t function)
+     {
+         return TrackCommand::forAddress(CMD_LOCO_FUNC, 5, address, function);
+     }
+     static constexpr uint8_t function(const TrackMessage &message)
+     {
+         return message.data[4];
+     }
+     static constexpr uint8_t power(const TrackMessage &message)
+     {
+         return message.data[5];
+     }
+ };
+
+ /**
+  * Magnetic accessory (0x0B). Positions are the ACC_* constants.
+  */
+ class Accessory
+ {
+ public:
+     static constexpr TrackMessage set(uint16_t address, uint8_t position, uint8_t power)
+     {
+         return TrackCommand::forAddress(CMD_ACCESSORY, 6, address, position, power);
+     }
+     static constexpr TrackMessage get(uint16_t address)
+     {
+         return TrackCommand::forAddress(CMD_ACCESSORY, 4, address);
+     }
+     static constexpr uint8_t position(const TrackMessage &message)
+     {
+         return message.data[4];
+     }
+     static constexpr uint8_t power(const TrackMessage &message)
+     {
+         return message.data[5];
+     }
+ };
+
+ /**
+  * Read config (0x07) and write config (0x08).
+  */
+ class LocoConfig
+ {
+ public:
+     static constexpr TrackMessage read(uint16_t address, uint16_t number, uint8_t count = 1)
+     {
+         return TrackCommand::forAddress(CMD_READ_CONFIG, 7, address, TrackCommand::high(number), TrackCommand::low(number), count);
+     }
+     static constexpr TrackMessage write(uint16_t address, uint16_t number, uint8_t value)
+     {
+         return TrackCommand::make(0x01, CMD_WRITE_CONFIG, 8, 0, 0, TrackCommand::high(address), TrackCommand::low(address),
+                                   TrackCommand::high(number), TrackCommand::low(number), value);
+     }
+     static constexpr uint8_t value(const TrackMessage &message)
+     {
+         return message.data[6];
+     }
+ };
+
+ /**
+  * System command (0x00) and its sub-commands (data[4]).
+  */
+ class SystemCommand
+ {
+ public:
+     static constexpr TrackMessage power(bool on)
+     {
+         return TrackCommand::make(0x00, CMD_SYSTEM, 5, 0, 0, 0, 0, on ? SYS_GO : SYS_STOP);
+     }
+     static constexpr TrackMessage halt(uint16_t address)
+     {
+         return TrackCommand::forAddress(CMD_SYSTEM, 5, address, SYS_HALT);
+     }
+     static constexpr TrackMessage emergency(uint16_t address)
+     {
+         return TrackCommand::forAddress(CMD_SYSTEM, 5, address, SYS_LOCO_STOP);
+     }
+     /**
+      * bit0 = MM2 - bit1 = MFX - bit2 = DCC
+      */
+     static constexpr TrackMessage protocol(uint8_t mask)
+     {
+         return TrackCommand::make(0x00, CMD_SYSTEM, 6, 0, 0, 0, 0, SYS_PROTOCOL, mask);
+     }
+     static constexpr TrackMessage mfxCounter(uint16_t counter)
+     {
+         return TrackCommand::make(0x00, CMD_SYSTEM, 7, 0, 0, 0, 0, SYS_MFX_COUNTER, TrackCommand::high(counter), TrackCommand::low(counter));
+     }
+     /**
+      * Asks the device with the given UID for the current value of a
+      * measurement channel. The response carries the raw value.
+      */
+     static constexpr TrackMessage status(uint32_t uid, uint8_t channel)
+     {
+         return TrackCommand::forUid(CMD_SYSTEM, 6, uid, SYS_STATUS, channel);
+     }
+     static constexpr uint8_t subcommand(const TrackMessage &message)
+     {
+         return message.data[4];
+     }
+     static constexpr uint8_t channel(const TrackMessage &message)
+     {
+         return message.data[5];
+     }
+     static constexpr uint16_t value(const TrackMessage &message)
+     {
+         return (static_cast<uint16_t>(message.data[6]) << 8) | message.data[7];
+     }
+ };
+
+ /**
+  * Status data configuration (0x1D): the description of a device
+  * (index 0) or of one of its measurement channels (index 1..n). The
+  * answer comes as a series of 8 byte frames whose hash field holds
+  * the packet number, 1 for the first, followed by a 6 byte frame
+  * with the UID, the index and the number of packets.
+  */
+ class StatusConfig
+ {
+ public:
+     static constexpr TrackMessage request(uint32_t uid, uint8_t index)
+     {
+         return TrackCommand::forUid(CMD_STATUS_CONFIG, 5, uid, index);
+     }
+     static constexpr uint8_t index(const TrackMessage &message)
+     {
+         return message.data[4];
+     }
+     static constexpr uint8_t packets(const TrackMessage &message)
+     {
+         return message.data[5];
+     }
+ };
+
+ /**
+  * Feedback contact event (0x11), as sent by S88 modules. The new
+  * state is 1 when the contact is occupied, 0 when it is free.
+  */
+ class FeedbackEvent
+ {
+ public:
+     static constexpr TrackMessage make(uint16_t device, uint16_t contact, uint8_t state)
+     {
+         return TrackCommand::make(0x00, CMD_S88_EVENT, 6, TrackCommand::high(device), TrackCommand::low(device),
+                                   TrackCommand::high(contact), TrackCommand::low(contact), state ? 0 : 1, state);
+     }
+     static constexpr uint16_t device(const TrackMessage &message)
+     {
+         return (static_cast<uint16_t>(message.data[0]) << 8) | message.data[1];
+     }
+     static constexpr uint16_t contact(const TrackMessage &message)
+     {
+         return TrackCommand::address(message);
+     }
+     static constexpr uint8_t state(const TrackMessage &message)
+     {
+         return message.data[5];
+     }
+ };
+
+ /**
+  * Ping (0x18) and bootloader wake-up (0x1B).
+  */
+ class DeviceCommand
+ {
+ public:
+     static constexpr TrackMessage ping()
+     {
+         return TrackCommand::make(0x00, CMD_PING, 0);
+     }
+     static constexpr TrackMessage wakeUp()
+     {
+         return TrackCommand::make(0x00, CMD_BOOTLOADER, 5, 0, 0, 0, 0, 0x11);
+     }
+ };
+
+ #endif // TRACKCOMMAND_H
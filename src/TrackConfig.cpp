@@ -0,0 +1,193 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackConfig.h"
+#include "TrackCrc.h"
+
+static const uint8_t HEADER_SIZE = 4;
+static const uint8_t SECTION_SIZE = 3;
+static const uint8_t ENTRY_SIZE = 2 + TrackConfig::NAME_SIZE;
+static const uint8_t STEPS_SIZE = 3;
+static const uint8_t MEMBER_SIZE = 5;
+static const uint8_t EDGE_SIZE = 9;
+
+static const uint8_t KIND_CONTROLLER = 'H';
+static const uint8_t KIND_LOCOS = 'L';
+static const uint8_t KIND_ACCESSORIES = 'A';
+static const uint8_t KIND_STEPS = 'S';
+static const uint8_t KIND_CONSISTS = 'C';
+static const uint8_t KIND_LAYOUT = 'G';
+
+/* -------------------------------------------------------------------
+   word16
+-------------------------------------------------------------------  */
+
+static inline uint16_t word16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* -------------------------------------------------------------------
+   TrackConfig (constructor)
+-------------------------------------------------------------------  */
+
+TrackConfig::TrackConfig(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mLocos(nullptr),
+      mLayout(nullptr),
+      mLocoCount(0),
+      mAccessoryCount(0)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackConfig::check
+
+   Walks the sections once without taking anything, so a table that
+   is cut short, corrupt or too large for this build is refused as a
+   whole.
+-------------------------------------------------------------------  */
+
+bool TrackConfig::check(const uint8_t *table, uint16_t size) const
+{
+    if (size < HEADER_SIZE + 2 || table[0] != 'R' || table[1] != 'C' || table[2] != VERSION)
+        return false;
+    if (TrackCrc::ccitt(table, size - 2) != word16(table + size - 2))
+        return false;
+
+    const uint8_t *p = table + HEADER_SIZE;
+    const uint8_t *end = table + size - 2;
+    for (uint8_t s = 0; s < table[3]; s++)
+    {
+        if (end - p < SECTION_SIZE || end - p - SECTION_SIZE < word16(p + 1))
+            return false;
+
+        const uint8_t kind = p[0];
+        const uint16_t length = word16(p + 1);
+        const uint8_t *data = p + SECTION_SIZE;
+        p = data + length;
+
+        if (kind == KIND_CONTROLLER && length != 4)
+            return false;
+        if (kind == KIND_LOCOS && (length % ENTRY_SIZE != 0 || length / ENTRY_SIZE > TRACK_MAX_LOCOS))
+            return false;
+        if (kind == KIND_ACCESSORIES && (length % ENTRY_SIZE != 0 || length / ENTRY_SIZE > TRACK_CONFIG_ACCESSORIES))
+            return false;
+        if (kind == KIND_STEPS && (length % STEPS_SIZE != 0 || length / STEPS_SIZE > 5))
+            return false;
+
+        if (kind == KIND_CONSISTS)
+        {
+            uint8_t members[TRACK_MAX_CONSISTS] = {0};
+            if (length % MEMBER_SIZE != 0)
+                return false;
+            for (const uint8_t *m = data; m < p; m += MEMBER_SIZE)
+                if (m[0] >= TRACK_MAX_CONSISTS || ++members[m[0]] > TRACK_CONSIST_SIZE || word16(m + 1) == 0)
+                    return false;
+        }
+
+        if (kind == KIND_LAYOUT)
+        {
+            // The checks of TrackLayout::load, so a layout it would refuse is caught here
+            if (length < 5 || data[0] != 'L' || data[1] != 'G' || data[2] != TrackLayout::VERSION ||
+                data[3] > TRACK_LAYOUT_BLOCKS || data[4] > TRACK_LAYOUT_EDGES ||
+                length != 5 + 2 * data[3] + EDGE_SIZE * data[4])
+                return false;
+            for (const uint8_t *e = data + 5 + 2 * data[3]; e < p; e += EDGE_SIZE)
+                if (e[0] >= data[3] || e[1] >= data[3])
+                    return false;
+        }
+    }
+    return p == end;
+}
+
+/* -------------------------------------------------------------------
+   TrackConfig::copyEntries
+-------------------------------------------------------------------  */
+
+uint8_t TrackConfig::copyEntries(const uint8_t *p, uint16_t length, Entry *entries)
+{
+    const uint8_t count = length / ENTRY_SIZE;
+    for (uint8_t i = 0; i < count; i++, p += ENTRY_SIZE)
+    {
+        entries[i].address = word16(p);
+        memcpy(entries[i].name, p + 2, NAME_SIZE);
+        entries[i].name[NAME_SIZE] = '\0';
+    }
+    return count;
+}
+
+/* -------------------------------------------------------------------
+   TrackConfig::load
+-------------------------------------------------------------------  */
+
+bool TrackConfig::load(const uint8_t *table, uint16_t size)
+{
+    if (!check(table, size))
+        return false;
+
+    const uint8_t *p = table + HEADER_SIZE;
+    for (uint8_t s = 0; s < table[3]; s++)
+    {
+        const uint8_t kind = p[0];
+        const uint16_t length = word16(p + 1);
+        const uint8_t *data = p + SECTION_SIZE;
+        p = data + length;
+
+        if (kind == KIND_CONTROLLER)
+        {
+            if (word16(data) != 0)
+                mCtrl.setHash(word16(data));
+            if (word16(data + 2) != 0)
+                mCtrl.setTimeout(word16(data + 2));
+        }
+        else if (kind == KIND_LOCOS)
+            mLocoCount = copyEntries(data, length, mLocoEntries);
+        else if (kind == KIND_ACCESSORIES)
+            mAccessoryCount = copyEntries(data, length, mAccessoryEntries);
+        else if (kind == KIND_STEPS && mLocos != nullptr)
+        {
+            for (const uint8_t *r = data; r < p; r += STEPS_SIZE)
+                mLocos->setSteps(word16(r), r[2]);
+        }
+        else if (kind == KIND_CONSISTS)
+        {
+            for (uint8_t c = 0; c < TRACK_MAX_CONSISTS; c++)
+                mCtrl.clearConsist(c);
+            for (const uint8_t *m = data; m < p; m += MEMBER_SIZE)
+                mCtrl.addToConsist(m[0], word16(m + 1), m[3] != 0, m[4]);
+        }
+        else if (kind == KIND_LAYOUT && mLayout != nullptr)
+            mLayout->load(data, length);
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackConfig::nameOf
+-------------------------------------------------------------------  */
+
+const char *TrackConfig::nameOf(uint16_t address) const
+{
+    for (uint8_t i = 0; i < mLocoCount; i++)
+        if (mLocoEntries[i].address == address)
+            return mLocoEntries[i].name;
+    for (uint8_t i = 0; i < mAccessoryCount; i++)
+        if (mAccessoryEntries[i].address == address)
+            return mAccessoryEntries[i].name;
+    return nullptr;
+}
@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKCONFIG_H
+ #define TRACKCONFIG_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackLocoTable.h"
+ #include "TrackLayout.h"
+
+ // ===================================================================
+ // === TrackConfig ===================================================
+ // ===================================================================
+
+ /**
+  * The configuration of a layout, compiled by tools/layoutconfig.py
+  * into a binary table, so it can be changed by uploading a file
+  * instead of a new firmware. The table is big endian like the CAN
+  * frames, and made of sections:
+  *
+  *   'R' 'C' version sections
+  *   sections x (kind length:16 payload)
+  *   crc:16                               CRC-16/CCITT of all before
+  *
+  *   'H'  hash:16 timeout:16              0 keeps the one set in code
+  *   'L'  locos x (address:16 name[12])   names padded with zeros
+  *   'A'  accessories x (address:16 name[12])
+  *   'S'  up to 5 x (base:16 steps)       see TrackLocoTable::setSteps
+  *   'C'  members x (consist address:16 inverted trim)
+  *   'G'  a TrackLayout table, with the contact of each block
+  *
+  * load() checks the whole table before it takes anything from it,
+  * then copies the records into fixed tables and hands them to the
+  * controller, the loco table and the layout: no text is parsed on
+  * the board. Sections of unknown kind are skipped, so an older
+  * firmware reads a newer table of the same version.
+  */
+ class TrackConfig
+ {
+ public:
+   static const uint8_t VERSION = 1;
+   static const uint8_t NAME_SIZE = 12;
+
+   /**
+    * A loco or accessory with the name shown to the user.
+    */
+   struct Entry
+   {
+     uint16_t address;
+     char name[NAME_SIZE + 1];
+   };
+
+   /**
+    * The largest table load() can take, sections of unknown kind
+    * aside.
+    */
+   static const uint16_t MAX_SIZE = 4 + 2 +
+                                    3 + 4 +
+                                    3 + (2 + NAME_SIZE) * TRACK_MAX_LOCOS +
+                                    3 + (2 + NAME_SIZE) * TRACK_CONFIG_ACCESSORIES +
+                                    3 + 3 * 5 +
+                                    3 + 5 * TRACK_MAX_CONSISTS * TRACK_CONSIST_SIZE +
+                                    3 + 5 + 2 * TRACK_LAYOUT_BLOCKS + 9 * TRACK_LAYOUT_EDGES;
+
+ private:
+   TrackController &mCtrl;
+   TrackLocoTable *mLocos;
+   TrackLayout *mLayout;
+   Entry mLocoEntries[TRACK_MAX_LOCOS];
+   Entry mAccessoryEntries[TRACK_CONFIG_ACCESSORIES];
+   uint8_t mLocoCount;
+   uint8_t mAccessoryCount;
+
+   bool check(const uint8_t *table, uint16_t size) const;
+   static uint8_t copyEntries(const uint8_t *p, uint16_t length, Entry *entries);
+
+ public:
+   TrackConfig(TrackController &ctrl);
+
+   /**
+    * Hands the speed steps to the given loco table, nullptr for none.
+    * Set it before load().
+    */
+   void setLocos(TrackLocoTable *locos) { mLocos = locos; }
+
+   /**
+    * Loads the graph and feedback contacts into the given layout,
+    * nullptr for none. Set it before load().
+    */
+   void setLayout(TrackLayout *layout) { mLayout = layout; }
+
+   /**
+    * Takes the configuration from a table of 'size' bytes, usually a
+    * file read in full. Call it in setup(), before
+    * TrackController::begin(). Returns false, and changes nothing, if
+    * the table is not valid or does not fit the tables.
+    */
+   bool load(const uint8_t *table, uint16_t size);
+
+   uint8_t getLocoCount() const { return mLocoCount; }
+   const Entry &getLoco(uint8_t index) const { return mLocoEntries[index]; }
+
+   uint8_t getAccessoryCount() const { return mAccessoryCount; }
+   const Entry &getAccessory(uint8_t index) const { return mAccessoryEntries[index]; }
+
+   /**
+    * Returns the name of a loco or accessory, nullptr if it has none.
+    */
+   const char *nameOf(uint16_t address) const;
+ };
+
+ #endif // TRACKCONFIG_H
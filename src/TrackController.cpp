@@ -17,20 +17,33 @@
  */
 
 #include "TrackController.h"
+#include "TrackLocoTable.h"
+#include "TrackAccessoryTable.h"
+#include "TrackCommand.h"
+
+/* -------------------------------------------------------------------
+   defaultTransport
+
+   The transport of controllers created without one: the built-in
+   CAN controller on ESP32, an MCP2515 on pins 10 (CS) and 2 (INT) on
+   AVR. Created on first use, so sketches passing their own transport
+   do not pay for it.
+-------------------------------------------------------------------  */
 
 #if defined ARDUINO_ARCH_ESP32
-#include <ACAN_ESP32.h> // https://github.com/pierremolinaro/acan-esp32.git
-#include <Arduino.h>
+static TrackTransportESP32 &defaultTransport()
+{
+    static TrackTransportESP32 transport;
+    return transport;
+}
 #elif defined ARDUINO_ARCH_AVR
-#include <ACAN2515.h> // https://github.com/pierremolinaro/acan2515.git
-static const uint32_t QUARTZ_FREQUENCY = 16UL * 1000UL * 1000UL; // 16 MHz
-static const byte MCP2515_INT = 2;                               // INT output of MCP2515 (adapt to your design)
-static const byte MCP2515_CS = 10;                               // CS input of MCP2515 (adapt to your design)
-ACAN2515 can(MCP2515_CS, SPI, MCP2515_INT);
+static TrackTransportMCP2515 &defaultTransport()
+{
+    static TrackTransportMCP2515 transport(10, 2); // Adapt to your design
+    return transport;
+}
 #endif
 
-static const uint32_t DESIRED_BIT_RATE = 250UL * 1000UL; // Marklin CAN baudrate = 250Kbit/s
-
 /* -------------------------------------------------------------------
    TrackController (constructor / destructor)
 -------------------------------------------------------------------  */
@@ -39,45 +52,110 @@ TrackController::TrackController()
     : mHash(0),
       mDebug(false),
       mLoopback(false),
-      mTimeout(1000)
+      mTimeout(1000),
+      mListenerCount(0),
+      mTransport(&defaultTransport()),
+      mLatency(0),
+      mTimeouts(nullptr),
+      mRetry(nullptr),
+      mSupervisor(nullptr),
+      mProxyLocos(nullptr),
+      mProxyAccessories(nullptr),
+      mProxyHits(0),
+      mProxyMisses(0)
 {
+    memset(mConsists, 0x00, sizeof(mConsists));
     if (mDebug)
-        Serial.println("### Creating controller");
+        Serial.println(F("### Creating controller"));
 }
 TrackController::TrackController(uint64_t timeOut)
     : mHash(0),
       mDebug(false),
       mLoopback(false),
-      mTimeout(timeOut)
+      mTimeout(timeOut),
+      mListenerCount(0),
+      mTransport(&defaultTransport()),
+      mLatency(0),
+      mTimeouts(nullptr),
+      mRetry(nullptr),
+      mSupervisor(nullptr),
+      mProxyLocos(nullptr),
+      mProxyAccessories(nullptr),
+      mProxyHits(0),
+      mProxyMisses(0)
 {
+    memset(mConsists, 0x00, sizeof(mConsists));
     if (mDebug)
-        Serial.println("### Creating controller");
+        Serial.println(F("### Creating controller"));
 }
 
 TrackController::TrackController(uint16_t hash, bool debug, uint64_t timeOut)
     : mHash(hash),
       mDebug(debug),
       mLoopback(false),
-      mTimeout(timeOut)
+      mTimeout(timeOut),
+      mListenerCount(0),
+      mTransport(&defaultTransport()),
+      mLatency(0),
+      mTimeouts(nullptr),
+      mRetry(nullptr),
+      mSupervisor(nullptr),
+      mProxyLocos(nullptr),
+      mProxyAccessories(nullptr),
+      mProxyHits(0),
+      mProxyMisses(0)
 {
+    memset(mConsists, 0x00, sizeof(mConsists));
     if (mDebug)
-        Serial.println("### Creating controller with param");
+        Serial.println(F("### Creating controller with param"));
 }
 
 TrackController::TrackController(uint16_t hash, bool debug, uint64_t timeOut, bool loopback)
     : mHash(hash),
       mDebug(debug),
       mLoopback(loopback),
-      mTimeout(timeOut)
+      mTimeout(timeOut),
+      mListenerCount(0),
+      mTransport(&defaultTransport()),
+      mLatency(0),
+      mTimeouts(nullptr),
+      mRetry(nullptr),
+      mSupervisor(nullptr),
+      mProxyLocos(nullptr),
+      mProxyAccessories(nullptr),
+      mProxyHits(0),
+      mProxyMisses(0)
+{
+    memset(mConsists, 0x00, sizeof(mConsists));
+    if (mDebug)
+        Serial.println(F("### Creating controller with param"));
+}
+
+TrackController::TrackController(TrackTransport &transport, uint16_t hash, bool debug, uint64_t timeOut)
+    : mHash(hash),
+      mDebug(debug),
+      mLoopback(false),
+      mTimeout(timeOut),
+      mListenerCount(0),
+      mTransport(&transport),
+      mLatency(0),
+      mTimeouts(nullptr),
+      mRetry(nullptr),
+      mSupervisor(nullptr),
+      mProxyLocos(nullptr),
+      mProxyAccessories(nullptr),
+      mProxyHits(0),
+      mProxyMisses(0)
 {
+    memset(mConsists, 0x00, sizeof(mConsists));
     if (mDebug)
-        Serial.println("### Creating controller with param");
+        Serial.println(F("### Creating controller with transport"));
 }
 
 TrackController::~TrackController() // Destructeur
 {
     if (mDebug)
-        Serial.println("### Destroying controller");
+        Serial.println(F("### Destroying controller"));
 }
 
 /* -------------------------------------------------------------------
@@ -103,6 +181,24 @@ uint16_t TrackController::getHash()
     return mHash;
 }
 
+/* -------------------------------------------------------------------
+   TrackController::setHash
+-------------------------------------------------------------------  */
+
+void TrackController::setHash(uint16_t hash)
+{
+    mHash = hash;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::setTimeout
+-------------------------------------------------------------------  */
+
+void TrackController::setTimeout(uint32_t timeOut)
+{
+    mTimeout = timeOut;
+}
+
 /* -------------------------------------------------------------------
    TrackController::isDebug
 -------------------------------------------------------------------  */
@@ -130,54 +226,25 @@ void TrackController::begin(const byte can_rx_pin, const byte can_tx_pin)
     //--- Configure CAN
 
 #if defined ARDUINO_ARCH_ESP32
-    Serial.println("Configure ESP32 CAN");
-    ACAN_ESP32_Settings settings(DESIRED_BIT_RATE); // Marklin CAN baudrate = 250Kbit/s
-    settings.mRxPin = (gpio_num_t)can_rx_pin;
-    settings.mTxPin = (gpio_num_t)can_tx_pin;
-    const uint32_t errorCode = ACAN_ESP32::can.begin(settings);
-#elif defined ARDUINO_ARCH_AVR
-    //--- Begin SPI
-    SPI.begin();
-    Serial.println("Configure ACAN2515");
-    ACAN2515Settings settings(QUARTZ_FREQUENCY, DESIRED_BIT_RATE);
-    const uint16_t errorCode = can.begin(settings, []
-                                         { can.isr(); });
+    if (mTransport == &defaultTransport())
+        defaultTransport().setPins(can_rx_pin, can_tx_pin);
 #endif
 
+    const uint32_t errorCode = mTransport->begin();
+
     if (errorCode)
     {
-        Serial.print("Configuration error 0x");
+        Serial.print(F("Configuration error 0x"));
         Serial.println(errorCode, HEX);
     }
-    else
-    {
-        Serial.print("Bit Rate prescaler: ");
-        Serial.println(settings.mBitRatePrescaler);
-        Serial.print("Triple Sampling: ");
-        Serial.println(settings.mTripleSampling ? "yes" : "no");
-        Serial.print("Actual bit rate: ");
-        Serial.print(settings.actualBitRate());
-        Serial.println(" bit/s");
-        Serial.print("Exact bit rate ? ");
-        Serial.println(settings.exactBitRate() ? "yes" : "no");
-        Serial.print("Sample point: ");
-        Serial.print(settings.samplePointFromBitStart());
-        Serial.println("%");
-    }
-    Serial.println("Configuration CAN OK");
-    Serial.println("");
+    Serial.println(F("Configuration CAN OK"));
+    Serial.println(F(""));
 
     delay(500);
 
     if (!mLoopback)
     {
-        TrackMessage message;
-        message.clear();
-        message.prio = 0x00;
-        message.command = 0x1B;
-        message.response = false;
-        message.length = 5;
-        message.data[4] = 0x11;
+        TrackMessage message = DeviceCommand::wakeUp();
         sendMessage(message);
     }
 
@@ -205,44 +272,80 @@ void TrackController::begin(const byte can_rx_pin, const byte can_tx_pin)
 -------------------------------------------------------------------  */
 
 bool TrackController::sendMessage(TrackMessage &message)
+{
+    message.hash = mHash;
+    return forwardMessage(message);
+}
+
+/* -------------------------------------------------------------------
+   TrackController::forwardMessage
+-------------------------------------------------------------------  */
+
+bool TrackController::forwardMessage(const TrackMessage &message)
+{
+    return transmit(message) != SEND_FAILED;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::transmit
+-------------------------------------------------------------------  */
+
+uint8_t TrackController::transmit(const TrackMessage &message)
 {
     CANMessage frame;
 
-    message.hash = mHash;
-    frame.id = (static_cast<uint32_t>(message.prio) << 25) | (static_cast<uint32_t>(message.command) << 17) | (static_cast<uint32_t>(message.response) << 16) | message.hash;
-    frame.ext = true;
-    frame.len = message.length;
-    for (byte i = 0; i < message.length; i++)
-        frame.data[i] = message.data[i];
+    TrackFrameView(frame).fromMessage(message);
 
     if (mDebug)
     {
-        Serial.print("<== ID : 0x");
+        Serial.print(F("<== ID : 0x"));
         Serial.println(frame.id, HEX);
-        Serial.print("EXT : ");
-        Serial.println(frame.ext ? "extended" : "standard");
-        Serial.print("RESP : ");
+        Serial.print(F("EXT : "));
+        Serial.println(frame.ext ? F("extended") : F("standard"));
+        Serial.print(F("RESP : "));
         Serial.println((frame.id & 0x10000) >> 16);
-        Serial.print("DLC : ");
+        Serial.print(F("DLC : "));
         Serial.println(frame.len);
-        Serial.print("COMMAND : 0x");
+        Serial.print(F("COMMAND : 0x"));
         TrackMessage::printHex(Serial, (frame.id & 0x1FE0000) >> 17, 2);
-        Serial.print("\nDATA : ");
+        Serial.print(F("\nDATA : "));
         for (uint8_t i = 0; i < frame.len; i++)
         {
-            Serial.print("0x");
+            Serial.print(F("0x"));
             TrackMessage::printHex(Serial, frame.data[i], 2);
             if (i < frame.len - 1)
-                Serial.print(" - ");
+                Serial.print(F(" - "));
         }
-        Serial.print("\n------------------------------------------------------------------\n");
+        Serial.print(F("\n------------------------------------------------------------------\n"));
     }
 
-#if defined(ARDUINO_ARCH_ESP32)
-    return ACAN_ESP32::can.tryToSend(frame);
-#elif defined(ARDUINO_ARCH_AVR)
-    return can.tryToSend(frame);
-#endif
+    uint8_t result = SEND_FAILED;
+    if (mSupervisor == nullptr)
+    {
+        if (mTransport->tryToSend(frame))
+            result = SEND_DONE;
+    }
+    else
+    {
+        if (mSupervisor->check(*mTransport, false))
+        {
+            mSupervisor->release(*mTransport); // Held frames first, or this one overtakes them
+            if (mSupervisor->getHeld() == 0 && mTransport->tryToSend(frame))
+                result = SEND_DONE;
+        }
+        if (result == SEND_FAILED)
+        {
+            mSupervisor->check(*mTransport, true);
+            if (mSupervisor->hold(frame))
+                result = SEND_HELD;
+        }
+    }
+
+    // Only frames that go out, now or once the bus is back: the
+    // tables must not learn a state the layout never got
+    if (result != SEND_FAILED)
+        notifyListeners(message, true);
+    return result;
 }
 
 /* -------------------------------------------------------------------
@@ -254,65 +357,90 @@ bool TrackController::receiveMessage(TrackMessage &message)
 
     CANMessage frame;
 
-#if defined(ARDUINO_ARCH_ESP32)
-    bool result = ACAN_ESP32::can.receive(frame);
-#elif defined(ARDUINO_AVR_UNO) || defined(ARDUINO_AVR_MEGA2560)
-    bool result = can.receive(frame);
-#endif
+    bool result = mInjected.pop(frame);
+
+    if (!result)
+        result = mTransport->receive(frame);
 
     if (result)
     {
         if (mDebug)
         {
-            Serial.print("==> ID : 0x");
+            Serial.print(F("==> ID : 0x"));
             Serial.println(frame.id, HEX);
-            Serial.print("EXT : ");
-            Serial.println(frame.ext ? "extended" : "standard");
-            Serial.print("RESP : ");
+            Serial.print(F("EXT : "));
+            Serial.println(frame.ext ? F("extended") : F("standard"));
+            Serial.print(F("RESP : "));
             Serial.println((frame.id & 0x10000) >> 16);
-            Serial.print("DLC : ");
+            Serial.print(F("DLC : "));
             Serial.println(frame.len);
-            Serial.print("COMMAND : 0x");
+            Serial.print(F("COMMAND : 0x"));
             TrackMessage::printHex(Serial, (frame.id & 0x1FE0000) >> 17, 2);
-            Serial.print("\nDATA : ");
+            Serial.print(F("\nDATA : "));
             for (uint8_t i = 0; i < frame.len; i++)
             {
-                Serial.print("0x");
+                Serial.print(F("0x"));
                 TrackMessage::printHex(Serial, frame.data[i], 2);
                 if (i < frame.len - 1)
-                    Serial.print(" - ");
+                    Serial.print(F(" - "));
             }
-            Serial.print("\n------------------------------------------------------------------\n");
+            Serial.print(F("\n------------------------------------------------------------------\n"));
         }
 
-        message.clear();
-        message.command = (frame.id >> 17) & 0xFF;
-        message.hash = frame.id & 0xFFFF;
-        message.response = (frame.id >> 16) & 0x01;
-        message.length = frame.len;
-
-        for (uint8_t i = 0; i < frame.len; i++)
-            message.data[i] = frame.data[i];
+        TrackFrameView(frame).toMessage(message);
+        notifyListeners(message, false);
 
         // if (mDebug) {
-        //   Serial.print("<== 0x");
+        //   Serial.print(F("<== 0x"));
         //   Serial.println(frame.id, HEX);
         // }
     }
     return result;
 }
 
+/* -------------------------------------------------------------------
+   TrackController::injectMessage
+-------------------------------------------------------------------  */
+
+bool TrackController::injectMessage(const TrackMessage &message)
+{
+    CANMessage frame;
+    TrackFrameView(frame).fromMessage(message);
+    return mInjected.push(frame);
+}
+
 /* -------------------------------------------------------------------
    TrackController::exchangeMessage
 -------------------------------------------------------------------  */
 
 bool TrackController::exchangeMessage(TrackMessage &out, TrackMessage &in, uint16_t timeout)
 {
+    return exchangeMessageMicros(out, in, timeout * 1000UL);
+}
 
-    uint16_t command = out.command;
+/* -------------------------------------------------------------------
+   TrackController::exchangeMessageMicros
+-------------------------------------------------------------------  */
 
-    if (!sendMessage(out))
+bool TrackController::exchangeMessageMicros(TrackMessage &out, TrackMessage &in, uint32_t timeout)
+{
+
+    const TrackMessage request = out; // 'in' may overwrite 'out'
+    const uint32_t start = TrackClock::now();
+
+    out.hash = mHash;
+    if (transmit(out) != SEND_DONE)
     {
+        // With a supervisor the frame is held until the bus is back
+        // (or dropped if it is a query): no response can come now,
+        // and halting would keep the bus from ever recovering
+        if (mSupervisor != nullptr)
+        {
+            if (mDebug)
+                Serial.println(F("!!! Send held"));
+            return false;
+        }
+
         if (mDebug)
         {
             Serial.println(F("!!! Send error"));
@@ -323,26 +451,324 @@ bool TrackController::exchangeMessage(TrackMessage &out, TrackMessage &in, uint1
         }
     }
 
-    // uint32_t time = millis();
-    uint64_t time = millis();
+    if (awaitResponse(request, in, TrackClock::deadline(start, timeout)))
+    {
+        mLatency = TrackClock::now() - start;
+        if (mTimeouts != nullptr)
+            mTimeouts->sample(request, mLatency);
+        return true;
+    }
 
-    /* -- TrackMessage response -- */
+    if (mTimeouts != nullptr)
+        mTimeouts->expired(request);
+
+    if (mDebug)
+        Serial.println(F("!!! Receive timeout"));
 
-    while (millis() < time + timeout)
+    return false;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::awaitResponse
+-------------------------------------------------------------------  */
+
+bool TrackController::awaitResponse(const TrackMessage &request, TrackMessage &in, uint32_t deadline)
+{
+    do
     {
         in.clear();
-        boolean result = receiveMessage(in);
+        if (receiveMessage(in) && TrackCommand::isResponseTo(request, in))
+            return true;
+    } while (!TrackClock::reached(TrackClock::now(), deadline));
+
+    return false;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::request
+-------------------------------------------------------------------  */
+
+bool TrackController::request(TrackMessage &message)
+{
+    if (answerQuery(message))
+        return true;
+
+    const TrackMessage original = message;
+
+    if (exchangeMessageMicros(message, message, timeoutFor(original)))
+        return true;
+
+    if (mRetry == nullptr)
+        return false;
+
+    if (!mRetry->isRetryable(original))
+    {
+        mRetry->countRefused();
+        return false;
+    }
 
-        if (result && in.command == command && in.response)
+    for (uint8_t retry = 1; retry < mRetry->getAttempts(); retry++)
+    {
+        // A late response may still come in while backing off
+        const uint32_t wait = mRetry->getBackoff(retry);
+        if (awaitResponse(original, message, TrackClock::deadline(TrackClock::now(), wait)))
+        {
+            mRetry->countRecovered();
+            return true;
+        }
+
+        message = original;
+        mRetry->countRetry();
+        if (exchangeMessageMicros(message, message, timeoutFor(original)))
+        {
+            mRetry->countRecovered();
             return true;
+        }
     }
 
-    if (mDebug)
-        Serial.println(F("!!! Receive timeout"));
+    mRetry->countFailure();
+    return false;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::setProxy
+-------------------------------------------------------------------  */
+
+void TrackController::setProxy(TrackLocoTable *locos, TrackAccessoryTable *accessories)
+{
+    mProxyLocos = locos;
+    mProxyAccessories = accessories;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::answerQuery
+-------------------------------------------------------------------  */
+
+bool TrackController::answerQuery(TrackMessage &message)
+{
+    if (message.response || (mProxyLocos == nullptr && mProxyAccessories == nullptr))
+        return false;
+
+    const uint16_t address = TrackCommand::address(message);
+    bool known = false;
+
+    // Queries are the commands without their value byte(s)
+    switch (message.command)
+    {
+    case CMD_LOCO_SPEED:
+    {
+        uint16_t speed;
+        if (message.length != 4)
+            return false;
+        known = mProxyLocos != nullptr && mProxyLocos->getSpeed(address, &speed);
+        if (known)
+        {
+            message.length = 6;
+            message.data[4] = TrackCommand::high(speed);
+            message.data[5] = TrackCommand::low(speed);
+        }
+        break;
+    }
+    case CMD_LOCO_DIR:
+    {
+        uint8_t direction;
+        if (message.length != 4)
+            return false;
+        known = mProxyLocos != nullptr && mProxyLocos->getDirection(address, &direction);
+        if (known)
+        {
+            message.length = 5;
+            message.data[4] = direction;
+        }
+        break;
+    }
+    case CMD_LOCO_FUNC:
+    {
+        uint32_t functions;
+        uint32_t bits;
+        const uint8_t function = LocoFunction::function(message);
+        if (message.length != 5)
+            return false;
+        known = mProxyLocos != nullptr && function < 32 && mProxyLocos->getFunctions(address, &functions, &bits) &&
+                (bits & (1UL << function)) != 0;
+        if (known)
+        {
+            message.length = 6;
+            message.data[5] = (functions >> function) & 0x01;
+        }
+        break;
+    }
+    case CMD_ACCESSORY:
+    {
+        uint8_t position;
+        uint8_t power;
+        if (message.length != 4)
+            return false;
+        known = mProxyAccessories != nullptr && mProxyAccessories->getPosition(address, &position, &power);
+        if (known)
+        {
+            message.length = 6;
+            message.data[4] = position;
+            message.data[5] = power;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    if (!known)
+    {
+        mProxyMisses++;
+        return false;
+    }
 
+    message.response = true;
+    mProxyHits++;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::awaitResponses
+-------------------------------------------------------------------  */
+
+uint8_t TrackController::awaitResponses(const TrackMessage *messages, uint8_t count, uint8_t pending, uint32_t start, uint32_t deadline)
+{
+    TrackMessage in;
+
+    do
+    {
+        if (!receiveMessage(in) || !in.response)
+            continue;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if ((pending & (1 << i)) && TrackCommand::isResponseTo(messages[i], in))
+            {
+                pending &= ~(1 << i);
+                if (mTimeouts != nullptr)
+                    mTimeouts->sample(messages[i], TrackClock::now() - start);
+                break;
+            }
+        }
+    } while (pending != 0 && !TrackClock::reached(TrackClock::now(), deadline));
+
+    return pending;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::fanOut
+-------------------------------------------------------------------  */
+
+bool TrackController::fanOut(TrackMessage *messages, uint8_t count)
+{
+    if (count == 0)
+        return false; // Empty consist
+
+    uint8_t pending = (1 << count) - 1;
+
+    for (uint8_t attempt = 1;; attempt++)
+    {
+        // All frames first, so the locos get them within a few frame times
+        const uint32_t start = TrackClock::now();
+        uint32_t timeout = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if ((pending & (1 << i)) == 0)
+                continue;
+            TrackMessage message = messages[i];
+            sendMessage(message);
+            const uint32_t own = timeoutFor(messages[i]);
+            if (own > timeout)
+                timeout = own;
+        }
+
+        pending = awaitResponses(messages, count, pending, start, TrackClock::deadline(start, timeout));
+        if (pending == 0)
+        {
+            if (attempt > 1)
+                mRetry->countRecovered();
+            return true;
+        }
+
+        if (mTimeouts != nullptr)
+            for (uint8_t i = 0; i < count; i++)
+                if (pending & (1 << i))
+                    mTimeouts->expired(messages[i]);
+
+        if (mRetry == nullptr)
+            return false;
+        if (!mRetry->isRetryable(messages[0]))
+        {
+            mRetry->countRefused();
+            return false;
+        }
+        if (attempt >= mRetry->getAttempts())
+            break;
+
+        // Late responses may still come in while backing off
+        const uint32_t now = TrackClock::now();
+        pending = awaitResponses(messages, count, pending, start, TrackClock::deadline(now, mRetry->getBackoff(attempt)));
+        if (pending == 0)
+        {
+            mRetry->countRecovered();
+            return true;
+        }
+        mRetry->countRetry();
+    }
+
+    mRetry->countFailure();
     return false;
 }
 
+/* -------------------------------------------------------------------
+   TrackController::timeoutFor
+-------------------------------------------------------------------  */
+
+uint32_t TrackController::timeoutFor(const TrackMessage &message)
+{
+    const uint32_t timeout = mTimeout * 1000UL;
+    return mTimeouts != nullptr ? mTimeouts->getTimeout(message, timeout) : timeout;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::addListener
+-------------------------------------------------------------------  */
+
+bool TrackController::addListener(TrackListener *listener)
+{
+    if (mListenerCount == TRACK_MAX_LISTENERS)
+        return false;
+    mListeners[mListenerCount++] = listener;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::removeListener
+-------------------------------------------------------------------  */
+
+void TrackController::removeListener(TrackListener *listener)
+{
+    for (uint8_t i = 0; i < mListenerCount; i++)
+    {
+        if (mListeners[i] == listener)
+        {
+            mListeners[i] = mListeners[--mListenerCount];
+            return;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackController::notifyListeners
+-------------------------------------------------------------------  */
+
+void TrackController::notifyListeners(const TrackMessage &message, bool outgoing)
+{
+    for (uint8_t i = 0; i < mListenerCount; i++)
+        mListeners[i]->onMessage(message, outgoing);
+}
+
 /* -------------------------------------------------------------------
    TrackController::generateHash
 -------------------------------------------------------------------  */
@@ -364,8 +790,7 @@ void TrackController::generateHash()
             Serial.print(F("\n------------------------------------------------------------------\n"));
         }
 
-        message.clear();
-        message.command = 0x18; // Ping, demande aux equipements sur le bus
+        message = DeviceCommand::ping(); // Ping, demande aux equipements sur le bus
 
         sendMessage(message);
 
@@ -395,30 +820,20 @@ bool TrackController::setPower(bool power)
 
     TrackMessage message;
 
-    auto exchange = [this, &message](uint16_t timeout)
-    {
-        return exchangeMessage(message, message, timeout);
-    };
-
     /*
         Arrêt du système ou Démarrage du système
         Commande système (0x00, dans CAN-ID : 0x00)
         Sous-commande dans data[4] = 0: Arrêt  du système (0x00)
         Sous-commande dans data[4] = 1: Démarrage du système (0x01)
       */
-    message.clear();
-    message.prio = 0x00;
-    message.command = 0x00;   // Commande système (0x00, dans CAN-ID : 0x00)
-    message.response = false; // bit de réponse désactivé.
-    message.length = 5;
-    message.data[4] = power ? true : false; // Sous-commande Arrêt ou Démarrage
+    message = SystemCommand::power(power); // Sous-commande Arrêt ou Démarrage
 
     // /* new version */
-    if (!exchange(mTimeout))
+    if (!request(message))
     {
         if (mDebug)
         {
-            Serial.println("Failed to send Power");
+            Serial.println(F("Failed to send Power"));
         }
         return false;
     }
@@ -426,9 +841,9 @@ bool TrackController::setPower(bool power)
     {
         if (mDebug)
         {
-            Serial.print("Power ");
-            Serial.print(power ? "on" : "off");
-            Serial.print("\n------------------------------------------------------------------\n");
+            Serial.print(F("Power "));
+            Serial.print(power ? F("on") : F("off"));
+            Serial.print(F("\n------------------------------------------------------------------\n"));
         }
     }
 
@@ -439,22 +854,16 @@ bool TrackController::setPower(bool power)
               Commande système (0x00, dans CAN-ID : 0x00)
               Sous-commande : Compteur de réenregistrement (0x09)
         */
-        message.clear();
-        message.prio = 0x00;
-        message.command = 0x00;   // Commande système (0x00, dans CAN-ID : 0x00)
-        message.response = false; // bit de réponse desactivé.
-        message.length = 7;
-        message.data[4] = 0x09; // Sous-commande Compteur de réenregistrement
-        message.data[6] = 0x03; // Réinitialiser le compteur de réenregistrement à 3.
+        message = SystemCommand::mfxCounter(3); // Réinitialiser le compteur de réenregistrement à 3.
 
         /* old version */
         // exchangeMessage(message, message, 1000);
 
         /* new version */
-        if (!exchange(mTimeout))
+        if (!request(message))
         {
             if (mDebug)
-                Serial.println("Failed to reset re-registration counter");
+                Serial.println(F("Failed to reset re-registration counter"));
             return false;
         }
 
@@ -463,22 +872,16 @@ bool TrackController::setPower(bool power)
              Commande système (0x00, dans CAN-ID : 0x00)
              Sous-commande : •	Protocole de voie (0x08)
            */
-        message.clear();
-        message.prio = 0x00;
-        message.command = 0x00;   // Commande système (0x00, dans CAN-ID : 0x00)
-        message.response = false; // bit de réponse desactivé.
-        message.length = 6;
-        message.data[4] = 0x08; // Sous-commande protocole de voie
-        message.data[5] = 0x07; // bit0 = MM2 - bit1 = MFX - bit2 = DCC
+        message = SystemCommand::protocol(0x07); // bit0 = MM2 - bit1 = MFX - bit2 = DCC
 
         /* old version */
         // exchangeMessage(message, message, 1000);
 
         /* new version */
-        if (!exchange(mTimeout))
+        if (!request(message))
         {
             if (mDebug)
-                Serial.println("Failed to activate track protocol");
+                Serial.println(F("Failed to activate track protocol"));
             return false;
         }
     }
@@ -491,17 +894,9 @@ bool TrackController::setPower(bool power)
 
 bool TrackController::systemHalt(const uint16_t address)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.prio = 0x00;
-    message.command = 0x00;
-    message.length = 5;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = 0x02;
+    TrackMessage message = SystemCommand::halt(address);
 
-    return exchangeMessage(message, message, mTimeout);
+    return request(message);
 }
 
 /* -------------------------------------------------------------------
@@ -510,17 +905,9 @@ bool TrackController::systemHalt(const uint16_t address)
 
 bool TrackController::emergency(const uint16_t address)
 {
-    TrackMessage message;
+    TrackMessage message = SystemCommand::emergency(address);
 
-    message.clear();
-    message.prio = 0x00;
-    message.command = 0x00;
-    message.length = 5;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = 0x03;
-
-    return exchangeMessage(message, message, mTimeout);
+    return request(message);
 }
 
 /* -------------------------------------------------------------------
@@ -529,8 +916,6 @@ bool TrackController::emergency(const uint16_t address)
 
 bool TrackController::setLocoDirection(const uint16_t address, byte direction)
 {
-    TrackMessage message;
-
     /* Sur la MS2, le changement de direction est precede d'un arret d'urgence de la locomotive
          Commande systeme 0x00 Sous Commande 0x03
 
@@ -550,16 +935,11 @@ bool TrackController::setLocoDirection(const uint16_t address, byte direction)
     // message.data[3] = (address & 0x00FF);
     // message.data[5] = 0;
 
-    // return exchangeMessage(message, message, mTimeout);
+    // return request(message);
 
-    message.clear();
-    message.command = 0x05;
-    message.length = 5;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = direction;
+    TrackMessage message = LocoDirection::set(address, direction);
 
-    return exchangeMessage(message, message, mTimeout);
+    return request(message);
 }
 
 /* -------------------------------------------------------------------
@@ -576,17 +956,11 @@ bool TrackController::toggleLocoDirection(const uint16_t address)
 
 bool TrackController::getLocoDirection(const uint16_t address, byte *direction)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.command = 0x05;
-    message.length = 4;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
+    TrackMessage message = LocoDirection::get(address);
 
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        *direction = message.data[4];
+        *direction = LocoDirection::direction(message);
         return true;
     }
     else
@@ -599,17 +973,9 @@ bool TrackController::getLocoDirection(const uint16_t address, byte *direction)
 
 bool TrackController::setLocoFunction(const uint16_t address, byte function, byte power)
 {
-    TrackMessage message;
+    TrackMessage message = LocoFunction::set(address, function, power);
 
-    message.clear();
-    message.command = 0x06;
-    message.length = 6;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = function;
-    message.data[5] = power;
-
-    return exchangeMessage(message, message, mTimeout);
+    return request(message);
 }
 
 /* -------------------------------------------------------------------
@@ -618,20 +984,11 @@ bool TrackController::setLocoFunction(const uint16_t address, byte function, byt
 
 bool TrackController::readConfig(const uint16_t address, uint16_t number, byte *value)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.command = 0x07;
-    message.length = 7;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = highByte(number);
-    message.data[5] = lowByte(number);
-    message.data[6] = 0x01;
+    TrackMessage message = LocoConfig::read(address, number);
 
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        *value = message.data[6];
+        *value = LocoConfig::value(message);
         return true;
     }
     else
@@ -644,18 +1001,11 @@ bool TrackController::readConfig(const uint16_t address, uint16_t number, byte *
 
 bool TrackController::getLocoFunction(const uint16_t address, byte function, byte *power)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.command = 0x06;
-    message.length = 5;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = function;
+    TrackMessage message = LocoFunction::get(address, function);
 
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        *power = message.data[5];
+        *power = LocoFunction::power(message);
         return true;
     }
     else
@@ -668,17 +1018,45 @@ bool TrackController::getLocoFunction(const uint16_t address, byte function, byt
 
 bool TrackController::setLocoSpeed(const uint16_t address, uint16_t speed)
 {
-    TrackMessage message;
+    // In proxy mode, a speed on the step the loco is on changes nothing
+    if (mProxyLocos != nullptr && mProxyLocos->suppressSpeed(address, speed))
+        return true;
+
+    TrackMessage message = LocoSpeed::set(address, speed);
+
+    return request(message);
+}
+
+/* -------------------------------------------------------------------
+   TrackController::accelerateLoco
+-------------------------------------------------------------------  */
+
+bool TrackController::accelerateLoco(const uint16_t address)
+{
+    uint16_t speed;
+    if (getLocoSpeed(address, &speed))
+    {
+        speed += 77;
+        if (speed > 1023)
+            speed = 1023;
+        return setLocoSpeed(address, speed);
+    }
+    return false;
+}
 
-    message.clear();
-    message.command = 0x04;
-    message.length = 6;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = address & 0x00FF;
-    message.data[4] = (speed & 0xFF00) >> 8;
-    message.data[5] = speed & 0x00FF;
+/* -------------------------------------------------------------------
+   TrackController::decelerateLoco
+-------------------------------------------------------------------  */
 
-    return exchangeMessage(message, message, mTimeout);
+bool TrackController::decelerateLoco(const uint16_t address)
+{
+    uint16_t speed;
+    if (getLocoSpeed(address, &speed))
+    {
+        speed = speed > 77 ? speed - 77 : 0;
+        return setLocoSpeed(address, speed);
+    }
+    return false;
 }
 
 /* -------------------------------------------------------------------
@@ -694,37 +1072,151 @@ bool TrackController::toggleLocoFunction(const uint16_t address, byte function)
     return false;
 }
 
+/* -------------------------------------------------------------------
+   TrackController::addToConsist
+-------------------------------------------------------------------  */
+
+bool TrackController::addToConsist(uint8_t consist, const uint16_t address, bool inverted, uint8_t trim)
+{
+    if (consist >= TRACK_MAX_CONSISTS || address == 0)
+        return false;
+
+    ConsistMember *member = nullptr;
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE && member == nullptr; i++)
+        if (mConsists[consist][i].address == address)
+            member = &mConsists[consist][i];
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE && member == nullptr; i++)
+        if (mConsists[consist][i].address == 0)
+            member = &mConsists[consist][i];
+    if (member == nullptr)
+        return false;
+
+    member->address = address;
+    member->inverted = inverted;
+    member->trim = trim;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::removeFromConsist
+-------------------------------------------------------------------  */
+
+bool TrackController::removeFromConsist(uint8_t consist, const uint16_t address)
+{
+    if (consist >= TRACK_MAX_CONSISTS || address == 0)
+        return false;
+
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE; i++)
+    {
+        if (mConsists[consist][i].address == address)
+        {
+            mConsists[consist][i].address = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::clearConsist
+-------------------------------------------------------------------  */
+
+void TrackController::clearConsist(uint8_t consist)
+{
+    if (consist < TRACK_MAX_CONSISTS)
+        memset(mConsists[consist], 0x00, sizeof(mConsists[consist]));
+}
+
+/* -------------------------------------------------------------------
+   TrackController::setConsistSpeed
+-------------------------------------------------------------------  */
+
+bool TrackController::setConsistSpeed(uint8_t consist, uint16_t speed)
+{
+    if (consist >= TRACK_MAX_CONSISTS)
+        return false;
+
+    TrackMessage messages[TRACK_CONSIST_SIZE];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE; i++)
+    {
+        const ConsistMember &member = mConsists[consist][i];
+        if (member.address != 0)
+        {
+            const uint32_t trimmed = static_cast<uint32_t>(speed) * member.trim / 100;
+            messages[count++] = LocoSpeed::set(member.address, trimmed > 1023 ? 1023 : trimmed);
+        }
+    }
+
+    return fanOut(messages, count);
+}
+
+/* -------------------------------------------------------------------
+   TrackController::setConsistDirection
+-------------------------------------------------------------------  */
+
+bool TrackController::setConsistDirection(uint8_t consist, uint8_t direction)
+{
+    if (consist >= TRACK_MAX_CONSISTS)
+        return false;
+
+    TrackMessage messages[TRACK_CONSIST_SIZE];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE; i++)
+    {
+        const ConsistMember &member = mConsists[consist][i];
+        if (member.address == 0)
+            continue;
+
+        // An inverted loco runs the other way; a toggle toggles all alike
+        uint8_t own = direction;
+        if (member.inverted && direction == DIR_FORWARD)
+            own = DIR_REVERSE;
+        else if (member.inverted && direction == DIR_REVERSE)
+            own = DIR_FORWARD;
+        messages[count++] = LocoDirection::set(member.address, own);
+    }
+
+    return fanOut(messages, count);
+}
+
+/* -------------------------------------------------------------------
+   TrackController::setConsistFunction
+-------------------------------------------------------------------  */
+
+bool TrackController::setConsistFunction(uint8_t consist, uint8_t function, uint8_t power)
+{
+    if (consist >= TRACK_MAX_CONSISTS)
+        return false;
+
+    TrackMessage messages[TRACK_CONSIST_SIZE];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TRACK_CONSIST_SIZE; i++)
+        if (mConsists[consist][i].address != 0)
+            messages[count++] = LocoFunction::set(mConsists[consist][i].address, function, power);
+
+    return fanOut(messages, count);
+}
+
 /* -------------------------------------------------------------------
    TrackController::setAccessory
 -------------------------------------------------------------------  */
 boolean TrackController::setAccessory(const uint16_t address, byte position, byte power, uint16_t time)
 {
-    TrackMessage message;
+    TrackMessage message = Accessory::set(address, position, power);
 
-    message.clear();
-    message.command = 0x0B;
-    message.length = 6;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = position;
-    message.data[5] = power;
-
-    exchangeMessage(message, message, mTimeout);
+    bool result = request(message);
 
+    // Switch off even if the response got lost: the coil may be on
     if (time != 0)
     {
         delay(time);
 
-        message.clear();
-        message.command = 0x0B;
-        message.length = 6;
-        message.data[2] = (address & 0xFF00) >> 8;
-        message.data[3] = (address & 0x00FF);
-        message.data[4] = position;
+        message = Accessory::set(address, position, 0);
 
-        exchangeMessage(message, message, mTimeout);
+        result = request(message) && result;
     }
-    return true;
+    return result;
 }
 
 /* -------------------------------------------------------------------
@@ -742,17 +1234,11 @@ bool TrackController::setTurnout(const uint16_t address, bool straight)
 
 bool TrackController::getLocoSpeed(const uint16_t address, uint16_t *speed)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.command = 0x04;
-    message.length = 4;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
+    TrackMessage message = LocoSpeed::get(address);
 
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        *speed = (message.data[4] << 8) | message.data[5];
+        *speed = LocoSpeed::speed(message);
         return true;
     }
     else
@@ -764,18 +1250,12 @@ bool TrackController::getLocoSpeed(const uint16_t address, uint16_t *speed)
 -------------------------------------------------------------------  */
 bool TrackController::getAccessory(const uint16_t address, byte *position, byte *power)
 {
-    TrackMessage message;
+    TrackMessage message = Accessory::get(address);
 
-    message.clear();
-    message.command = 0x0B;
-    message.length = 4;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        position[0] = message.data[4];
-        power[0] = message.data[5];
+        position[0] = Accessory::position(message);
+        power[0] = Accessory::power(message);
         return true;
     }
     else
@@ -791,14 +1271,11 @@ bool TrackController::getVersion()
 {
     bool result = false;
 
-    TrackMessage message;
-
-    message.clear();
-    message.command = 0x18;
+    TrackMessage message = DeviceCommand::ping();
 
-    if (exchangeMessage(message, message, mTimeout))
+    if (request(message))
     {
-        Serial.print("version : ");
+        Serial.print(F("version : "));
         Serial.print(message.data[4]);
         Serial.println(message.data[5]);
         return result = true;
@@ -813,7 +1290,7 @@ bool TrackController::getVersion()
     //     //if (message.command == 0x18 && message.data[6] == 0x00 && message.data[7] == 0x10) {
     //     // *high = message.data[4];
     //     // *low = message.data[5];
-    //     Serial.print("version : ");
+    //     Serial.print(F("version : "));
     //     Serial.print(message.data[4]);
     //     Serial.println(message.data[5]);
     //     result = true;
@@ -828,63 +1305,124 @@ bool TrackController::getVersion()
 
 bool TrackController::writeConfig(const uint16_t address, uint16_t number, byte value)
 {
-    TrackMessage message;
-
-    message.clear();
-    message.prio = 0x01;
-    message.command = 0x08;
-    message.length = 8;
-    message.data[2] = (address & 0xFF00) >> 8;
-    message.data[3] = (address & 0x00FF);
-    message.data[4] = highByte(number);
-    message.data[5] = lowByte(number);
-    message.data[6] = value;
+    TrackMessage message = LocoConfig::write(address, number, value);
 
-    return exchangeMessage(message, message, mTimeout);
+    return request(message);
 }
 
 /* -------------------------------------------------------------------
    TrackController::handleUserCommands
 -------------------------------------------------------------------  */
 
+#ifndef RAILUINO_LEAN
+
 void TrackController::handleUserCommands(String command)
 {
-    if (command.startsWith("power ")) // EX power 1 (on); power 0 (off)
-    {
-        bool power = command.substring(6).toInt();
-        setPower(power);
-    }
-    else if (command.startsWith("emergency "))
-    {
-        uint16_t address = command.substring(10, 15).toInt();
-        emergency(address);
-    }
-    else if (command.startsWith("direction "))
-    {
-        uint16_t address = command.substring(10, 15).toInt();
-        uint8_t direction = command.substring(16).toInt();
-        setLocoDirection(address, direction);
-    }
-    else if (command.startsWith("speed ")) // Ex speed 16391 100; 16391 = 0x40 | 0x07; 100 = speed/1000
-    {
-        uint16_t address = command.substring(6, 11).toInt();
-        uint16_t speed = command.substring(12).toInt();
-        setLocoSpeed(address, speed);
-    }
-    else if (command.startsWith("function ")) // Ex function 16391 0 1; 16391 = 0x40 | 0x07; 0 = feux; 1 = true
+    queueUserCommands(command.c_str(), mDebug ? &Serial : nullptr);
+
+    while (processUserCommand())
+        ;
+}
+
+#endif
+
+/* -------------------------------------------------------------------
+   TrackController::queueUserCommands
+-------------------------------------------------------------------  */
+
+uint8_t TrackController::queueUserCommands(const char *line, Print *errors)
+{
+    uint8_t queued = 0;
+    const char *start = line;
+
+    for (;;)
     {
-        uint16_t address = command.substring(9, 14).toInt();
-        uint8_t function = command.substring(15, 16).toInt();
-        uint8_t power = command.substring(16).toInt();
-        setLocoFunction(address, function, power);
+        const char *end = start;
+        while (*end != '\0' && *end != ';')
+            end++;
+
+        TrackUserCommand command;
+        uint8_t result = TrackUserCommandParser::parse(start, end - start, command);
+
+        if (result == PARSE_OK && !mUserCommands.push(command))
+            result = PARSE_QUEUE_FULL;
+
+        if (result == PARSE_OK)
+            queued++;
+        else if (result != PARSE_EMPTY && errors != nullptr)
+        {
+            errors->print(F("!!! "));
+            errors->print(TrackUserCommandParser::errorText(result));
+            errors->print(F(": "));
+            errors->write(reinterpret_cast<const uint8_t *>(start), end - start);
+            errors->println();
+        }
+
+        if (*end == '\0')
+            break;
+        start = end + 1;
     }
-    else if (command.startsWith("accessory "))
+
+    return queued;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::processUserCommand
+-------------------------------------------------------------------  */
+
+bool TrackController::processUserCommand()
+{
+    TrackUserCommand command;
+
+    if (!mUserCommands.pop(command))
+        return false;
+
+    executeUserCommand(command);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackController::executeUserCommand
+-------------------------------------------------------------------  */
+
+bool TrackController::executeUserCommand(const TrackUserCommand &command)
+{
+    const uint16_t *args = command.args;
+
+    switch (command.type)
     {
-        uint16_t address = command.substring(10, 15).toInt();
-        uint8_t position = command.substring(16, 17).toInt();
-        uint8_t power = command.substring(17, 18).toInt();
-        uint16_t time = command.substring(19).toInt();
-        setAccessory(address, position, power, time);
+    case USER_POWER: // Ex power 1 (on); power 0 (off)
+        return setPower(args[0]);
+    case USER_EMERGENCY:
+        return emergency(args[0]);
+    case USER_HALT:
+        return systemHalt(args[0]);
+    case USER_DIRECTION:
+        return setLocoDirection(args[0], args[1]);
+    case USER_SPEED: // Ex speed 16391 100; 16391 = 0x40 | 0x07; 100 = speed/1000
+        return setLocoSpeed(args[0], args[1]);
+    case USER_FUNCTION: // Ex function 16391 0 1; 16391 = 0x40 | 0x07; 0 = feux; 1 = true
+        return setLocoFunction(args[0], args[1], args[2]);
+    case USER_ACCESSORY:
+        return setAccessory(args[0], args[1], args[2], args[3]);
+    default:
+        return false;
     }
-    //}
+}
+
+/* -------------------------------------------------------------------
+   TrackController::update
+-------------------------------------------------------------------  */
+
+void TrackController::update()
+{
+    TrackMessage message;
+
+    while (receiveMessage(message)) // Listeners are notified inside
+        ;
+
+    if (mSupervisor != nullptr && mSupervisor->check(*mTransport, false))
+        mSupervisor->release(*mTransport);
+
+    processUserCommand();
 }
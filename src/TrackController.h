@@ -22,7 +22,44 @@
  
  #include <Arduino.h>
  #include "TrackMessage.h"
+ #include "TrackFrame.h"
+ #include "TrackRing.h"
+ #include "TrackTransport.h"
+ #include "TrackClock.h"
+ #include "TrackTimeouts.h"
+ #include "TrackRetry.h"
+ #include "TrackSupervisor.h"
+ #include "TrackUserCommand.h"
  #include "Config.h"
+
+ class TrackLocoTable;
+ class TrackAccessoryTable;
+ 
+ // ===================================================================
+ // === TrackListener =================================================
+ // ===================================================================
+ 
+ /**
+  * Is notified of every message the TrackController sends or
+  * receives, including those skipped while waiting for a response.
+  * Register listeners with TrackController::addListener(). The
+  * callback runs in the middle of the controller's message handling,
+  * so it must be quick and must not call blocking methods such as
+  * setLocoSpeed(). Record what happened and act on it later.
+  */
+ class TrackListener
+ {
+ public:
+   virtual ~TrackListener() {}
+ 
+   /**
+    * Called for each message. 'outgoing' is true for messages sent
+    * by this controller, false for those received from the bus. An
+    * outgoing message is passed on once the CAN controller or the
+    * supervisor took it, never when sending failed.
+    */
+   virtual void onMessage(const TrackMessage &message, bool outgoing) = 0;
+ };
  
  // ===================================================================
  // === TrackController ===============================================
@@ -60,7 +97,115 @@
     */
    bool mLoopback;
  
-   uint64_t mTimeout;
+   /**
+    * Holds the default time to wait for a response, in ms. 32 bits
+    * like millis(), which is plenty and saves SRAM on AVR.
+    */
+   uint32_t mTimeout;
+   /**
+    * Holds the text protocol commands waiting to be executed by
+    * update(), oldest first.
+    */
+   TrackRing<TrackUserCommand, TRACK_USER_QUEUE_SIZE> mUserCommands;
+   /**
+    * Holds the registered listeners.
+    */
+   TrackListener *mListeners[TRACK_MAX_LISTENERS];
+   uint8_t mListenerCount;
+   /**
+    * Holds the frames injected with injectMessage(). They are
+    * received before anything coming from the CAN hardware.
+    */
+   TrackRing<CANMessage, TRACK_INJECT_QUEUE_SIZE> mInjected;
+   /**
+    * Holds the transport to the CAN bus this controller drives.
+    */
+   TrackTransport *mTransport;
+   /**
+    * Holds the response time of the last successful exchange, in us.
+    */
+   uint32_t mLatency;
+   /**
+    * Holds the learned timeouts, if any.
+    */
+   TrackTimeouts *mTimeouts;
+   /**
+    * Holds the retry policy, if any.
+    */
+   TrackRetry *mRetry;
+   /**
+    * Holds the bus supervisor, if any.
+    */
+   TrackSupervisor *mSupervisor;
+   /**
+    * Holds the members of each consist. A free place has address 0.
+    */
+   struct ConsistMember
+   {
+     uint16_t address;
+     uint8_t trim; // Percent of the consist speed
+     bool inverted;
+   };
+   ConsistMember mConsists[TRACK_MAX_CONSISTS][TRACK_CONSIST_SIZE];
+   static_assert(TRACK_CONSIST_SIZE <= 8, "A consist is tracked in an 8 bit mask");
+   /**
+    * Holds the shadow state answering queries in proxy mode, if any.
+    */
+   TrackLocoTable *mProxyLocos;
+   TrackAccessoryTable *mProxyAccessories;
+   uint32_t mProxyHits;
+   uint32_t mProxyMisses;
+ 
+   /**
+    * Results of transmit().
+    */
+   static const uint8_t SEND_FAILED = 0;
+   static const uint8_t SEND_DONE = 1;
+   static const uint8_t SEND_HELD = 2; // Kept by the supervisor until the bus is back
+
+   /**
+    * Passes a message on to all registered listeners.
+    */
+   void notifyListeners(const TrackMessage &message, bool outgoing);
+
+   /**
+    * Hands a message to the transport, or to the supervisor while
+    * the bus is off, and tells which of the two took it.
+    */
+   uint8_t transmit(const TrackMessage &message);
+
+   /**
+    * Returns the timeout for the given request in microseconds.
+    */
+   uint32_t timeoutFor(const TrackMessage &message);
+
+   /**
+    * Receives messages until the response to the given request comes
+    * in or the deadline (a TrackClock time) is reached. A late
+    * response to another request with the same command, for another
+    * loco say, is passed over; see TrackCommand::isResponseTo().
+    */
+   bool awaitResponse(const TrackMessage &request, TrackMessage &in, uint32_t deadline);
+
+   /**
+    * Exchanges a message for the high-level methods, with the
+    * learned timeout and the retry policy, if set.
+    */
+   bool request(TrackMessage &message);
+
+   /**
+    * Receives messages until each request in 'pending' (bit n for
+    * messages[n]) has its response or the deadline is reached.
+    * Returns the requests still without one.
+    */
+   uint8_t awaitResponses(const TrackMessage *messages, uint8_t count, uint8_t pending, uint32_t start, uint32_t deadline);
+
+   /**
+    * Sends all messages back to back, then waits for their responses
+    * together, with the retry policy, if set, applied to the ones
+    * left unanswered. Returns true if all were answered.
+    */
+   bool fanOut(TrackMessage *messages, uint8_t count);
  
  public:
    /**
@@ -85,6 +230,15 @@
     * flag. A zero hash will result in a unique hash begin generated.
     */
    TrackController(uint16_t hash, bool debug, uint64_t timeOut, bool loopback);
+
+   /**
+    * Creates a new TrackController that drives the bus behind the
+    * given transport. Use this to run several controllers, each on
+    * its own bus. The constructors above use the built-in CAN
+    * controller on ESP32 and an MCP2515 on pins 10 (CS) and 2 (INT)
+    * on AVR. The transport must live as long as the controller.
+    */
+   TrackController(TrackTransport &transport, uint16_t hash = 0, bool debug = false, uint64_t timeOut = 1000);
    /**
     * Is called when a TrackController is being destroyed. Does the
     * necessary cleanup. No need to call this manually.
@@ -103,6 +257,17 @@
     * Queries the hash used by the TrackController.
     */
    uint16_t getHash();
+
+   /**
+    * Sets the hash used by the TrackController. Set before begin(), a
+    * non-zero hash saves the search for a free one.
+    */
+   void setHash(uint16_t hash);
+ 
+   /**
+    * Sets the time in ms to wait for the response to a request.
+    */
+   void setTimeout(uint32_t timeOut);
  
    /**
     * Reflects whether the TrackController is in debug mode,
@@ -121,7 +286,9 @@
     * messages. CAN messages are put into an internal buffer of
     * limited size, so they don't get lost, but you have to take
     * care of them in time. Otherwise the buffer might overflow.
-    * default CAN Rx pin is GPIO_NUM_5 and can_tx_pin is GPIO_NUM_4
+    * default CAN Rx pin is GPIO_NUM_5 and can_tx_pin is GPIO_NUM_4.
+    * The pins only apply to the built-in transport of the ESP32;
+    * other transports get their pins from their constructor.
     */
  
  
@@ -146,9 +313,18 @@
    /**
     * Sends a message and reports true on success. Internal method.
     * Normally you don't want to use this, but the more convenient
-    * methods below instead.
+    * methods below instead. A frame the supervisor holds while the
+    * bus is off counts as sent, since it goes out once the bus is
+    * back: sending it again would send it twice.
     */
    bool sendMessage(TrackMessage &message);
+
+   /**
+    * Sends a message as it is, keeping its hash instead of putting
+    * in ours. Used for passing on messages that came from another
+    * bus, see TrackBridge. Held frames count as sent, as above.
+    */
+   bool forwardMessage(const TrackMessage &message);
  
    /**
     * Receives an arbitrary message, if available, and reports true
@@ -158,6 +334,15 @@
     */
    bool receiveMessage(TrackMessage &message);
  
+   /**
+    * Puts a message into the receive path as if it came from the
+    * bus: the next receiveMessage() returns it, listeners see it and
+    * exchangeMessage() may take it as a response. Used for replaying
+    * recorded sessions and for simulating devices. Returns false if
+    * the TRACK_INJECT_QUEUE_SIZE slots are taken.
+    */
+   bool injectMessage(const TrackMessage &message);
+ 
    /**
     * Sends a message and waits for the corresponding response,
     * returning true on success. Blocks until either a message with
@@ -168,6 +353,87 @@
     * may be the same object.
     */
    bool exchangeMessage(TrackMessage &out, TrackMessage &in, uint16_t timeout);
+
+   /**
+    * Same as exchangeMessage(), with the timeout in microseconds.
+    * For sending without blocking, see TrackRequests.
+    */
+   bool exchangeMessageMicros(TrackMessage &out, TrackMessage &in, uint32_t timeout);
+
+   /**
+    * Returns the response time of the last successful exchange in
+    * microseconds.
+    */
+   uint32_t getLastLatency() const { return mLatency; }
+
+   /**
+    * Lets the controller learn the response times of each kind of
+    * request and time out each exchange of the high-level methods
+    * accordingly, instead of always waiting the fixed timeout, which
+    * becomes the upper bound. Pass nullptr to go back to the fixed
+    * timeout. The table must live as long as the controller.
+    */
+   void setTimeouts(TrackTimeouts *timeouts) { mTimeouts = timeouts; }
+
+   /**
+    * Makes the high-level methods send idempotent requests again when
+    * their response does not come, as the given policy says. Pass
+    * nullptr to give up after the first attempt, as by default. The
+    * policy must live as long as the controller.
+    */
+   void setRetry(TrackRetry *retry) { mRetry = retry; }
+
+   /**
+    * Lets the given supervisor watch the CAN controller from
+    * update(), bring it back when it went bus-off and keep the
+    * commands sent meanwhile. Pass nullptr to stop, as by default.
+    * The supervisor must live as long as the controller. An exchange
+    * whose frame is held returns false at once, in debug mode too,
+    * where it would otherwise stop the layout and halt; for
+    * sendMessage() and forwardMessage() a held frame is sent.
+    */
+   void setSupervisor(TrackSupervisor *supervisor) { mSupervisor = supervisor; }
+
+   /**
+    * Turns proxy mode on, with the given tables as the shadow state,
+    * or off with nullptr for both. In proxy mode, queries for the
+    * speed, direction or a function of a loco, or the position of an
+    * accessory, are answered from the tables when they know the
+    * answer, in microseconds and without a frame on the bus. Only
+    * what the tables do not know yet is asked on the bus, and the
+    * tables learn it from the response. Commands always go out,
+    * except a speed leaving the loco on the speed step it is on, see
+    * TrackLocoTable::suppressSpeed().
+    */
+   void setProxy(TrackLocoTable *locos, TrackAccessoryTable *accessories);
+
+   /**
+    * Turns a query into the response the connection box would give,
+    * from the shadow state. Returns false if proxy mode is off, the
+    * message is not a query or the answer is not known. Used by the
+    * get*() methods; a sketch serving other clients can call it
+    * before sending their queries on.
+    */
+   bool answerQuery(TrackMessage &message);
+
+   /**
+    * Returns the number of queries answered from the shadow state
+    * and the number that had to go to the bus.
+    */
+   uint32_t getProxyHits() const { return mProxyHits; }
+   uint32_t getProxyMisses() const { return mProxyMisses; }
+ 
+   /**
+    * Registers a listener that is notified of every message sent or
+    * received. Returns false if all TRACK_MAX_LISTENERS slots are
+    * taken.
+    */
+   bool addListener(TrackListener *listener);
+ 
+   /**
+    * Unregisters a listener.
+    */
+   void removeListener(TrackListener *listener);
  
    /**
     * Controls power on the track. When passing false, all
@@ -233,8 +499,14 @@
     * whether the call was successful.
     */
    bool setLocoSpeed(const uint16_t address, uint16_t speed);
-   // bool accelerateLoco(uint16_t address);
-   // bool decelerateLoco(uint16_t address);
+ 
+   /**
+    * Increases or decreases the speed of the given locomotive by one
+    * step of 77, which gives roughly 14 steps from 0 to 1023. For
+    * smooth acceleration of many locos at once, see TrackRamp.
+    */
+   bool accelerateLoco(const uint16_t address);
+   bool decelerateLoco(const uint16_t address);
  
    /**
     * Sets the given function of the given locomotive (or simply a
@@ -253,6 +525,33 @@
     */
    bool toggleLocoFunction(const uint16_t address, uint8_t function);
  
+   /**
+    * Adds a locomotive to the given consist (0 to
+    * TRACK_MAX_CONSISTS - 1) or changes it if it is already there.
+    * 'inverted' is for a loco coupled the other way round, which must
+    * run in the opposite direction. 'trim' is the percentage of the
+    * consist speed the loco gets, to match locos that run faster or
+    * slower than the others. Returns false if the consist is full.
+    */
+   bool addToConsist(uint8_t consist, const uint16_t address, bool inverted = false, uint8_t trim = 100);
+
+   /**
+    * Removes a locomotive from the given consist, or all of them.
+    */
+   bool removeFromConsist(uint8_t consist, const uint16_t address);
+   void clearConsist(uint8_t consist);
+
+   /**
+    * Set the speed, the direction or a function of all locomotives
+    * of a consist at once. The frames go out back to back and the
+    * responses are awaited together, so the locos start within a few
+    * frame times of each other. The return value reflects whether
+    * every loco answered.
+    */
+   bool setConsistSpeed(uint8_t consist, uint16_t speed);
+   bool setConsistDirection(uint8_t consist, uint8_t direction);
+   bool setConsistFunction(uint8_t consist, uint8_t function, uint8_t power);
+
    /**
     * Switches the given magnetic accessory. Valid position values
     * are those denoted by the ACC_* constants. Valid power values
@@ -263,7 +562,8 @@
     * switched on. Some magnetic accessories must not be active for
     * too long, because they might burn out. A good timeout for
     * Marklin turnouts seems to be 20 ms. The return value reflects
-    * whether the call was successful.
+    * whether the call was successful; the accessory is switched off
+    * after 'time' even if switching it on was not confirmed.
     */
    bool setAccessory(const uint16_t address, uint8_t position, uint8_t power, uint16_t time);
  
@@ -340,9 +640,56 @@
    //bool getVersion(uint8_t *high, uint8_t *low);
  
    /**
-    * Processes commands received on the serial or TCP port
+    * Processes commands received on the serial or TCP port. The line
+    * may hold several commands separated by ';'. Blocks until all
+    * of them have been executed. Kept for existing sketches; prefer
+    * queueUserCommands() together with update(). Not available in
+    * RAILUINO_LEAN builds, which do without String.
     */
+ #ifndef RAILUINO_LEAN
    void handleUserCommands(String);
+ #endif
+ 
+   /**
+    * Parses the commands of the given line and appends them to the
+    * command queue without executing anything, so it never blocks.
+    * Commands are separated by ';' and have the form
+    *
+    * power <0|1>
+    * emergency <address>
+    * halt <address>
+    * direction <address> <direction>
+    * speed <address> <speed>
+    * function <address> <function> <power>
+    * accessory <address> <position> <power> [time]
+    *
+    * where numbers are decimal or hexadecimal with a 0x prefix. The
+    * old forms 'function <address> <FP>' and 'accessory <address> <PW>
+    * [time]', with function and power or position and power as two
+    * adjacent digits, are still understood. Parse errors are reported
+    * to 'errors' if given. Returns the number of commands queued.
+    */
+   uint8_t queueUserCommands(const char *line, Print *errors = nullptr);
+ 
+   /**
+    * Executes the oldest queued command, if any. Returns false if
+    * the queue was empty.
+    */
+   bool processUserCommand();
+ 
+   /**
+    * Executes a single parsed command. The return value reflects
+    * whether the call was successful.
+    */
+   bool executeUserCommand(const TrackUserCommand &command);
+ 
+   /**
+    * Does the background work of the controller. Call this as often
+    * as possible from loop(). Each call hands all pending incoming
+    * messages to the listeners and executes at most one queued
+    * command, so loop() keeps reading new input in between.
+    */
+   void update();
  };
  
  #endif // TRACKCONTROLLER_H
@@ -0,0 +1,40 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKCRC_H
+ #define TRACKCRC_H
+
+ #include <Arduino.h>
+
+ // ===================================================================
+ // === TrackCrc ======================================================
+ // ===================================================================
+
+ /**
+  * CRC-16/CCITT-FALSE (polynomial 0x1021, start 0xFFFF), as used by
+  * TrackSnapshot blocks, TrackSerialLink packets and TrackConfig
+  * tables, which can be several KB long. Computed bit by bit: the
+  * data is short or read once, and a table would cost 512 bytes of
+  * flash.
+  */
+ class TrackCrc
+ {
+ public:
+   static uint16_t ccitt(const uint8_t *data, uint16_t length);
+ };
+
+ #endif // TRACKCRC_H
@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKDEADLINEQUEUE_H
+ #define TRACKDEADLINEQUEUE_H
+
+ #include <Arduino.h>
+ #include "TrackClock.h"
+
+ // ===================================================================
+ // === TrackDeadlineQueue ============================================
+ // ===================================================================
+
+ /**
+  * Up to SIZE deadlines, each tagged with a small id, kept in a binary
+  * min-heap so the earliest one is always on top. Adding a deadline
+  * and taking the earliest cost O(log SIZE); a loop iteration handles
+  * all expired deadlines with one popExpired() call each and stops at
+  * the first one still in the future. Deadlines are TrackClock times
+  * and must lie within 35 minutes of each other. No dynamic memory.
+  */
+ template <uint8_t SIZE>
+ class TrackDeadlineQueue
+ {
+ private:
+   struct Entry
+   {
+     uint32_t deadline;
+     uint8_t id;
+   };
+
+   Entry mHeap[SIZE];
+   uint8_t mCount;
+
+   void swap(uint8_t a, uint8_t b)
+   {
+     const Entry entry = mHeap[a];
+     mHeap[a] = mHeap[b];
+     mHeap[b] = entry;
+   }
+
+   void up(uint8_t i)
+   {
+     while (i > 0)
+     {
+       const uint8_t parent = (i - 1) / 2;
+       if (!TrackClock::before(mHeap[i].deadline, mHeap[parent].deadline))
+         return;
+       swap(i, parent);
+       i = parent;
+     }
+   }
+
+   void down(uint8_t i)
+   {
+     for (;;)
+     {
+       const uint8_t left = 2 * i + 1;
+       const uint8_t right = left + 1;
+       uint8_t first = i;
+
+       if (left < mCount && TrackClock::before(mHeap[left].deadline, mHeap[first].deadline))
+         first = left;
+       if (right < mCount && TrackClock::before(mHeap[right].deadline, mHeap[first].deadline))
+         first = right;
+       if (first == i)
+         return;
+       swap(i, first);
+       i = first;
+     }
+   }
+
+   void removeAt(uint8_t i)
+   {
+     mHeap[i] = mHeap[--mCount];
+     if (i < mCount)
+     {
+       up(i);
+       down(i);
+     }
+   }
+
+ public:
+   TrackDeadlineQueue() : mCount(0) {}
+
+   /**
+    * Adds a deadline. Returns false if all SIZE entries are taken.
+    */
+   bool push(uint8_t id, uint32_t deadline)
+   {
+     if (mCount == SIZE)
+       return false;
+     mHeap[mCount].deadline = deadline;
+     mHeap[mCount].id = id;
+     up(mCount++);
+     return true;
+   }
+
+   /**
+    * Removes the deadline with the given id, if any. O(SIZE) to find
+    * it, O(log SIZE) to repair the heap.
+    */
+   bool remove(uint8_t id)
+   {
+     for (uint8_t i = 0; i < mCount; i++)
+     {
+       if (mHeap[i].id == id)
+       {
+         removeAt(i);
+         return true;
+       }
+     }
+     return false;
+   }
+
+   /**
+    * Gives the earliest deadline without removing it. Returns false if
+    * there is none.
+    */
+   bool peek(uint8_t *id, uint32_t *deadline) const
+   {
+     if (mCount == 0)
+       return false;
+     *id = mHeap[0].id;
+     *deadline = mHeap[0].deadline;
+     return true;
+   }
+
+   /**
+    * Removes the earliest deadline if it has been reached at 'now'
+    * and gives its id. Returns false if no deadline has been reached.
+    */
+   bool popExpired(uint32_t now, uint8_t *id)
+   {
+     if (mCount == 0 || !TrackClock::reached(now, mHeap[0].deadline))
+       return false;
+     *id = mHeap[0].id;
+     removeAt(0);
+     return true;
+   }
+
+   void clear() { mCount = 0; }
+   uint8_t count() const { return mCount; }
+   bool isEmpty() const { return mCount == 0; }
+   static uint8_t capacity() { return SIZE; }
+ };
+
+ #endif // TRACKDEADLINEQUEUE_H
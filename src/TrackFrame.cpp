@@ -0,0 +1,69 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackFrame.h"
+
+/* -------------------------------------------------------------------
+   TrackFrame::fromMessage
+-------------------------------------------------------------------  */
+
+void TrackFrame::fromMessage(const TrackMessage &message)
+{
+    setId(TrackCommand::canId(message));
+    bytes[4] = message.length;
+    memcpy(bytes + 5, message.data, 8);
+}
+
+/* -------------------------------------------------------------------
+   TrackFrame::toMessage
+-------------------------------------------------------------------  */
+
+void TrackFrame::toMessage(TrackMessage &message) const
+{
+    const uint8_t len = bytes[4] > 8 ? 8 : bytes[4];
+    message.prio = prio();
+    message.command = command();
+    message.response = response();
+    message.hash = hash();
+    message.length = len;
+    memcpy(message.data, bytes + 5, len);
+    memset(message.data + len, 0x00, 8 - len);
+}
+
+/* -------------------------------------------------------------------
+   TrackFrame::fromCAN
+-------------------------------------------------------------------  */
+
+void TrackFrame::fromCAN(const CANMessage &frame)
+{
+    setId(frame.id);
+    bytes[4] = frame.len;
+    memcpy(bytes + 5, frame.data, 8);
+}
+
+/* -------------------------------------------------------------------
+   TrackFrame::toCAN
+-------------------------------------------------------------------  */
+
+void TrackFrame::toCAN(CANMessage &frame) const
+{
+    frame.id = id();
+    frame.ext = true;
+    frame.rtr = false;
+    frame.len = bytes[4] > 8 ? 8 : bytes[4];
+    memcpy(frame.data, bytes + 5, 8);
+}
@@ -0,0 +1,177 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKFRAME_H
+ #define TRACKFRAME_H
+
+ #include <Arduino.h>
+ #include "TrackMessage.h"
+ #include "TrackCommand.h"
+
+ #if defined ARDUINO_ARCH_ESP32
+ #include <ACAN_ESP32.h> // https://github.com/pierremolinaro/acan-esp32.git
+ #elif defined ARDUINO_ARCH_AVR
+ #include <ACAN2515.h> // https://github.com/pierremolinaro/acan2515.git
+ #endif
+
+ // ===================================================================
+ // === TrackFrame ====================================================
+ // ===================================================================
+
+ /**
+  * A message in the packed 13 byte layout used by the CS2 on the
+  * network (UDP/TCP port 15731): the 29 bit CAN identifier in four
+  * big endian bytes, one length byte and eight data bytes, which are
+  * always present regardless of the length. A TrackFrame can be
+  * stored, queued or sent over a socket with a single memcpy() and
+  * is only decoded when one of the accessors is called.
+  *
+  * See https://streaming.maerklin.de/public-media/cs2/cs2CAN-Protokoll-2_0.pdf
+  * -> 1.3 Die CAN Nachricht in einem Netzwerk Frame
+  */
+ class TrackFrame
+ {
+ public:
+     /**
+      * Size of the packed frame in bytes.
+      */
+     static const uint8_t SIZE = 13;
+
+     /**
+      * The raw bytes: [0..3] identifier, [4] length, [5..12] data.
+      */
+     uint8_t bytes[SIZE];
+
+     /**
+      * Returns the 29 bit CAN identifier.
+      */
+     uint32_t id() const
+     {
+         return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+     }
+
+     /**
+      * Sets the 29 bit CAN identifier.
+      */
+     void setId(uint32_t id)
+     {
+         bytes[0] = (id >> 24) & 0x1F;
+         bytes[1] = (id >> 16) & 0xFF;
+         bytes[2] = (id >> 8) & 0xFF;
+         bytes[3] = id & 0xFF;
+     }
+
+     uint8_t prio() const { return (bytes[0] >> 1) & 0x0F; }
+     uint8_t command() const { return ((bytes[0] & 0x01) << 7) | (bytes[1] >> 1); }
+     bool response() const { return bytes[1] & 0x01; }
+     uint16_t hash() const { return (static_cast<uint16_t>(bytes[2]) << 8) | bytes[3]; }
+     uint8_t length() const { return bytes[4]; }
+     const uint8_t *data() const { return bytes + 5; }
+     uint8_t *data() { return bytes + 5; }
+
+     /**
+      * Replaces the hash while leaving the rest of the identifier
+      * alone. Used when forwarding frames under our own hash.
+      */
+     void setHash(uint16_t hash)
+     {
+         bytes[2] = hash >> 8;
+         bytes[3] = hash & 0xFF;
+     }
+
+     /**
+      * Clears the frame, setting all bytes to zero.
+      */
+     void clear() { memset(bytes, 0x00, SIZE); }
+
+     /**
+      * Converts from and to a TrackMessage.
+      */
+     void fromMessage(const TrackMessage &message);
+     void toMessage(TrackMessage &message) const;
+
+     /**
+      * Converts from and to the CANMessage of the ACAN libraries.
+      */
+     void fromCAN(const CANMessage &frame);
+     void toCAN(CANMessage &frame) const;
+ };
+
+ static_assert(sizeof(TrackFrame) == TrackFrame::SIZE, "TrackFrame must stay packed to 13 bytes");
+
+ // ===================================================================
+ // === TrackFrameView ================================================
+ // ===================================================================
+
+ /**
+  * A view over a CANMessage of the ACAN libraries that exposes the
+  * same accessors as TrackFrame and TrackMessage without copying
+  * anything. A CANMessage is 16 bytes, so queues and rings can keep
+  * the frames exactly as the driver delivered them and move them
+  * around with one 16 byte copy, decoding fields only where needed.
+  */
+ class TrackFrameView
+ {
+ private:
+     CANMessage &mFrame;
+
+ public:
+     explicit TrackFrameView(CANMessage &frame) : mFrame(frame) {}
+
+     uint8_t prio() const { return TrackCommand::prio(mFrame.id); }
+     uint8_t command() const { return TrackCommand::command(mFrame.id); }
+     bool response() const { return TrackCommand::response(mFrame.id); }
+     uint16_t hash() const { return TrackCommand::hash(mFrame.id); }
+     uint8_t length() const { return mFrame.len; }
+     const uint8_t *data() const { return mFrame.data; }
+
+     /**
+      * Returns the locomotive or accessory address (data[2..3]).
+      */
+     uint16_t address() const { return (static_cast<uint16_t>(mFrame.data[2]) << 8) | mFrame.data[3]; }
+
+     /**
+      * Fills the underlying CANMessage from a TrackMessage: one
+      * identifier write and one 8 byte copy.
+      */
+     void fromMessage(const TrackMessage &message)
+     {
+         mFrame.id = TrackCommand::canId(message);
+         mFrame.ext = true;
+         mFrame.rtr = false;
+         mFrame.len = message.length;
+         memcpy(mFrame.data, message.data, 8);
+     }
+
+     /**
+      * Fills a TrackMessage from the underlying CANMessage. Data bytes
+      * beyond the length are cleared, as TrackMessage::clear() would.
+      */
+     void toMessage(TrackMessage &message) const
+     {
+         const uint8_t length = mFrame.len > 8 ? 8 : mFrame.len;
+         message.prio = prio();
+         message.command = command();
+         message.response = response();
+         message.hash = hash();
+         message.length = length;
+         memcpy(message.data, mFrame.data, length);
+         memset(message.data + length, 0x00, 8 - length);
+     }
+ };
+
+ #endif // TRACKFRAME_H
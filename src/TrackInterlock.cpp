@@ -0,0 +1,218 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackInterlock.h"
+#include "TrackCommand.h"
+#include "TrackClock.h"
+
+/* -------------------------------------------------------------------
+   TrackInterlock (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackInterlock::TrackInterlock(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mCount(0),
+      mEmergency(false)
+{
+    memset(mBlocks, 0x00, sizeof(mBlocks));
+    memset(&mReaction, 0x00, sizeof(mReaction));
+    memset(&mConfirmation, 0x00, sizeof(mConfirmation));
+    mCtrl.addListener(this);
+}
+
+TrackInterlock::~TrackInterlock()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::addBlock / setNext
+-------------------------------------------------------------------  */
+
+int8_t TrackInterlock::addBlock(uint16_t contact, int8_t next)
+{
+    if (mCount == TRACK_MAX_BLOCKS)
+        return -1;
+
+    Block &block = mBlocks[mCount];
+    block.contact = contact;
+    block.next = next;
+    return mCount++;
+}
+
+void TrackInterlock::setNext(int8_t block, int8_t next)
+{
+    if (block >= 0 && block < mCount && next < mCount)
+        mBlocks[block].next = next;
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::setLoco / getLoco / isOccupied
+-------------------------------------------------------------------  */
+
+void TrackInterlock::setLoco(int8_t block, uint16_t address)
+{
+    if (block >= 0 && block < mCount)
+        mBlocks[block].loco = address;
+}
+
+uint16_t TrackInterlock::getLoco(int8_t block) const
+{
+    return block >= 0 && block < mCount ? mBlocks[block].loco : 0;
+}
+
+bool TrackInterlock::isOccupied(int8_t block) const
+{
+    return block >= 0 && block < mCount && mBlocks[block].occupied;
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::record / report
+-------------------------------------------------------------------  */
+
+void TrackInterlock::record(Latency &latency, uint32_t value)
+{
+    if (latency.count == 0 || value < latency.minimum)
+        latency.minimum = value;
+    if (value > latency.maximum)
+        latency.maximum = value;
+    latency.latest = value;
+    latency.sum += value;
+    latency.count++;
+}
+
+void TrackInterlock::report(const Latency &latency, TrackInterlockStats &stats)
+{
+    stats.count = latency.count;
+    stats.latest = latency.latest;
+    stats.minimum = latency.minimum;
+    stats.maximum = latency.maximum;
+    stats.average = latency.count ? latency.sum / latency.count : 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::getReaction / getConfirmation
+-------------------------------------------------------------------  */
+
+bool TrackInterlock::getReaction(TrackInterlockStats &stats) const
+{
+    report(mReaction, stats);
+    return stats.count != 0;
+}
+
+bool TrackInterlock::getConfirmation(TrackInterlockStats &stats) const
+{
+    report(mConfirmation, stats);
+    return stats.count != 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::stop
+-------------------------------------------------------------------  */
+
+void TrackInterlock::stop(Block &block, uint32_t start)
+{
+    if (block.loco == 0)
+        return; // Nobody knows who is there
+
+    // Straight to the CAN controller, no waiting for the response
+    TrackMessage message = mEmergency ? SystemCommand::emergency(block.loco) : LocoSpeed::set(block.loco, 0);
+    mCtrl.sendMessage(message);
+
+    record(mReaction, TrackClock::now() - start);
+    block.pending = true;
+    block.stopped = start;
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::confirm
+-------------------------------------------------------------------  */
+
+void TrackInterlock::confirm(uint16_t address)
+{
+    const uint32_t now = TrackClock::now();
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        Block &block = mBlocks[i];
+        if (block.pending && block.loco == address)
+        {
+            block.pending = false;
+            record(mConfirmation, now - block.stopped);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::onContact
+-------------------------------------------------------------------  */
+
+void TrackInterlock::onContact(uint16_t contact, uint8_t state)
+{
+    onContact(contact, state, TrackClock::now());
+}
+
+void TrackInterlock::onContact(uint16_t contact, uint8_t state, uint32_t start)
+{
+    for (uint8_t i = 0; i < mCount; i++)
+    {
+        Block &block = mBlocks[i];
+        if (block.contact != contact)
+            continue;
+
+        block.occupied = state != 0;
+        if (!block.occupied)
+        {
+            // Forget the loco once it is followed in another block
+            for (uint8_t j = 0; j < mCount && block.loco != 0; j++)
+                if (j != i && mBlocks[j].loco == block.loco)
+                    block.loco = 0;
+            continue;
+        }
+
+        // A train entering an empty block comes from the block before
+        for (uint8_t j = 0; j < mCount && block.loco == 0; j++)
+            if (mBlocks[j].next == i && mBlocks[j].occupied)
+                block.loco = mBlocks[j].loco;
+
+        if (block.next >= 0 && mBlocks[block.next].occupied)
+            stop(block, start);
+
+        // Any other train heading here must wait
+        for (uint8_t j = 0; j < mCount; j++)
+            if (mBlocks[j].next == i && mBlocks[j].occupied && mBlocks[j].loco != block.loco)
+                stop(mBlocks[j], start);
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackInterlock::onMessage
+-------------------------------------------------------------------  */
+
+void TrackInterlock::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (outgoing)
+        return;
+
+    if (message.command == CMD_S88_EVENT && message.length >= 6)
+        onContact(FeedbackEvent::contact(message), FeedbackEvent::state(message));
+    else if (!message.response)
+        return;
+    else if (message.command == CMD_LOCO_SPEED && message.length >= 6 && LocoSpeed::speed(message) == 0)
+        confirm(TrackCommand::address(message));
+    else if (message.command == CMD_SYSTEM && message.length >= 5 && SystemCommand::subcommand(message) == SYS_LOCO_STOP)
+        confirm(TrackCommand::uid(message));
+}
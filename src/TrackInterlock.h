@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKINTERLOCK_H
+ #define TRACKINTERLOCK_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ /**
+  * Summary of the stop latencies measured by TrackInterlock, in us.
+  */
+ struct TrackInterlockStats
+ {
+   uint32_t count;
+   uint32_t latest;
+   uint32_t minimum;
+   uint32_t maximum;
+   uint32_t average;
+ };
+
+ // ===================================================================
+ // === TrackInterlock ================================================
+ // ===================================================================
+
+ /**
+  * Stops a loco entering a block whose next block is occupied, and
+  * a loco heading for a block some other train just entered.
+  *
+  * Each block has one feedback contact, occupied while a train is in
+  * it, and the block it leads to. A loco is placed in its block once
+  * with setLoco(); when the next block gets occupied and has no loco
+  * yet, the loco is taken to have moved on, so it is followed along
+  * the line without help.
+  *
+  * The stop is sent from inside the receive path, as soon as the
+  * contact frame is read, without waiting for loop() to come round
+  * or for any response: a speed of 0, or an emergency stop if asked.
+  * Two latencies are measured from the moment the contact frame was
+  * read: until the stop was handed to the CAN controller (reaction),
+  * and until the connection box confirmed it (confirmation).
+  *
+  * "Read" is when the controller takes the frame from its receive
+  * queue, not when it came in: the time it waited in the CAN driver
+  * until update() or an exchange came round is not counted, and
+  * grows with what loop() does besides. The CAN drivers give no
+  * receive time; a sketch reading its contacts itself can pass the
+  * time it saw them to onContact().
+  */
+ class TrackInterlock : public TrackListener
+ {
+ private:
+   struct Block
+   {
+     uint16_t contact;
+     int8_t next;      // -1 for the end of a line
+     bool occupied;
+     uint16_t loco;    // 0 for none
+     bool pending;     // A stop waits for its confirmation
+     uint32_t stopped; // Time the contact causing the stop was read
+   };
+
+   struct Latency
+   {
+     uint32_t count;
+     uint32_t latest;
+     uint32_t minimum;
+     uint32_t maximum;
+     uint32_t sum;
+   };
+
+   TrackController &mCtrl;
+   Block mBlocks[TRACK_MAX_BLOCKS];
+   uint8_t mCount;
+   bool mEmergency;
+   Latency mReaction;
+   Latency mConfirmation;
+
+   void stop(Block &block, uint32_t start);
+   void confirm(uint16_t address);
+   static void record(Latency &latency, uint32_t value);
+   static void report(const Latency &latency, TrackInterlockStats &stats);
+
+ public:
+   /**
+    * Creates an interlock driving the given controller and registers
+    * it as a listener, so it sees feedback events.
+    */
+   TrackInterlock(TrackController &ctrl);
+   ~TrackInterlock();
+
+   /**
+    * Adds a block watched by the given contact, leading to the block
+    * 'next' (-1 for none). Returns its index, or -1 if all
+    * TRACK_MAX_BLOCKS blocks are taken. The next block can be given
+    * later with setNext(), for lines added in any order.
+    */
+   int8_t addBlock(uint16_t contact, int8_t next = -1);
+   void setNext(int8_t block, int8_t next);
+
+   /**
+    * Places a loco in a block, 0 for none.
+    */
+   void setLoco(int8_t block, uint16_t address);
+   uint16_t getLoco(int8_t block) const;
+   bool isOccupied(int8_t block) const;
+
+   /**
+    * Stops with an emergency stop instead of a speed of 0, so the
+    * loco does not brake on its own deceleration.
+    */
+   void setEmergency(bool emergency) { mEmergency = emergency; }
+
+   /**
+    * Gives the latencies of the stops made so far. Returns false if
+    * there are none.
+    */
+   bool getReaction(TrackInterlockStats &stats) const;
+   bool getConfirmation(TrackInterlockStats &stats) const;
+
+   /**
+    * Reports a feedback contact event: 'state' is 1 for occupied and
+    * 0 for free. For contacts read by the sketch itself; 'seen' is
+    * the TrackClock time the contact changed, by default now.
+    */
+   void onContact(uint16_t contact, uint8_t state);
+   void onContact(uint16_t contact, uint8_t state, uint32_t seen);
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKINTERLOCK_H
@@ -0,0 +1,336 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackLayout.h"
+#include "TrackCommand.h"
+
+static const uint8_t HEADER_SIZE = 5;
+static const uint8_t EDGE_SIZE = 9;
+static const uint16_t ACCESSORY_PULSE = 20;
+static const uint16_t UNREACHED = 0xFFFF;
+
+/* -------------------------------------------------------------------
+   blockBit
+-------------------------------------------------------------------  */
+
+static inline uint64_t blockBit(uint8_t block)
+{
+    return static_cast<uint64_t>(1) << block;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackLayout::TrackLayout(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mAccessories(nullptr),
+      mBlockCount(0),
+      mEdgeCount(0),
+      mOccupied(0),
+      mNextCache(0),
+      mSearches(0),
+      mHits(0)
+{
+    memset(mFirst, 0x00, sizeof(mFirst));
+    invalidate();
+    mCtrl.addListener(this);
+}
+
+TrackLayout::~TrackLayout()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::invalidate
+-------------------------------------------------------------------  */
+
+void TrackLayout::invalidate()
+{
+    for (uint8_t i = 0; i < TRACK_ROUTE_CACHE; i++)
+        mCache[i].from = NONE;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::load
+-------------------------------------------------------------------  */
+
+bool TrackLayout::load(const uint8_t *table, uint16_t size)
+{
+    mBlockCount = 0;
+    mEdgeCount = 0;
+    mOccupied = 0;
+    memset(mFirst, 0x00, sizeof(mFirst));
+    invalidate();
+
+    if (size < HEADER_SIZE || table[0] != 'L' || table[1] != 'G' || table[2] != VERSION)
+        return false;
+
+    const uint8_t blocks = table[3];
+    const uint8_t edges = table[4];
+    if (blocks > TRACK_LAYOUT_BLOCKS || edges > TRACK_LAYOUT_EDGES ||
+        size != HEADER_SIZE + 2 * blocks + EDGE_SIZE * edges)
+        return false;
+
+    const uint8_t *p = table + HEADER_SIZE;
+    for (uint8_t i = 0; i < blocks; i++, p += 2)
+        mContacts[i] = (p[0] << 8) | p[1];
+
+    for (uint8_t i = 0; i < edges; i++, p += EDGE_SIZE)
+    {
+        Edge edge;
+        edge.from = p[0];
+        edge.to = p[1];
+        edge.cost = p[2];
+        for (uint8_t s = 0; s < 2; s++)
+        {
+            edge.settings[s].address = (p[3 + 3 * s] << 8) | p[4 + 3 * s];
+            edge.settings[s].position = p[5 + 3 * s];
+        }
+        if (edge.from >= blocks || edge.to >= blocks)
+            return false;
+
+        // Insertion sort on 'from', so the edges leaving a block are together
+        uint8_t j = i;
+        for (; j > 0 && mEdges[j - 1].from > edge.from; j--)
+            mEdges[j] = mEdges[j - 1];
+        mEdges[j] = edge;
+    }
+
+    uint8_t e = 0;
+    for (uint8_t block = 0; block <= blocks; block++)
+    {
+        while (e < edges && mEdges[e].from < block)
+            e++;
+        mFirst[block] = e;
+    }
+
+    mBlockCount = blocks;
+    mEdgeCount = edges;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::blockOf
+-------------------------------------------------------------------  */
+
+uint8_t TrackLayout::blockOf(uint16_t contact) const
+{
+    for (uint8_t i = 0; i < mBlockCount; i++)
+        if (contact != 0 && mContacts[i] == contact)
+            return i;
+    return NONE;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::setOccupied / isOccupied
+-------------------------------------------------------------------  */
+
+void TrackLayout::setOccupied(uint8_t block, bool occupied)
+{
+    if (block >= mBlockCount)
+        return;
+    if (occupied)
+        mOccupied |= blockBit(block);
+    else
+        mOccupied &= ~blockBit(block);
+}
+
+bool TrackLayout::isOccupied(uint8_t block) const
+{
+    return block < mBlockCount && (mOccupied & blockBit(block)) != 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::search
+
+   Dijkstra with a linear scan for the nearest block: with at most 64
+   blocks that beats a heap, and needs no memory beyond two arrays.
+-------------------------------------------------------------------  */
+
+bool TrackLayout::search(uint8_t from, uint8_t to, Cached &entry)
+{
+    uint16_t distance[TRACK_LAYOUT_BLOCKS];
+    uint8_t via[TRACK_LAYOUT_BLOCKS]; // Edge the best route arrives by
+    Mask settled = 0;
+    Mask touched = 0;
+
+    mSearches++;
+    for (uint8_t i = 0; i < mBlockCount; i++)
+    {
+        distance[i] = UNREACHED;
+        via[i] = NONE;
+    }
+    distance[from] = 0;
+
+    for (;;)
+    {
+        uint8_t nearest = NONE;
+        for (uint8_t i = 0; i < mBlockCount; i++)
+            if ((settled & blockBit(i)) == 0 && distance[i] != UNREACHED && (nearest == NONE || distance[i] < distance[nearest]))
+                nearest = i;
+        if (nearest == NONE)
+            return false;
+
+        settled |= blockBit(nearest);
+        if (nearest == to)
+            break;
+
+        for (uint8_t e = mFirst[nearest]; e < mFirst[nearest + 1]; e++)
+        {
+            const Edge &edge = mEdges[e];
+            if (mOccupied & blockBit(edge.to))
+            {
+                touched |= blockBit(edge.to); // Getting free could give a better route
+                continue;
+            }
+            const uint16_t d = distance[nearest] + edge.cost;
+            if ((settled & blockBit(edge.to)) == 0 && d < distance[edge.to])
+            {
+                distance[edge.to] = d;
+                via[edge.to] = e;
+            }
+        }
+    }
+
+    uint8_t length = 0;
+    for (uint8_t block = to; block != from; block = mEdges[via[block]].from)
+        length++;
+
+    entry.from = from;
+    entry.to = to;
+    entry.cost = distance[to];
+    entry.length = length + 1;
+    entry.blocks = blockBit(from);
+    for (uint8_t block = to; block != from; block = mEdges[via[block]].from)
+    {
+        entry.edges[--length] = via[block];
+        entry.blocks |= blockBit(block);
+    }
+    entry.occupied = mOccupied;
+    entry.touched = touched & ~blockBit(from);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::fill
+-------------------------------------------------------------------  */
+
+void TrackLayout::fill(const Cached &entry, TrackRoute &route) const
+{
+    route.length = entry.length;
+    route.cost = entry.cost;
+    route.changeCount = 0;
+    route.blocks[0] = entry.from;
+
+    for (uint8_t i = 0; i + 1 < entry.length; i++)
+    {
+        const Edge &edge = mEdges[entry.edges[i]];
+        route.blocks[i + 1] = edge.to;
+
+        for (uint8_t s = 0; s < 2; s++)
+        {
+            const TrackRouteChange &setting = edge.settings[s];
+            uint8_t position;
+            if (setting.address == 0)
+                continue;
+            if (mAccessories != nullptr && mAccessories->getPosition(setting.address, &position) &&
+                position == setting.position)
+                continue; // Already there
+
+            bool listed = false;
+            for (uint8_t c = 0; c < route.changeCount && !listed; c++)
+                listed = route.changes[c].address == setting.address;
+            if (!listed)
+                route.changes[route.changeCount++] = setting;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::findRoute
+-------------------------------------------------------------------  */
+
+bool TrackLayout::findRoute(uint8_t from, uint8_t to, TrackRoute &route)
+{
+    if (from >= mBlockCount || to >= mBlockCount || (to != from && isOccupied(to)))
+        return false;
+
+    Cached *entry = nullptr;
+    for (uint8_t i = 0; i < TRACK_ROUTE_CACHE && entry == nullptr; i++)
+        if (mCache[i].from == from && mCache[i].to == to)
+            entry = &mCache[i];
+
+    if (entry != nullptr)
+    {
+        // Still passable, and no block in the way got free
+        const Mask others = mOccupied & ~blockBit(from);
+        if ((others & entry->blocks) == 0 && (entry->occupied & ~mOccupied & entry->touched) == 0)
+        {
+            mHits++;
+            fill(*entry, route);
+            return true;
+        }
+    }
+    else
+    {
+        entry = &mCache[mNextCache];
+        mNextCache = (mNextCache + 1) % TRACK_ROUTE_CACHE;
+    }
+
+    if (!search(from, to, *entry))
+    {
+        entry->from = NONE;
+        return false;
+    }
+    fill(*entry, route);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::setRoute
+-------------------------------------------------------------------  */
+
+bool TrackLayout::setRoute(const TrackRoute &route)
+{
+    bool ok = true;
+    for (uint8_t i = 0; i < route.changeCount; i++)
+        ok = mCtrl.setAccessory(route.changes[i].address, route.changes[i].position, 1, ACCESSORY_PULSE) && ok;
+    return ok;
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::onContact
+-------------------------------------------------------------------  */
+
+void TrackLayout::onContact(uint16_t contact, uint8_t state)
+{
+    for (uint8_t i = 0; i < mBlockCount; i++)
+        if (contact != 0 && mContacts[i] == contact)
+            setOccupied(i, state != 0);
+}
+
+/* -------------------------------------------------------------------
+   TrackLayout::onMessage
+-------------------------------------------------------------------  */
+
+void TrackLayout::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (!outgoing && message.command == CMD_S88_EVENT && message.length >= 6)
+        onContact(FeedbackEvent::contact(message), FeedbackEvent::state(message));
+}
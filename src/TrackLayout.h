@@ -0,0 +1,180 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKLAYOUT_H
+ #define TRACKLAYOUT_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackAccessoryTable.h"
+
+ /**
+  * One accessory to switch for a route.
+  */
+ struct TrackRouteChange
+ {
+   uint16_t address;
+   uint8_t position;
+ };
+
+ /**
+  * A route found by TrackLayout: the blocks from start to end, its
+  * cost and the accessories that are not yet where it needs them.
+  */
+ struct TrackRoute
+ {
+   uint8_t blocks[TRACK_LAYOUT_BLOCKS];
+   uint8_t length;
+   uint16_t cost;
+   TrackRouteChange changes[2 * TRACK_LAYOUT_BLOCKS];
+   uint8_t changeCount;
+ };
+
+ // ===================================================================
+ // === TrackLayout ===================================================
+ // ===================================================================
+
+ /**
+  * A graph of the layout: blocks, each with its feedback contact,
+  * and one way connections between them, each with a cost (its
+  * length, say) and up to two accessories to set to pass it,
+  * turnouts or signals. It is loaded from a binary table, big
+  * endian like the CAN frames:
+  *
+  *   'L' 'G' version blocks edges
+  *   blocks x (contact:16)                0 for no contact
+  *   edges x (from to cost (address:16 position) x 2)   address 0 for none
+  *
+  * findRoute() gives the cheapest route through free blocks between
+  * two blocks, with the accessories to switch: those the accessory
+  * table, if set, does not already know in the right position. Found
+  * routes are cached. A cached route is still the best one as long
+  * as none of its blocks got occupied and none of the occupied
+  * blocks the search ran into got free, which is checked with a few
+  * bit operations, so occupancy changes elsewhere on the layout do
+  * not cost a new search.
+  */
+ class TrackLayout : public TrackListener
+ {
+ public:
+   static const uint8_t VERSION = 1;
+   static const uint8_t NONE = 0xFF;
+
+   static_assert(TRACK_LAYOUT_BLOCKS <= 64, "A route is tracked in a 64 bit mask");
+   static_assert(TRACK_LAYOUT_EDGES < 255, "TRACK_LAYOUT_EDGES too large");
+
+ private:
+   typedef uint64_t Mask; // Bit n for block n
+
+   struct Edge
+   {
+     uint8_t from;
+     uint8_t to;
+     uint8_t cost;
+     TrackRouteChange settings[2]; // Address 0 for none
+   };
+
+   struct Cached
+   {
+     uint8_t from; // NONE for a free entry
+     uint8_t to;
+     uint16_t cost;
+     uint8_t length;
+     uint8_t edges[TRACK_LAYOUT_BLOCKS - 1];
+     Mask blocks;   // Blocks of the route
+     Mask occupied; // Occupied blocks at the time of the search
+     Mask touched;  // Occupied blocks the search would have entered
+   };
+
+   TrackController &mCtrl;
+   TrackAccessoryTable *mAccessories;
+   uint16_t mContacts[TRACK_LAYOUT_BLOCKS];
+   Edge mEdges[TRACK_LAYOUT_EDGES]; // Sorted by 'from'
+   uint8_t mFirst[TRACK_LAYOUT_BLOCKS + 1]; // First edge leaving each block
+   uint8_t mBlockCount;
+   uint8_t mEdgeCount;
+   Mask mOccupied;
+   Cached mCache[TRACK_ROUTE_CACHE];
+   uint8_t mNextCache;
+   uint32_t mSearches;
+   uint32_t mHits;
+
+   bool search(uint8_t from, uint8_t to, Cached &entry);
+   void fill(const Cached &entry, TrackRoute &route) const;
+   void invalidate();
+
+ public:
+   TrackLayout(TrackController &ctrl);
+   ~TrackLayout();
+
+   /**
+    * Loads the graph from a binary table of 'size' bytes. The table
+    * is copied, so it can be a buffer read from a file. Returns false
+    * and leaves an empty graph if it is not valid or too large.
+    */
+   bool load(const uint8_t *table, uint16_t size);
+
+   /**
+    * Uses the given accessory table to leave out the accessories
+    * already in position, nullptr to switch them all.
+    */
+   void setAccessories(TrackAccessoryTable *accessories) { mAccessories = accessories; }
+
+   uint8_t getBlockCount() const { return mBlockCount; }
+
+   /**
+    * Returns the block watched by the given contact, NONE if there is
+    * none.
+    */
+   uint8_t blockOf(uint16_t contact) const;
+
+   /**
+    * Marks a block occupied or free. Contact events on the bus do it
+    * on their own.
+    */
+   void setOccupied(uint8_t block, bool occupied);
+   bool isOccupied(uint8_t block) const;
+
+   /**
+    * Finds the cheapest route from 'from', where the train is, to the
+    * free block 'to' through free blocks. Returns false if there is
+    * none.
+    */
+   bool findRoute(uint8_t from, uint8_t to, TrackRoute &route);
+
+   /**
+    * Switches the accessories of a route, one after the other.
+    * Returns false if one of them failed.
+    */
+   bool setRoute(const TrackRoute &route);
+
+   /**
+    * Counters: searches run and routes taken from the cache.
+    */
+   uint32_t getSearches() const { return mSearches; }
+   uint32_t getCacheHits() const { return mHits; }
+
+   /**
+    * Reports a feedback contact event: 'state' is 1 for occupied and
+    * 0 for free. For contacts read by the sketch itself.
+    */
+   void onContact(uint16_t contact, uint8_t state);
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKLAYOUT_H
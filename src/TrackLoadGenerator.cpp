@@ -0,0 +1,240 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include <stdlib.h>
+#include "TrackLoadGenerator.h"
+#include "TrackCommand.h"
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator::Timed
+-------------------------------------------------------------------  */
+
+void TrackLoadGenerator::Timed::onMessage(const TrackMessage &message, bool outgoing)
+{
+    const uint32_t start = micros();
+    mInner.onMessage(message, outgoing);
+    spent += micros() - start;
+}
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackLoadGenerator::TrackLoadGenerator(TrackController &ctrl, uint32_t timeout)
+    : mCtrl(ctrl),
+      mBox(ctrl),
+      mRequests(ctrl),
+      mLocos(ctrl),
+      mAccessories(ctrl),
+      mTimedBox(mBox),
+      mTimedRequests(mRequests),
+      mTimedLocos(mLocos),
+      mTimedAccessories(mAccessories),
+      mTimeout(timeout),
+      mSampleCount(0)
+{
+    // Put the timing wrappers in place of the listeners themselves
+    mCtrl.removeListener(&mBox);
+    mCtrl.removeListener(&mRequests);
+    mCtrl.removeListener(&mLocos);
+    mCtrl.removeListener(&mAccessories);
+    mCtrl.addListener(&mTimedBox);
+    mCtrl.addListener(&mTimedRequests);
+    mCtrl.addListener(&mTimedLocos);
+    mCtrl.addListener(&mTimedAccessories);
+}
+
+TrackLoadGenerator::~TrackLoadGenerator()
+{
+    mCtrl.removeListener(&mTimedBox);
+    mCtrl.removeListener(&mTimedRequests);
+    mCtrl.removeListener(&mTimedLocos);
+    mCtrl.removeListener(&mTimedAccessories);
+}
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator::addSample / percentile
+-------------------------------------------------------------------  */
+
+void TrackLoadGenerator::addSample(uint32_t latency)
+{
+    // Reservoir sampling: every latency has the same chance to be kept
+    if (mSampleCount < TRACK_LOAD_SAMPLES)
+        mSamples[mSampleCount] = latency;
+    else
+    {
+        const uint32_t slot = random(mSampleCount + 1);
+        if (slot < TRACK_LOAD_SAMPLES)
+            mSamples[slot] = latency;
+    }
+    mSampleCount++;
+}
+
+uint32_t TrackLoadGenerator::percentile(uint8_t percent) const
+{
+    const uint16_t kept = mSampleCount < TRACK_LOAD_SAMPLES ? mSampleCount : TRACK_LOAD_SAMPLES;
+    return kept ? mSamples[(static_cast<uint32_t>(kept - 1) * percent) / 100] : 0;
+}
+
+static int compareSamples(const void *a, const void *b)
+{
+    const uint32_t x = *static_cast<const uint32_t *>(a);
+    const uint32_t y = *static_cast<const uint32_t *>(b);
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator::startOperation
+-------------------------------------------------------------------  */
+
+uint8_t TrackLoadGenerator::startOperation(const TrackLoadStats &stats, uint32_t &dropped)
+{
+    const uint8_t dice = random(100);
+
+    if (dice < THROTTLE_SHARE || (stats.accessories == 0 && stats.contacts == 0))
+    {
+        TrackMessage message = LocoSpeed::set(ADDR_MFX + 1 + random(stats.locos), random(1001));
+        return mRequests.send(message, mTimeout);
+    }
+    if (dice < THROTTLE_SHARE + ACCESSORY_SHARE || stats.contacts == 0)
+    {
+        TrackMessage message = Accessory::set(ADDR_ACC_MM2 + 1 + random(stats.accessories), random(2), 1);
+        return mRequests.send(message, mTimeout);
+    }
+
+    // Contacts need no answer: the client starts another one next time
+    if (!mCtrl.injectMessage(FeedbackEvent::make(1, 1 + random(stats.contacts), random(2))))
+        dropped++;
+    return 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator::run
+-------------------------------------------------------------------  */
+
+void TrackLoadGenerator::run(uint16_t locos, uint16_t accessories, uint16_t contacts, uint8_t clients, uint32_t ms, TrackLoadStats &stats)
+{
+    uint8_t handles[TRACK_MAX_REQUESTS] = {0};
+    uint32_t completed = 0;
+    uint32_t dropped = 0;
+    uint32_t controller = 0;
+    const uint32_t boxDropped = mBox.getDropped();
+
+    memset(&stats, 0x00, sizeof(stats));
+    stats.locos = locos;
+    stats.accessories = accessories;
+    stats.contacts = contacts;
+    stats.clients = clients = clients < TRACK_MAX_REQUESTS ? clients : TRACK_MAX_REQUESTS;
+
+    mSampleCount = 0;
+    mTimedBox.spent = 0;
+    mTimedRequests.spent = 0;
+    mTimedLocos.spent = 0;
+    mTimedAccessories.spent = 0;
+    mLocos.clear();
+    mAccessories.clear();
+
+    const uint32_t start = millis();
+    while (millis() - start < ms)
+    {
+        const uint32_t begin = micros();
+        mCtrl.update();
+        mRequests.update();
+
+        for (uint8_t c = 0; c < clients; c++)
+        {
+            uint8_t &handle = handles[c];
+            if (handle != 0)
+            {
+                TrackMessage response;
+                uint32_t latency;
+                const uint8_t state = mRequests.getState(handle);
+                if (state == REQUEST_DONE && mRequests.take(handle, response, &latency))
+                {
+                    addSample(latency);
+                    completed++;
+                    handle = 0;
+                }
+                else if (state == REQUEST_TIMEOUT)
+                {
+                    mRequests.release(handle);
+                    dropped++;
+                    handle = 0;
+                }
+            }
+            if (handle == 0)
+                handle = startOperation(stats, dropped);
+        }
+        controller += micros() - begin;
+    }
+
+    // Let the last requests finish, so the next step starts clean
+    const uint32_t drain = millis();
+    while (millis() - drain < 50)
+    {
+        mCtrl.update();
+        mRequests.update();
+    }
+    for (uint8_t c = 0; c < clients; c++)
+        if (handles[c] != 0)
+            mRequests.release(handles[c]);
+
+    for (uint8_t i = 0; i < TRACK_MAX_LOCOS; i++)
+        if (mLocos.getSlot(i).address != 0)
+            stats.tracked++;
+
+    const uint32_t listeners = mTimedBox.spent + mTimedRequests.spent + mTimedLocos.spent + mTimedAccessories.spent;
+    controller = controller > listeners ? controller - listeners : 0;
+    const uint16_t kept = mSampleCount < TRACK_LOAD_SAMPLES ? mSampleCount : TRACK_LOAD_SAMPLES;
+    qsort(mSamples, kept, sizeof(mSamples[0]), compareSamples);
+
+    const uint32_t total = ms; // us per 0.1 %
+    stats.rate = completed * 1000UL / ms;
+    stats.median = percentile(50);
+    stats.p99 = percentile(99);
+    stats.dropped = dropped + mBox.getDropped() - boxDropped;
+    stats.controller = controller / total;
+    stats.box = mTimedBox.spent / total;
+    stats.requests = mTimedRequests.spent / total;
+    stats.locoTable = mTimedLocos.spent / total;
+    stats.accessoryTable = mTimedAccessories.spent / total;
+}
+
+/* -------------------------------------------------------------------
+   TrackLoadGenerator::printHeader / print
+-------------------------------------------------------------------  */
+
+void TrackLoadGenerator::printHeader(Print &p)
+{
+    p.println(F("locos kept   acc cont  C    cmd/s  p50 us  p99 us dropped  ctrl%   box%   req%  locos%   acc%"));
+}
+
+void TrackLoadGenerator::print(Print &p, const TrackLoadStats &stats)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%5u %3u%c %5u %4u %2u %8lu %7lu %7lu %7lu %4u.%u %4u.%u %4u.%u %5u.%u %4u.%u",
+             stats.locos, stats.tracked, stats.tracked < stats.locos ? '*' : ' ',
+             stats.accessories, stats.contacts, stats.clients,
+             (unsigned long)stats.rate, (unsigned long)stats.median,
+             (unsigned long)stats.p99, (unsigned long)stats.dropped,
+             stats.controller / 10, stats.controller % 10,
+             stats.box / 10, stats.box % 10,
+             stats.requests / 10, stats.requests % 10,
+             stats.locoTable / 10, stats.locoTable % 10,
+             stats.accessoryTable / 10, stats.accessoryTable % 10);
+    p.println(line);
+}
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKLOADGENERATOR_H
+ #define TRACKLOADGENERATOR_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackSimulator.h"
+ #include "TrackRequests.h"
+ #include "TrackLocoTable.h"
+ #include "TrackAccessoryTable.h"
+
+ /**
+  * Result of one step of TrackLoadGenerator. Latencies are in us,
+  * CPU shares in per mille of the step.
+  */
+ struct TrackLoadStats
+ {
+   uint16_t locos;
+   uint16_t accessories;
+   uint16_t contacts;
+   uint8_t clients;
+   uint16_t tracked; // Locos kept by the loco table, at most TRACK_MAX_LOCOS
+   uint32_t rate;    // Commands completed per second
+   uint32_t median;
+   uint32_t p99;
+   uint32_t dropped;
+   uint16_t controller;
+   uint16_t box;
+   uint16_t requests;
+   uint16_t locoTable;
+   uint16_t accessoryTable;
+ };
+
+ // ===================================================================
+ // === TrackLoadGenerator ============================================
+ // ===================================================================
+
+ /**
+  * Measures how far one controller scales. A simulated connection
+  * box (TrackSimulator) answers everything, and the generator drives
+  * it with random throttle changes for N locos, accessory changes
+  * for M accessories and events from K feedback contacts, issued by
+  * C clients that each keep one request in flight (TrackRequests).
+  *
+  * Each step gives throughput, median and 99th percentile command
+  * latency, frames dropped (no room in the receive path, or no
+  * response in time) and the share of CPU time taken by each part:
+  * the controller itself (sending, receiving, matching), the box,
+  * the request tracker and the loco and accessory tables.
+  *
+  * The loco table keeps TRACK_MAX_LOCOS locos and forgets the oldest
+  * beyond that, so with more locos its cost no longer grows with the
+  * layout; 'tracked' tells how many it held.
+  *
+  * The generator brings the box, the tracker and the tables along
+  * and takes four listener slots of a controller of its own, with
+  * loopback on.
+  */
+ class TrackLoadGenerator
+ {
+ private:
+   /**
+    * Stands in for a listener and counts the time it takes.
+    */
+   class Timed : public TrackListener
+   {
+   private:
+     TrackListener &mInner;
+
+   public:
+     uint32_t spent;
+
+     Timed(TrackListener &inner) : mInner(inner), spent(0) {}
+     void onMessage(const TrackMessage &message, bool outgoing) override;
+   };
+
+   TrackController &mCtrl;
+   TrackSimulator mBox;
+   TrackRequests mRequests;
+   TrackLocoTable mLocos;
+   TrackAccessoryTable mAccessories;
+   Timed mTimedBox;
+   Timed mTimedRequests;
+   Timed mTimedLocos;
+   Timed mTimedAccessories;
+   uint32_t mTimeout;
+   uint32_t mSamples[TRACK_LOAD_SAMPLES];
+   uint32_t mSampleCount; // All latencies seen, of which TRACK_LOAD_SAMPLES are kept
+
+   void addSample(uint32_t latency);
+   uint32_t percentile(uint8_t percent) const;
+   uint8_t startOperation(const TrackLoadStats &stats, uint32_t &dropped);
+
+ public:
+   static const uint8_t THROTTLE_SHARE = 70;  // Percent of the operations, the rest is split
+   static const uint8_t ACCESSORY_SHARE = 20; // between accessories and contacts
+
+   /**
+    * Creates a generator driving the given controller. A request
+    * without a response after 'timeout' us counts as dropped.
+    */
+   TrackLoadGenerator(TrackController &ctrl, uint32_t timeout = 20000);
+   ~TrackLoadGenerator();
+
+   /**
+    * Runs one step for 'ms' milliseconds and fills 'stats'.
+    */
+   void run(uint16_t locos, uint16_t accessories, uint16_t contacts, uint8_t clients, uint32_t ms, TrackLoadStats &stats);
+
+   /**
+    * Prints the column titles, and one step as a line below them.
+    */
+   static void printHeader(Print &p);
+   static void print(Print &p, const TrackLoadStats &stats);
+ };
+
+ #endif // TRACKLOADGENERATOR_H
@@ -0,0 +1,332 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackLocoTable.h"
+#include "TrackCommand.h"
+
+/* -------------------------------------------------------------------
+   TrackLocoTable (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackLocoTable::TrackLocoTable(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mNext(0),
+      mSteps{14, 31, 126, 127, 28}
+{
+    clear();
+    mCtrl.addListener(this);
+}
+
+TrackLocoTable::~TrackLocoTable()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::find
+-------------------------------------------------------------------  */
+
+TrackLocoTable::Loco *TrackLocoTable::find(uint16_t address)
+{
+    for (uint8_t i = 0; i < TRACK_MAX_LOCOS; i++)
+        if (mLocos[i].address == address)
+            return &mLocos[i];
+    return nullptr;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::findOrCreate
+-------------------------------------------------------------------  */
+
+TrackLocoTable::Loco *TrackLocoTable::findOrCreate(uint16_t address)
+{
+    Loco *loco = find(address);
+    if (loco != nullptr || address == 0)
+        return loco;
+
+    loco = find(0);
+    if (loco == nullptr)
+    {
+        loco = &mLocos[mNext]; // Table full, forget the oldest
+        mNext = (mNext + 1) % TRACK_MAX_LOCOS;
+    }
+
+    memset(loco, 0x00, sizeof(Loco));
+    loco->address = address;
+    return loco;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::getFunctions
+-------------------------------------------------------------------  */
+
+bool TrackLocoTable::getFunctions(uint16_t address, uint32_t *functions, uint32_t *known)
+{
+    Loco *loco = find(address);
+    if (loco == nullptr || address == 0)
+        return false;
+
+    *functions = loco->functions;
+    if (known != nullptr)
+        *known = loco->known;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::getSpeed / getDirection
+-------------------------------------------------------------------  */
+
+bool TrackLocoTable::getSpeed(uint16_t address, uint16_t *speed)
+{
+    Loco *loco = find(address);
+    if (loco == nullptr || address == 0 || (loco->flags & SPEED_KNOWN) == 0)
+        return false;
+
+    *speed = loco->speed;
+    return true;
+}
+
+bool TrackLocoTable::getDirection(uint16_t address, uint8_t *direction)
+{
+    Loco *loco = find(address);
+    if (loco == nullptr || address == 0 || (loco->flags & DIRECTION_KNOWN) == 0)
+        return false;
+
+    *direction = loco->direction;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::setFunctions
+-------------------------------------------------------------------  */
+
+uint8_t TrackLocoTable::setFunctions(uint16_t address, uint32_t mask, uint32_t values)
+{
+    Loco *loco = findOrCreate(address);
+    if (loco == nullptr)
+        return 0;
+
+    uint32_t pending = mask & ((loco->functions ^ values) | ~loco->known);
+    uint8_t sent = 0;
+
+    for (uint8_t function = 0; pending != 0; function++, pending >>= 1)
+    {
+        if ((pending & 0x01) == 0)
+            continue;
+
+        // The table is updated by onMessage() once the frame went out
+        TrackMessage message = LocoFunction::set(address, function, (values >> function) & 0x01);
+        if (!mCtrl.sendMessage(message))
+            break;
+        sent++;
+    }
+
+    return sent;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::protocolOf
+-------------------------------------------------------------------  */
+
+int8_t TrackLocoTable::protocolOf(uint16_t address)
+{
+    if (address >= ADDR_DCC)
+        return 4;
+    if (address >= ADDR_SX2)
+        return 3;
+    if (address >= ADDR_MFX)
+        return 2;
+    if (address >= ADDR_SX1)
+        return address < ADDR_SX1 + 0x0400 ? 1 : -1;
+    return address < 0x0400 ? 0 : -1;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::setSteps / getSteps
+-------------------------------------------------------------------  */
+
+void TrackLocoTable::setSteps(uint16_t base, uint8_t steps)
+{
+    const int8_t protocol = protocolOf(base);
+    if (protocol >= 0)
+        mSteps[protocol] = steps;
+}
+
+uint8_t TrackLocoTable::getSteps(uint16_t address) const
+{
+    const int8_t protocol = protocolOf(address);
+    return protocol >= 0 ? mSteps[protocol] : 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::suppressSpeed
+
+   How the connection box maps 0..1000 to steps is not documented, so
+   two speeds count as the same step only if they do when rounding
+   down and when rounding up. Speed 0 is a step of its own either way.
+-------------------------------------------------------------------  */
+
+bool TrackLocoTable::suppressSpeed(uint16_t address, uint16_t speed)
+{
+    Loco *loco = find(address);
+    const uint32_t steps = getSteps(address);
+    if (loco == nullptr || address == 0 || steps == 0 || (loco->flags & SPEED_KNOWN) == 0)
+        return false;
+
+    const uint32_t from = loco->speed > 1000 ? 1000 : loco->speed;
+    const uint32_t to = speed > 1000 ? 1000 : speed;
+    if (from * steps / 1000 != to * steps / 1000 || (from * steps + 999) / 1000 != (to * steps + 999) / 1000)
+        return false;
+
+    if (loco->suppressed < 0xFFFF)
+        loco->suppressed++;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::getSuppressed
+-------------------------------------------------------------------  */
+
+uint16_t TrackLocoTable::getSuppressed(uint16_t address)
+{
+    Loco *loco = find(address);
+    return loco != nullptr && address != 0 ? loco->suppressed : 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::forget
+-------------------------------------------------------------------  */
+
+void TrackLocoTable::forget(uint16_t address)
+{
+    Loco *loco = find(address);
+    if (loco != nullptr && address != 0)
+        loco->address = 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::clear
+-------------------------------------------------------------------  */
+
+void TrackLocoTable::clear()
+{
+    memset(mLocos, 0x00, sizeof(mLocos));
+    mNext = 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::restore
+-------------------------------------------------------------------  */
+
+void TrackLocoTable::restore(const Loco &loco)
+{
+    Loco *slot = findOrCreate(loco.address);
+    if (slot != nullptr)
+        *slot = loco;
+}
+
+/* -------------------------------------------------------------------
+   TrackLocoTable::onMessage
+-------------------------------------------------------------------  */
+
+void TrackLocoTable::onMessage(const TrackMessage &message, bool)
+{
+    // Both a command and its response carry the new state; queries do not
+    switch (message.command)
+    {
+    case CMD_LOCO_SPEED:
+    {
+        if (message.length < 6)
+            return;
+        Loco *loco = findOrCreate(TrackCommand::address(message));
+        if (loco == nullptr)
+            return;
+        loco->speed = LocoSpeed::speed(message);
+        loco->flags |= SPEED_KNOWN;
+        break;
+    }
+    case CMD_LOCO_DIR:
+    {
+        const uint8_t direction = LocoDirection::direction(message);
+        if (message.length < 5 || direction == DIR_CURRENT)
+            return;
+        Loco *loco = findOrCreate(TrackCommand::address(message));
+        if (loco == nullptr)
+            return;
+        if (!message.response)
+        {
+            // A direction command stops the loco; a toggle waits for the answer
+            loco->speed = 0;
+            loco->flags |= SPEED_KNOWN;
+            if (direction == DIR_CHANGE)
+                return;
+        }
+        if (direction == DIR_FORWARD || direction == DIR_REVERSE)
+        {
+            loco->direction = direction;
+            loco->flags |= DIRECTION_KNOWN;
+        }
+        break;
+    }
+    case CMD_LOCO_FUNC:
+    {
+        if (message.length < 6)
+            return;
+        const uint8_t function = LocoFunction::function(message);
+        if (function > 31)
+            return;
+        Loco *loco = findOrCreate(TrackCommand::address(message));
+        if (loco == nullptr)
+            return;
+        const uint32_t bit = 1UL << function;
+        if (LocoFunction::power(message))
+            loco->functions |= bit;
+        else
+            loco->functions &= ~bit;
+        loco->known |= bit;
+        break;
+    }
+    case CMD_SYSTEM:
+    {
+        if (message.length < 5)
+            return;
+        const uint8_t subcommand = SystemCommand::subcommand(message);
+        if (subcommand == SYS_HALT)
+        {
+            // All locos stop, and stay stopped after go
+            for (uint8_t i = 0; i < TRACK_MAX_LOCOS; i++)
+            {
+                if (mLocos[i].address == 0)
+                    continue;
+                mLocos[i].speed = 0;
+                mLocos[i].flags |= SPEED_KNOWN;
+            }
+        }
+        else if (subcommand == SYS_LOCO_STOP && TrackCommand::uid(message) != 0 && TrackCommand::uid(message) <= 0xFFFF)
+        {
+            Loco *loco = findOrCreate(TrackCommand::uid(message));
+            if (loco == nullptr)
+                return;
+            loco->speed = 0;
+            loco->flags |= SPEED_KNOWN;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
@@ -0,0 +1,146 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKLOCOTABLE_H
+ #define TRACKLOCOTABLE_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ // ===================================================================
+ // === TrackLocoTable ================================================
+ // ===================================================================
+
+ /**
+  * Keeps the speed, the direction and the state of functions F0 to
+  * F31 of up to TRACK_MAX_LOCOS locomotives, one bit per function.
+  * The table follows every speed, direction and function message
+  * the controller sends or receives, so changes made from an MS2 or
+  * a CS2 show up as well. A second bitmap tells which functions have
+  * been seen at all; the others are unknown. An emergency stop of a
+  * loco and a system halt set the speed to 0. When the table is
+  * full, the least recently added loco is forgotten.
+  *
+  * A decoder only knows a few speed steps, 14 for MM2, so most of
+  * the 1001 speeds a slider sends land on the step the loco is
+  * already on. suppressSpeed() tells such frames apart, so they can
+  * be left out.
+  */
+ class TrackLocoTable : public TrackListener
+ {
+ public:
+   static const uint8_t SPEED_KNOWN = 0x01;
+   static const uint8_t DIRECTION_KNOWN = 0x02;
+
+   struct Loco
+   {
+     uint16_t address; // 0 for a free slot
+     uint32_t functions;
+     uint32_t known;
+     uint16_t speed;
+     uint8_t direction;
+     uint8_t flags; // SPEED_KNOWN, DIRECTION_KNOWN
+     uint16_t suppressed; // Speed frames left out by suppressSpeed()
+   };
+
+ private:
+   TrackController &mCtrl;
+   Loco mLocos[TRACK_MAX_LOCOS];
+   uint8_t mNext;
+   uint8_t mSteps[5]; // Speed steps of MM2, SX1, MFX, SX2 and DCC
+
+   Loco *find(uint16_t address);
+   Loco *findOrCreate(uint16_t address);
+   static int8_t protocolOf(uint16_t address);
+
+ public:
+   TrackLocoTable(TrackController &ctrl);
+   ~TrackLocoTable();
+
+   /**
+    * Writes the function bitmap of the given loco (bit n is Fn) and,
+    * if given, the bitmap of the functions whose state is known.
+    * Returns false if nothing is known about the loco.
+    */
+   bool getFunctions(uint16_t address, uint32_t *functions, uint32_t *known = nullptr);
+
+   /**
+    * Gives the last speed or direction seen for the given loco.
+    * Returns false if it is unknown.
+    */
+   bool getSpeed(uint16_t address, uint16_t *speed);
+   bool getDirection(uint16_t address, uint8_t *direction);
+
+   /**
+    * Sets the functions selected by 'mask' to the matching bits of
+    * 'values', leaving the others alone. Only functions that change,
+    * or whose state is unknown, are sent, one frame each, without
+    * waiting for the responses. Returns the number of frames sent.
+    */
+   uint8_t setFunctions(uint16_t address, uint32_t mask, uint32_t values);
+
+   /**
+    * Sets the number of speed steps of a protocol, given by the first
+    * address of its range: ADDR_MM2, ADDR_SX1, ADDR_MFX, ADDR_SX2 or
+    * ADDR_DCC. The defaults are 14, 31, 126, 127 and 28; use 126 for
+    * a layout whose DCC decoders run in 128 step mode.
+    */
+   void setSteps(uint16_t base, uint8_t steps);
+
+   /**
+    * Returns the number of speed steps of the given loco, 0 if its
+    * address is not a loco address.
+    */
+   uint8_t getSteps(uint16_t address) const;
+
+   /**
+    * Tells whether setting 'speed' would leave the loco on the step
+    * it is on, and counts the frame as suppressed if so. The speed is
+    * compared with the last one sent or seen on the bus, never with a
+    * suppressed one, so small changes cannot add up unnoticed. False
+    * when the speed of the loco is not known.
+    */
+   bool suppressSpeed(uint16_t address, uint16_t speed);
+
+   /**
+    * Returns the number of speed frames suppressed for the given
+    * loco.
+    */
+   uint16_t getSuppressed(uint16_t address);
+
+   /**
+    * Forgets everything about the given loco.
+    */
+   void forget(uint16_t address);
+
+   /**
+    * Forgets all locos.
+    */
+   void clear();
+
+   /**
+    * Gives the slot at 'index' (0..TRACK_MAX_LOCOS - 1) as it is, and
+    * puts a loco back as it was saved, replacing what is known about
+    * it. Used to save and restore the table.
+    */
+   const Loco &getSlot(uint8_t index) const { return mLocos[index]; }
+   void restore(const Loco &loco);
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKLOCOTABLE_H
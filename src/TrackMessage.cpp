@@ -24,11 +24,22 @@
  
  size_t TrackMessage::printHex(Print &p, uint32_t hex, uint16_t digits)
  {
+     char s[8];
+     uint8_t length = 0;
+
+     // Digits are collected backwards, least significant first
+     do
+     {
+         const uint8_t digit = hex & 0x0F;
+         s[length++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+         hex >>= 4;
+     } while (hex != 0);
+
      size_t size = 0;
-     String s = String(hex, HEX);
-     for (uint16_t i = s.length(); i < digits; i++)
-         size += p.print("0");
-     size += p.print(s);
+     for (uint16_t i = length; i < digits; i++)
+         size += p.write('0');
+     while (length > 0)
+         size += p.write(s[--length]);
      return size;
  }
  
@@ -36,13 +47,13 @@
     TrackMessage::parseHex
  -------------------------------------------------------------------  */
  
- uint8_t TrackMessage::parseHex(String &s, uint8_t start, uint8_t end, bool *ok)
+ uint8_t TrackMessage::parseHex(const char *s, uint8_t start, uint8_t end, bool *ok)
  {
      uint8_t value = 0;
  
      for (uint8_t i = start; i < end; i++)
      {
-         char c = s.charAt(i);
+         char c = s[i];
          if (c >= '0' && c <= '9')
              value = 16 * value + c - '0';
          else if (c >= 'a' && c <= 'f')
@@ -80,14 +91,14 @@
  {
      size_t size = 0;
      size += printHex(p, hash, 4);
-     size += p.print(response ? " R " : "   ");
+     size += p.print(response ? F(" R ") : F("   "));
      size += printHex(p, command, 2);
-     size += p.print(" ");
+     size += p.write(' ');
      size += printHex(p, length, 1);
  
      for (int i = 0; i < length; i++)
      {
-         size += p.print(" ");
+         size += p.write(' ');
          size += printHex(p, data[i], 2);
      }
      return size;
@@ -97,27 +108,37 @@
     TrackMessage::parseFrom
  -------------------------------------------------------------------  */
  
- bool TrackMessage::parseFrom(String &s)
+ bool TrackMessage::parseFrom(const char *s)
  {
      bool result = true;
+     const size_t available = strlen(s);
      clear();
  
-     if (s.length() < 11)
+     if (available < 11)
          return false;
  
      hash = parseHex(s, 0, 4, &result);
-     response = s.charAt(5) != ' ';
+     response = s[5] != ' ';
      command = parseHex(s, 7, 9, &result);
      length = parseHex(s, 10, 11, &result);
  
      if (length > 8)
          return false;
  
-     if (s.length() < static_cast<size_t>(11) + 3 * length)
+     if (available < static_cast<size_t>(11) + 3 * length)
          return false;
  
      for (int i = 0; i < length; i++)
          data[i] = parseHex(s, 12 + 3 * i, 12 + 3 * i + 2, &result);
  
      return result;
- }
\ No newline at end of file
+ }
+ 
+ #ifndef RAILUINO_LEAN
+ 
+ bool TrackMessage::parseFrom(String &s)
+ {
+     return parseFrom(s.c_str());
+ }
+ 
+ #endif
@@ -28,7 +28,7 @@
   * protocol or extend the library. See the Marklin protocol
   * documentation for details. The TrackMessage is a Printable, so
   * it can be directly used in Serial.println(), for instance. It
-  * can also be converted from a String.
+  * can also be parsed from text.
   */
  class TrackMessage
  {
@@ -76,16 +76,19 @@
       */
      size_t printTo(Print &p) const;
      /**
-      * Parses the message from the given String. Returns true on
+      * Parses the message from the given text. Returns true on
       * success, false otherwise. The message must have exactly the
       * format that printTo creates. This includes each and every
       * whitespace. If the parsing fails the state of the object is
       * undefined afterwards, and a clear() is recommended.
       */
+     bool parseFrom(const char *s);
+ #ifndef RAILUINO_LEAN
      bool parseFrom(String &s);
+ #endif
  
      static size_t printHex(Print &p, uint32_t hex, uint16_t digits);
-     static uint8_t parseHex(String &s, uint8_t start, uint8_t end, bool *ok);
+     static uint8_t parseHex(const char *s, uint8_t start, uint8_t end, bool *ok);
  };
  
  #endif // TRACKCMESSAGE_H
\ No newline at end of file
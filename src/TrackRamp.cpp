@@ -0,0 +1,250 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackRamp.h"
+#include "TrackCommand.h"
+
+static const uint16_t DEFAULT_ACCEL = 200; // Speed units per second
+static const uint16_t DEFAULT_DECEL = 400; // Speed units per second
+static const uint16_t MAX_SPEED = 1023;
+
+/* -------------------------------------------------------------------
+   TrackRamp (constructor)
+-------------------------------------------------------------------  */
+
+TrackRamp::TrackRamp(TrackController &ctrl, uint16_t tickMs, uint8_t framesPerTick, uint16_t minStep)
+    : mCtrl(ctrl),
+      mLocos(nullptr),
+      mTickMs(tickMs ? tickMs : 1),
+      mMinStep(minStep),
+      mFramesPerTick(framesPerTick ? framesPerTick : 1),
+      mNext(0),
+      mNextTick(0),
+      mTickMicros(0),
+      mFramesSent(0)
+{
+    memset(mRamps, 0x00, sizeof(mRamps));
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::perTick
+-------------------------------------------------------------------  */
+
+uint16_t TrackRamp::perTick(uint16_t perSecond) const
+{
+    uint32_t value = (static_cast<uint32_t>(perSecond) * mTickMs << FRACTION) / 1000UL;
+    if (value == 0)
+        value = 1;
+    return value > 0xFFFF ? 0xFFFF : value;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::find
+-------------------------------------------------------------------  */
+
+TrackRamp::Ramp *TrackRamp::find(uint16_t address)
+{
+    for (uint8_t i = 0; i < TRACK_MAX_RAMPS; i++)
+        if (mRamps[i].address == address)
+            return &mRamps[i];
+    return nullptr;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::findOrCreate
+-------------------------------------------------------------------  */
+
+TrackRamp::Ramp *TrackRamp::findOrCreate(uint16_t address)
+{
+    Ramp *ramp = find(address);
+    if (ramp != nullptr || address == 0)
+        return ramp;
+
+    ramp = find(0);
+    if (ramp != nullptr)
+    {
+        // Start from the speed the loco runs at, so it is not braked
+        uint16_t speed = 0;
+        if (mLocos != nullptr && mLocos->getSpeed(address, &speed) && speed > MAX_SPEED)
+            speed = MAX_SPEED;
+        ramp->address = address;
+        ramp->current = speed << FRACTION;
+        ramp->target = ramp->current;
+        ramp->sent = speed;
+        ramp->accel = perTick(DEFAULT_ACCEL);
+        ramp->decel = perTick(DEFAULT_DECEL);
+    }
+    return ramp;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::setCurrent
+-------------------------------------------------------------------  */
+
+bool TrackRamp::setCurrent(uint16_t address, uint16_t speed)
+{
+    const bool known = find(address) != nullptr;
+    Ramp *ramp = findOrCreate(address);
+    if (ramp == nullptr)
+        return false;
+    if (speed > MAX_SPEED)
+        speed = MAX_SPEED;
+    ramp->current = speed << FRACTION;
+    ramp->sent = speed;
+    if (!known)
+        ramp->target = ramp->current; // Nowhere to go yet
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::setRate
+-------------------------------------------------------------------  */
+
+bool TrackRamp::setRate(uint16_t address, uint16_t accel, uint16_t decel)
+{
+    Ramp *ramp = findOrCreate(address);
+    if (ramp == nullptr)
+        return false;
+    ramp->accel = perTick(accel);
+    ramp->decel = perTick(decel);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::setTarget
+-------------------------------------------------------------------  */
+
+bool TrackRamp::setTarget(uint16_t address, uint16_t speed)
+{
+    Ramp *ramp = findOrCreate(address);
+    if (ramp == nullptr)
+        return false;
+    if (speed > MAX_SPEED)
+        speed = MAX_SPEED;
+    ramp->target = speed << FRACTION;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::stop
+-------------------------------------------------------------------  */
+
+bool TrackRamp::stop(uint16_t address)
+{
+    Ramp *ramp = find(address);
+    if (ramp != nullptr)
+    {
+        ramp->current = 0;
+        ramp->target = 0;
+        ramp->sent = 0;
+    }
+
+    TrackMessage message = LocoSpeed::set(address, 0);
+    mFramesSent++;
+    return mCtrl.sendMessage(message);
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::remove
+-------------------------------------------------------------------  */
+
+void TrackRamp::remove(uint16_t address)
+{
+    Ramp *ramp = find(address);
+    if (ramp != nullptr)
+        ramp->address = 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::getSpeed
+-------------------------------------------------------------------  */
+
+uint16_t TrackRamp::getSpeed(uint16_t address)
+{
+    Ramp *ramp = find(address);
+    return ramp != nullptr ? ramp->current >> FRACTION : 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::isRamping
+-------------------------------------------------------------------  */
+
+bool TrackRamp::isRamping(uint16_t address)
+{
+    Ramp *ramp = find(address);
+    return ramp != nullptr && (ramp->current != ramp->target || (ramp->current >> FRACTION) != ramp->sent);
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::tick
+-------------------------------------------------------------------  */
+
+void TrackRamp::tick()
+{
+    const uint32_t start = micros();
+    uint8_t budget = mFramesPerTick;
+    uint8_t index = mNext;
+
+    /* One pass over all slots, starting where the previous tick ran
+       out of frames, so no loco starves when many ramp at once. */
+    for (uint8_t n = 0; n < TRACK_MAX_RAMPS; n++, index = (index + 1) % TRACK_MAX_RAMPS)
+    {
+        Ramp &ramp = mRamps[index];
+        if (ramp.address == 0)
+            continue;
+
+        if (ramp.current < ramp.target)
+            ramp.current = (ramp.target - ramp.current > ramp.accel) ? ramp.current + ramp.accel : ramp.target;
+        else if (ramp.current > ramp.target)
+            ramp.current = (ramp.current - ramp.target > ramp.decel) ? ramp.current - ramp.decel : ramp.target;
+
+        const uint16_t speed = ramp.current >> FRACTION;
+        if (speed == ramp.sent || budget == 0)
+            continue;
+
+        const uint16_t delta = speed > ramp.sent ? speed - ramp.sent : ramp.sent - speed;
+        if (delta >= mMinStep || ramp.current == ramp.target)
+        {
+            TrackMessage message = LocoSpeed::set(ramp.address, speed);
+            if (mCtrl.sendMessage(message))
+            {
+                ramp.sent = speed;
+                mFramesSent++;
+            }
+            if (--budget == 0)
+                mNext = (index + 1) % TRACK_MAX_RAMPS;
+        }
+    }
+
+    mTickMicros = micros() - start;
+}
+
+/* -------------------------------------------------------------------
+   TrackRamp::update
+-------------------------------------------------------------------  */
+
+void TrackRamp::update()
+{
+    const uint32_t now = millis();
+
+    if (static_cast<int32_t>(now - mNextTick) >= 0)
+    {
+        // A late tick is not caught up: ramps simply take a bit longer
+        mNextTick = now + mTickMs;
+        tick();
+    }
+}
@@ -0,0 +1,151 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKRAMP_H
+ #define TRACKRAMP_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackLocoTable.h"
+ #include "Config.h"
+
+ // ===================================================================
+ // === TrackRamp =====================================================
+ // ===================================================================
+
+ /**
+  * Accelerates and decelerates many locomotives smoothly towards a
+  * target speed. Every tick (100 ms by default) all ramping locos are
+  * advanced in one pass, using 10.6 fixed-point speeds and no
+  * floating point at all. A speed frame is only sent when the integer
+  * speed has moved by at least the minimum step, and at most
+  * 'framesPerTick' frames go out per tick, round robin, so the CPU and
+  * bus load stay bounded no matter how many locos ramp at once.
+  * Frames are sent without waiting for the response; the responses
+  * are drained by TrackController::update().
+  *
+  * A loco new to the engine ramps from the speed it runs at: the one
+  * in the TrackLocoTable set with setLocos(), or given with
+  * setCurrent(). Without either it is taken to stand still, and a
+  * running loco would first get a frame close to 0.
+  */
+ class TrackRamp
+ {
+ private:
+   /**
+    * Number of fractional bits of the fixed-point speeds.
+    */
+   static const uint8_t FRACTION = 6;
+
+   struct Ramp
+   {
+     uint16_t address;  // 0 = free slot
+     uint16_t current;  // 10.6 fixed point
+     uint16_t target;   // 10.6 fixed point
+     uint16_t accel;    // 10.6 fixed point per tick
+     uint16_t decel;    // 10.6 fixed point per tick
+     uint16_t sent;     // Last speed sent, integer
+   };
+
+   TrackController &mCtrl;
+   TrackLocoTable *mLocos;
+   Ramp mRamps[TRACK_MAX_RAMPS];
+   uint16_t mTickMs;
+   uint16_t mMinStep;
+   uint8_t mFramesPerTick;
+   uint8_t mNext;
+   uint32_t mNextTick;
+   uint32_t mTickMicros;
+   uint32_t mFramesSent;
+
+   Ramp *find(uint16_t address);
+   Ramp *findOrCreate(uint16_t address);
+   uint16_t perTick(uint16_t perSecond) const;
+
+ public:
+   /**
+    * Creates a ramp engine driving the given controller. 'tickMs' is
+    * the tick period, 'framesPerTick' the most speed frames sent per
+    * tick and 'minStep' the smallest speed change worth a frame.
+    */
+   TrackRamp(TrackController &ctrl, uint16_t tickMs = 100, uint8_t framesPerTick = 8, uint16_t minStep = 8);
+
+   /**
+    * Takes the speed of locos new to the engine from the given loco
+    * table, nullptr for none.
+    */
+   void setLocos(TrackLocoTable *locos) { mLocos = locos; }
+
+   /**
+    * Tells the engine the speed a loco runs at now, for instance
+    * after it was set from an MS2. A ramp under way goes on from
+    * there.
+    */
+   bool setCurrent(uint16_t address, uint16_t speed);
+
+   /**
+    * Sets the acceleration and deceleration of a loco, in speed
+    * units (0..1000) per second. Defaults to 200 and 400.
+    */
+   bool setRate(uint16_t address, uint16_t accel, uint16_t decel);
+
+   /**
+    * Sets the speed the loco should ramp to. Returns false if all
+    * TRACK_MAX_RAMPS slots are taken.
+    */
+   bool setTarget(uint16_t address, uint16_t speed);
+
+   /**
+    * Stops the loco at once, without ramp.
+    */
+   bool stop(uint16_t address);
+
+   /**
+    * Releases the slot of a loco.
+    */
+   void remove(uint16_t address);
+
+   /**
+    * Returns the current (ramped) speed of a loco.
+    */
+   uint16_t getSpeed(uint16_t address);
+
+   /**
+    * Reports whether the loco has not reached its target yet.
+    */
+   bool isRamping(uint16_t address);
+
+   /**
+    * Advances all ramps by one tick. Normally called by update().
+    */
+   void tick();
+
+   /**
+    * Calls tick() whenever the tick period has elapsed. Call this as
+    * often as possible from loop().
+    */
+   void update();
+
+   /**
+    * Duration of the last tick() in microseconds, and number of
+    * frames sent since the start, for measuring the engine's cost.
+    */
+   uint32_t getTickMicros() const { return mTickMicros; }
+   uint32_t getFramesSent() const { return mFramesSent; }
+ };
+
+ #endif // TRACKRAMP_H
@@ -0,0 +1,225 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackRecorder.h"
+#include "TrackCommand.h"
+
+static const uint8_t LOG_MAGIC[4] = {'R', 'L', 'O', 'G'};
+
+/* -------------------------------------------------------------------
+   TrackRecorder (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackRecorder::TrackRecorder(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mOut(nullptr),
+      mLast(0),
+      mRecords(0),
+      mBytes(0)
+{
+}
+
+TrackRecorder::~TrackRecorder()
+{
+    stop();
+}
+
+/* -------------------------------------------------------------------
+   TrackRecorder::start
+-------------------------------------------------------------------  */
+
+void TrackRecorder::start(Print &out)
+{
+    stop();
+
+    mOut = &out;
+    mRecords = 0;
+    mBytes = mOut->write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    mBytes += mOut->write(static_cast<uint8_t>(TRACK_LOG_VERSION));
+    mLast = micros();
+    mCtrl.addListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackRecorder::stop
+-------------------------------------------------------------------  */
+
+void TrackRecorder::stop()
+{
+    if (mOut == nullptr)
+        return;
+
+    mCtrl.removeListener(this);
+    mOut->flush();
+    mOut = nullptr;
+}
+
+/* -------------------------------------------------------------------
+   TrackRecorder::writeVarint
+-------------------------------------------------------------------  */
+
+void TrackRecorder::writeVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        mBytes += mOut->write(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    mBytes += mOut->write(static_cast<uint8_t>(value));
+}
+
+/* -------------------------------------------------------------------
+   TrackRecorder::onMessage
+-------------------------------------------------------------------  */
+
+void TrackRecorder::onMessage(const TrackMessage &message, bool outgoing)
+{
+    const uint32_t now = micros();
+    const uint8_t length = message.length > 8 ? 8 : message.length;
+    const uint32_t id = TrackCommand::canId(message);
+    uint8_t record[5] = {
+        static_cast<uint8_t>((outgoing ? 0x80 : 0x00) | length),
+        static_cast<uint8_t>(id >> 24),
+        static_cast<uint8_t>(id >> 16),
+        static_cast<uint8_t>(id >> 8),
+        static_cast<uint8_t>(id)};
+
+    writeVarint(now - mLast);
+    mBytes += mOut->write(record, sizeof(record));
+    mBytes += mOut->write(message.data, length);
+
+    mLast = now;
+    mRecords++;
+}
+
+/* -------------------------------------------------------------------
+   TrackReplayer (constructor)
+-------------------------------------------------------------------  */
+
+TrackReplayer::TrackReplayer(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mIn(nullptr),
+      mFactor(1),
+      mPending(false),
+      mPendingOutgoing(false),
+      mStart(0),
+      mDue(0),
+      mRecords(0)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackReplayer::start
+-------------------------------------------------------------------  */
+
+bool TrackReplayer::start(Stream &in, uint8_t factor)
+{
+    uint8_t header[5];
+
+    mIn = nullptr;
+    if (in.readBytes(header, sizeof(header)) != sizeof(header) || memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || header[4] != TRACK_LOG_VERSION)
+        return false;
+
+    mIn = &in;
+    mFactor = factor;
+    mPending = false;
+    mDue = 0;
+    mRecords = 0;
+    mStart = micros();
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackReplayer::readVarint
+-------------------------------------------------------------------  */
+
+bool TrackReplayer::readVarint(uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+        int c = mIn->read();
+        if (c < 0)
+            return false;
+        result |= static_cast<uint32_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* -------------------------------------------------------------------
+   TrackReplayer::readRecord
+-------------------------------------------------------------------  */
+
+bool TrackReplayer::readRecord()
+{
+    uint32_t delta;
+    uint8_t record[5];
+
+    if (!readVarint(&delta) || mIn->readBytes(record, sizeof(record)) != sizeof(record))
+        return false;
+
+    const uint8_t length = record[0] & 0x0F;
+    const uint32_t id = (static_cast<uint32_t>(record[1]) << 24) | (static_cast<uint32_t>(record[2]) << 16) | (static_cast<uint32_t>(record[3]) << 8) | record[4];
+
+    mMessage.clear();
+    mMessage.prio = TrackCommand::prio(id);
+    mMessage.command = TrackCommand::command(id);
+    mMessage.response = TrackCommand::response(id);
+    mMessage.hash = TrackCommand::hash(id);
+    mMessage.length = length > 8 ? 8 : length;
+    if (mIn->readBytes(mMessage.data, mMessage.length) != mMessage.length)
+        return false;
+
+    mPendingOutgoing = record[0] & 0x80;
+    mDue += mFactor > 1 ? delta / mFactor : delta;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackReplayer::update
+-------------------------------------------------------------------  */
+
+void TrackReplayer::update()
+{
+    while (mIn != nullptr)
+    {
+        if (!mPending)
+        {
+            if (!readRecord())
+            {
+                mIn = nullptr; // End of the recording
+                return;
+            }
+            mPending = true;
+        }
+
+        if (mFactor != 0 && static_cast<int32_t>(micros() - mStart - mDue) < 0)
+            return; // Not due yet
+
+        if (!mPendingOutgoing && !mCtrl.injectMessage(mMessage))
+            return; // Receive path full, try again on the next call
+
+        mPending = false;
+        mRecords++;
+    }
+}
@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKRECORDER_H
+ #define TRACKRECORDER_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ /*
+    Layout of a recording: the 5 byte header "RLOG" + version, then
+    one record per message:
+
+    - time since the previous record in microseconds, as a varint
+      (7 bits per byte, least significant first, bit 7 = more follows)
+    - flags: bit 7 = sent by this controller, bits 0..3 = length
+    - CAN identifier, 4 bytes big endian
+    - 'length' data bytes
+
+    A typical record takes 7 to 15 bytes.
+ */
+ #define TRACK_LOG_VERSION 1
+
+ // ===================================================================
+ // === TrackRecorder =================================================
+ // ===================================================================
+
+ /**
+  * Records every message sent or received by a TrackController into
+  * a compact append-only binary log. The log goes to any Print: a
+  * File on SPIFFS, or Serial to stream it to a host.
+  */
+ class TrackRecorder : public TrackListener
+ {
+ private:
+   TrackController &mCtrl;
+   Print *mOut;
+   uint32_t mLast;
+   uint32_t mRecords;
+   uint32_t mBytes;
+
+   void writeVarint(uint32_t value);
+
+ public:
+   TrackRecorder(TrackController &ctrl);
+   ~TrackRecorder();
+
+   /**
+    * Starts recording into the given output, writing the header.
+    */
+   void start(Print &out);
+
+   /**
+    * Stops recording. The output is flushed but not closed.
+    */
+   void stop();
+
+   bool isRecording() const { return mOut != nullptr; }
+   uint32_t getRecords() const { return mRecords; }
+   uint32_t getBytes() const { return mBytes; }
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ // ===================================================================
+ // === TrackReplayer =================================================
+ // ===================================================================
+
+ /**
+  * Feeds a recording back through the receive path of a
+  * TrackController, so listeners and exchanges see the messages as
+  * if they came from the bus. Messages originally sent by the
+  * controller are skipped. Records are scheduled against the start
+  * of the replay, not against each other, so timing does not drift.
+  */
+ class TrackReplayer
+ {
+ private:
+   TrackController &mCtrl;
+   Stream *mIn;
+   uint8_t mFactor;
+   bool mPending;
+   bool mPendingOutgoing;
+   TrackMessage mMessage;
+   uint32_t mStart;
+   uint32_t mDue; // Time of the pending record since the start, in us
+   uint32_t mRecords;
+
+   bool readVarint(uint32_t *value);
+   bool readRecord();
+
+ public:
+   TrackReplayer(TrackController &ctrl);
+
+   /**
+    * Starts replaying the given recording. 'factor' speeds up the
+    * replay: 1 is the original speed, 10 is ten times faster and 0
+    * replays as fast as the receive path accepts messages. Returns
+    * false if the header is missing or of an unknown version.
+    */
+   bool start(Stream &in, uint8_t factor = 1);
+
+   /**
+    * Injects all records that are due. Call this as often as
+    * possible from loop(), before TrackController::update().
+    */
+   void update();
+
+   bool isReplaying() const { return mIn != nullptr; }
+   uint32_t getRecords() const { return mRecords; }
+ };
+
+ #endif // TRACKRECORDER_H
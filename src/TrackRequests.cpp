@@ -0,0 +1,207 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackRequests.h"
+#include "TrackCommand.h"
+
+/* -------------------------------------------------------------------
+   TrackRequests (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackRequests::TrackRequests(TrackController &ctrl)
+    : mCtrl(ctrl),
+      mRetry(nullptr),
+      mCompleted(0),
+      mTimeouts(0)
+{
+    memset(mRequests, 0x00, sizeof(mRequests));
+    mCtrl.addListener(this);
+}
+
+TrackRequests::~TrackRequests()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::get
+-------------------------------------------------------------------  */
+
+TrackRequests::Request *TrackRequests::get(uint8_t handle)
+{
+    if (handle == 0 || handle > TRACK_MAX_REQUESTS)
+        return nullptr;
+    return &mRequests[handle - 1];
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::send
+-------------------------------------------------------------------  */
+
+uint8_t TrackRequests::send(TrackMessage &message, uint32_t timeout)
+{
+    uint8_t handle = 0;
+    for (uint8_t i = 0; i < TRACK_MAX_REQUESTS && handle == 0; i++)
+        if (mRequests[i].state == REQUEST_FREE)
+            handle = i + 1;
+    if (handle == 0)
+        return 0;
+
+    Request &request = mRequests[handle - 1];
+    request.sent = TrackClock::now();
+    if (!mCtrl.sendMessage(message))
+        return 0;
+
+    request.state = REQUEST_PENDING;
+    request.attempts = 1;
+    request.timeout = timeout;
+    request.latency = 0;
+    request.message = message;
+    mDeadlines.push(handle, TrackClock::deadline(request.sent, timeout));
+    return handle;
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::getState
+-------------------------------------------------------------------  */
+
+uint8_t TrackRequests::getState(uint8_t handle)
+{
+    Request *request = get(handle);
+    return request != nullptr ? request->state : REQUEST_FREE;
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::take
+-------------------------------------------------------------------  */
+
+bool TrackRequests::take(uint8_t handle, TrackMessage &response, uint32_t *latency)
+{
+    Request *request = get(handle);
+    if (request == nullptr || request->state == REQUEST_FREE || request->state == REQUEST_PENDING || request->state == REQUEST_RETRY)
+        return false;
+
+    const bool done = request->state == REQUEST_DONE;
+    if (done)
+    {
+        response = request->message;
+        if (latency != nullptr)
+            *latency = request->latency;
+    }
+    request->state = REQUEST_FREE;
+    return done;
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::release
+-------------------------------------------------------------------  */
+
+void TrackRequests::release(uint8_t handle)
+{
+    Request *request = get(handle);
+    if (request == nullptr)
+        return;
+    if (request->state == REQUEST_PENDING || request->state == REQUEST_RETRY)
+        mDeadlines.remove(handle);
+    request->state = REQUEST_FREE;
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::update
+-------------------------------------------------------------------  */
+
+void TrackRequests::update()
+{
+    const uint32_t now = TrackClock::now();
+    uint8_t handle;
+
+    while (mDeadlines.popExpired(now, &handle))
+        expire(handle, now);
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::expire
+-------------------------------------------------------------------  */
+
+void TrackRequests::expire(uint8_t handle, uint32_t now)
+{
+    Request &request = mRequests[handle - 1];
+
+    if (request.state == REQUEST_RETRY)
+    {
+        // Backoff over: send again, with a fresh deadline
+        TrackMessage message = request.message;
+        request.sent = now;
+        request.state = REQUEST_PENDING;
+        request.attempts++;
+        if (mRetry != nullptr) // Policy may have been dropped during the backoff
+            mRetry->countRetry();
+        if (mCtrl.sendMessage(message))
+        {
+            mDeadlines.push(handle, TrackClock::deadline(now, request.timeout));
+            return;
+        }
+    }
+    else if (mRetry != nullptr && request.attempts < mRetry->getAttempts() && mRetry->isRetryable(request.message))
+    {
+        request.state = REQUEST_RETRY;
+        mDeadlines.push(handle, TrackClock::deadline(now, mRetry->getBackoff(request.attempts)));
+        return;
+    }
+
+    if (mRetry != nullptr)
+    {
+        if (mRetry->isRetryable(request.message))
+            mRetry->countFailure();
+        else
+            mRetry->countRefused();
+    }
+    request.state = REQUEST_TIMEOUT;
+    mTimeouts++;
+}
+
+/* -------------------------------------------------------------------
+   TrackRequests::onMessage
+-------------------------------------------------------------------  */
+
+void TrackRequests::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (outgoing || !message.response)
+        return;
+
+    // Several requests may wait for the same answer: the oldest gets it
+    Request *oldest = nullptr;
+    for (uint8_t i = 0; i < TRACK_MAX_REQUESTS; i++)
+    {
+        Request &request = mRequests[i];
+        const bool waiting = request.state == REQUEST_PENDING || request.state == REQUEST_RETRY;
+        if (waiting && TrackCommand::isResponseTo(request.message, message))
+            if (oldest == nullptr || TrackClock::before(request.sent, oldest->sent))
+                oldest = &request;
+    }
+    if (oldest == nullptr)
+        return;
+
+    const uint32_t now = TrackClock::now();
+    oldest->state = REQUEST_DONE;
+    oldest->latency = now - oldest->sent;
+    oldest->message = message;
+    mDeadlines.remove(oldest - mRequests + 1);
+    mCompleted++;
+    if (mRetry != nullptr && oldest->attempts > 1)
+        mRetry->countRecovered();
+}
@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKREQUESTS_H
+ #define TRACKREQUESTS_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackDeadlineQueue.h"
+ #include "TrackRetry.h"
+
+ /**
+  * Constants for the state of a request.
+  */
+ #define REQUEST_FREE     0 // Unknown or already taken handle
+ #define REQUEST_PENDING  1 // Sent, waiting for the response
+ #define REQUEST_DONE     2 // Response received
+ #define REQUEST_TIMEOUT  3 // No response in time
+ #define REQUEST_RETRY    4 // No response yet, waiting to be sent again
+
+ // ===================================================================
+ // === TrackRequests =================================================
+ // ===================================================================
+
+ /**
+  * Sends messages without waiting for their responses, so many
+  * requests can be outstanding at once while loop() keeps running.
+  * Each request gets a handle and a deadline in microseconds. The
+  * deadlines sit in a TrackDeadlineQueue, so update() finds all
+  * expired requests in O(log n) each. Responses are matched on
+  * command and UID, see TrackCommand::isResponseTo(). With a retry
+  * policy, idempotent requests are sent again after a backoff
+  * instead of timing out, without blocking either.
+  */
+ class TrackRequests : public TrackListener
+ {
+ private:
+   struct Request
+   {
+     uint8_t state;
+     uint8_t attempts;
+     uint32_t timeout;
+     uint32_t sent;
+     uint32_t latency;
+     TrackMessage message; // The request, then its response
+   };
+
+   TrackController &mCtrl;
+   Request mRequests[TRACK_MAX_REQUESTS];
+   TrackDeadlineQueue<TRACK_MAX_REQUESTS> mDeadlines;
+   TrackRetry *mRetry;
+   uint32_t mCompleted;
+   uint32_t mTimeouts;
+
+   Request *get(uint8_t handle);
+   void expire(uint8_t handle, uint32_t now);
+
+ public:
+   TrackRequests(TrackController &ctrl);
+   ~TrackRequests();
+
+   /**
+    * Sends the message and returns a handle for following its
+    * request, or 0 if all TRACK_MAX_REQUESTS slots are taken or the
+    * message could not be sent. The request times out after
+    * 'timeout' microseconds.
+    */
+   uint8_t send(TrackMessage &message, uint32_t timeout);
+
+   /**
+    * Sets the retry policy, nullptr for none. Requests already
+    * waiting for their backoff are still sent again.
+    */
+   void setRetry(TrackRetry *retry) { mRetry = retry; }
+
+   /**
+    * Returns the state of a request, one of the REQUEST_* constants.
+    */
+   uint8_t getState(uint8_t handle);
+
+   /**
+    * Ends a request that is done or timed out and frees its slot.
+    * Returns true and the response if it is done; 'latency' receives
+    * the response time of the last attempt in microseconds. Returns
+    * false for pending or retrying requests, which are left alone,
+    * and for timed out ones.
+    */
+   bool take(uint8_t handle, TrackMessage &response, uint32_t *latency = nullptr);
+
+   /**
+    * Drops a request in any state and frees its slot.
+    */
+   void release(uint8_t handle);
+
+   /**
+    * Resends or times out the requests whose deadline has passed.
+    * Call this as
+    * often as possible from loop(), after TrackController::update().
+    */
+   void update();
+
+   uint32_t getCompleted() const { return mCompleted; }
+   uint32_t getTimeouts() const { return mTimeouts; }
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKREQUESTS_H
@@ -0,0 +1,84 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackRetry.h"
+#include "TrackCommand.h"
+
+/* -------------------------------------------------------------------
+   TrackRetry (constructor)
+-------------------------------------------------------------------  */
+
+TrackRetry::TrackRetry(uint8_t attempts, uint32_t backoff)
+    : mRetryable(0),
+      mBackoff(backoff ? backoff : 1),
+      mAttempts(attempts ? attempts : 1),
+      mRetries(0),
+      mRecovered(0),
+      mFailures(0),
+      mRefused(0)
+{
+    setRetryable(CMD_SYSTEM, true);
+    setRetryable(CMD_LOCO_SPEED, true);
+    setRetryable(CMD_LOCO_DIR, true);
+    setRetryable(CMD_LOCO_FUNC, true);
+    setRetryable(CMD_READ_CONFIG, true);
+    setRetryable(CMD_ACCESSORY, true);
+    setRetryable(CMD_PING, true);
+}
+
+/* -------------------------------------------------------------------
+   TrackRetry::setRetryable
+-------------------------------------------------------------------  */
+
+void TrackRetry::setRetryable(uint8_t command, bool retryable)
+{
+    if (command > 31)
+        return;
+    if (retryable)
+        mRetryable |= 1UL << command;
+    else
+        mRetryable &= ~(1UL << command);
+}
+
+/* -------------------------------------------------------------------
+   TrackRetry::isRetryable
+-------------------------------------------------------------------  */
+
+bool TrackRetry::isRetryable(const TrackMessage &request) const
+{
+    if (request.command > 31 || (mRetryable & (1UL << request.command)) == 0)
+        return false;
+
+    // Toggling twice is not toggling once
+    if (request.command == CMD_LOCO_DIR && request.length >= 5 && LocoDirection::direction(request) == DIR_CHANGE)
+        return false;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackRetry::getBackoff
+-------------------------------------------------------------------  */
+
+uint32_t TrackRetry::getBackoff(uint8_t retry) const
+{
+    const uint8_t shift = retry > 8 ? 7 : (retry ? retry - 1 : 0);
+    const uint32_t wait = mBackoff << shift;
+
+    // Half fixed, half random
+    return wait / 2 + random(wait / 2 + 1);
+}
@@ -0,0 +1,98 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKRETRY_H
+ #define TRACKRETRY_H
+
+ #include <Arduino.h>
+ #include "TrackMessage.h"
+
+ // ===================================================================
+ // === TrackRetry ====================================================
+ // ===================================================================
+
+ /**
+  * Says whether and how requests that got no response are sent
+  * again, and counts what happened. A request is only resent if it
+  * is idempotent, that is if doing it twice is the same as doing it
+  * once: setting a speed, a direction, a function or an accessory
+  * position, and all queries. Toggling the direction is not, and
+  * neither is writing a config value by default. The rules can be
+  * changed per command.
+  *
+  * Between attempts the wait grows from 'backoff' microseconds,
+  * doubling each time, with a random part so several controllers do
+  * not retry in step. Responses arriving late during the wait are
+  * still taken, so no needless resend is made.
+  *
+  * Attach it with TrackController::setRetry() for the blocking
+  * methods and with TrackRequests::setRetry() for requests.
+  */
+ class TrackRetry
+ {
+ private:
+   uint32_t mRetryable; // Bit n set: command n may be resent
+   uint32_t mBackoff;
+   uint8_t mAttempts;
+   uint32_t mRetries;
+   uint32_t mRecovered;
+   uint32_t mFailures;
+   uint32_t mRefused;
+
+ public:
+   /**
+    * Creates a policy making at most 'attempts' attempts per request
+    * in total, with a first wait of 'backoff' microseconds.
+    */
+   TrackRetry(uint8_t attempts = 3, uint32_t backoff = 2000);
+
+   /**
+    * Allows or forbids resending the given command.
+    */
+   void setRetryable(uint8_t command, bool retryable);
+
+   /**
+    * Tells whether the given request may be sent again.
+    */
+   bool isRetryable(const TrackMessage &request) const;
+
+   /**
+    * Returns the wait before the given retry (1 for the first) in
+    * microseconds, jitter included.
+    */
+   uint32_t getBackoff(uint8_t retry) const;
+
+   uint8_t getAttempts() const { return mAttempts; }
+
+   /**
+    * Counters: resends made, requests that succeeded only thanks to
+    * a retry, requests given up after the last attempt and failed
+    * requests that were not retried because they are not
+    * idempotent.
+    */
+   uint32_t getRetries() const { return mRetries; }
+   uint32_t getRecovered() const { return mRecovered; }
+   uint32_t getFailures() const { return mFailures; }
+   uint32_t getRefused() const { return mRefused; }
+
+   void countRetry() { mRetries++; }
+   void countRecovered() { mRecovered++; }
+   void countFailure() { mFailures++; }
+   void countRefused() { mRefused++; }
+ };
+
+ #endif // TRACKRETRY_H
@@ -0,0 +1,88 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKRING_H
+ #define TRACKRING_H
+
+ #include <Arduino.h>
+
+ // ===================================================================
+ // === TrackRing =====================================================
+ // ===================================================================
+
+ /**
+  * A fixed size FIFO of SIZE elements of type T, with no dynamic
+  * memory. SIZE must be a power of two, so wrapping the indices is a
+  * simple mask. Not interrupt safe: use it from loop() only.
+  */
+ template <typename T, uint8_t SIZE>
+ class TrackRing
+ {
+   static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "TrackRing size must be a power of two");
+
+ private:
+   T mItems[SIZE];
+   uint8_t mHead;
+   uint8_t mCount;
+
+ public:
+   TrackRing() : mHead(0), mCount(0) {}
+
+   /**
+    * Appends an element. Returns false if the ring is full.
+    */
+   bool push(const T &item)
+   {
+     if (mCount == SIZE)
+       return false;
+     mItems[(mHead + mCount) & (SIZE - 1)] = item;
+     mCount++;
+     return true;
+   }
+
+   /**
+    * Removes the oldest element. Returns false if the ring is empty.
+    */
+   bool pop(T &item)
+   {
+     if (mCount == 0)
+       return false;
+     item = mItems[mHead];
+     mHead = (mHead + 1) & (SIZE - 1);
+     mCount--;
+     return true;
+   }
+
+   /**
+    * Returns the element at the given position, 0 being the oldest.
+    */
+   T &operator[](uint8_t index) { return mItems[(mHead + index) & (SIZE - 1)]; }
+   const T &operator[](uint8_t index) const { return mItems[(mHead + index) & (SIZE - 1)]; }
+
+   void clear()
+   {
+     mHead = 0;
+     mCount = 0;
+   }
+
+   uint8_t count() const { return mCount; }
+   bool isEmpty() const { return mCount == 0; }
+   bool isFull() const { return mCount == SIZE; }
+   static uint8_t capacity() { return SIZE; }
+ };
+
+ #endif // TRACKRING_H
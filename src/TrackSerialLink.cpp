@@ -0,0 +1,217 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackSerialLink.h"
+#include "TrackCrc.h"
+
+static const uint8_t SKIPPING = 0xFF; // mRxLength while waiting for a delimiter
+
+/* -------------------------------------------------------------------
+   TrackSerialLink (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackSerialLink::TrackSerialLink(TrackController &ctrl, Stream &stream)
+    : mCtrl(ctrl),
+      mStream(stream),
+      mRxLength(0),
+      mFromHost(false),
+      mReceived(0),
+      mSent(0),
+      mErrors(0),
+      mDropped(0)
+{
+    mCtrl.addListener(this);
+}
+
+TrackSerialLink::~TrackSerialLink()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::encode
+
+   COBS: every zero is replaced by the distance to the next one, the
+   first distance leading the packet. A packet is shorter than 254
+   bytes, so no extra code bytes are ever needed.
+-------------------------------------------------------------------  */
+
+uint8_t TrackSerialLink::encode(const TrackFrame &frame, uint8_t *out)
+{
+    uint8_t packet[PACKET_SIZE];
+    memcpy(packet, frame.bytes, TrackFrame::SIZE);
+    const uint16_t crc = TrackCrc::ccitt(frame.bytes, TrackFrame::SIZE);
+    packet[TrackFrame::SIZE] = crc >> 8;
+    packet[TrackFrame::SIZE + 1] = crc & 0xFF;
+
+    uint8_t code = 1;
+    uint8_t codeAt = 0;
+    uint8_t length = 1;
+    for (uint8_t i = 0; i < PACKET_SIZE; i++)
+    {
+        if (packet[i] == 0)
+        {
+            out[codeAt] = code;
+            codeAt = length++;
+            code = 1;
+        }
+        else
+        {
+            out[length++] = packet[i];
+            code++;
+        }
+    }
+    out[codeAt] = code;
+    out[length++] = 0x00;
+    return length;
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::decode
+-------------------------------------------------------------------  */
+
+bool TrackSerialLink::decode(const uint8_t *in, uint8_t length, TrackFrame &frame)
+{
+    uint8_t packet[PACKET_SIZE];
+    uint8_t size = 0;
+    uint8_t i = 0;
+
+    while (i < length)
+    {
+        const uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > length)
+            return false;
+        for (uint8_t k = 1; k < code; k++)
+        {
+            if (size == PACKET_SIZE)
+                return false;
+            packet[size++] = in[i++];
+        }
+        if (i < length)
+        {
+            if (size == PACKET_SIZE)
+                return false;
+            packet[size++] = 0x00; // The zero the code stood for
+        }
+    }
+
+    if (size != PACKET_SIZE)
+        return false;
+    const uint16_t crc = (packet[TrackFrame::SIZE] << 8) | packet[TrackFrame::SIZE + 1];
+    if (TrackCrc::ccitt(packet, TrackFrame::SIZE) != crc)
+        return false;
+
+    memcpy(frame.bytes, packet, TrackFrame::SIZE);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::receive
+-------------------------------------------------------------------  */
+
+void TrackSerialLink::receive()
+{
+    while (mStream.available() > 0)
+    {
+        const int c = mStream.read();
+        if (c < 0)
+            break;
+
+        if (c != 0x00)
+        {
+            if (mRxLength == SKIPPING)
+                continue;
+            if (mRxLength == MAX_ENCODED - 1)
+            {
+                mRxLength = SKIPPING; // Too long, wait for the next packet
+                mErrors++;
+                continue;
+            }
+            mRx[mRxLength++] = c;
+            continue;
+        }
+
+        const uint8_t length = mRxLength;
+        mRxLength = 0;
+        if (length == SKIPPING || length == 0)
+            continue;
+
+        TrackFrame frame;
+        TrackMessage message;
+        if (!decode(mRx, length, frame))
+        {
+            mErrors++;
+            continue;
+        }
+        frame.toMessage(message);
+
+        // Keep the hash of the PC, and do not echo the frame back
+        mFromHost = true;
+        const bool sent = mCtrl.forwardMessage(message);
+        mFromHost = false;
+        if (sent)
+            mReceived++;
+        else
+            mErrors++;
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::flush
+-------------------------------------------------------------------  */
+
+void TrackSerialLink::flush()
+{
+    uint8_t out[MAX_ENCODED];
+    TrackFrame frame;
+
+    while (!mQueue.isEmpty() && mStream.availableForWrite() >= MAX_ENCODED)
+    {
+        mQueue.pop(frame);
+        mStream.write(out, encode(frame, out));
+        mSent++;
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::update
+-------------------------------------------------------------------  */
+
+void TrackSerialLink::update()
+{
+    receive();
+    flush();
+}
+
+/* -------------------------------------------------------------------
+   TrackSerialLink::onMessage
+-------------------------------------------------------------------  */
+
+void TrackSerialLink::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (outgoing && mFromHost)
+        return;
+
+    TrackFrame frame;
+    frame.fromMessage(message);
+    if (!mQueue.push(frame))
+    {
+        mDropped++;
+        return;
+    }
+    flush();
+}
@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKSERIALLINK_H
+ #define TRACKSERIALLINK_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackFrame.h"
+
+ // ===================================================================
+ // === TrackSerialLink ===============================================
+ // ===================================================================
+
+ /**
+  * Turns the board into a CAN adapter for a PC on a serial port.
+  * Frames travel both ways in the 13 byte layout of TrackFrame,
+  * followed by a CRC-16/CCITT of these 13 bytes, big endian. The 15
+  * bytes are COBS encoded and end with a 0x00 byte, so a packet is
+  * at most 17 bytes and a receiver that missed something finds the
+  * next packet at the next 0x00.
+  *
+  * Frames from the PC are put on the bus as they are, with the hash
+  * the PC gave them. Everything seen on the bus goes to the PC: what
+  * is received and what this controller sends, except the frames
+  * that came from the PC. Frames wait in a queue while the serial
+  * port is busy, so update() never blocks on a slow port; when the
+  * queue is full the newest frame is dropped. The stream must tell
+  * its free space with availableForWrite(), as HardwareSerial does.
+  *
+  * Use a high baud rate: 921600 on an ESP32, 1000000 on an Uno whose
+  * 16 MHz clock divides it exactly. Turn the controller's debug
+  * output off, or it ends up in the packets; the PC side skips it
+  * thanks to the CRC, but loses time.
+  */
+ class TrackSerialLink : public TrackListener
+ {
+ public:
+   static const uint8_t PACKET_SIZE = TrackFrame::SIZE + 2;   // Frame and CRC
+   static const uint8_t MAX_ENCODED = PACKET_SIZE + 2;        // COBS overhead and delimiter
+
+ private:
+   TrackController &mCtrl;
+   Stream &mStream;
+   TrackRing<TrackFrame, TRACK_LINK_QUEUE_SIZE> mQueue;
+   uint8_t mRx[MAX_ENCODED];
+   uint8_t mRxLength; // 0xFF while skipping to the next delimiter
+   bool mFromHost;    // The frame being sent came from the PC
+   uint32_t mReceived;
+   uint32_t mSent;
+   uint32_t mErrors;
+   uint32_t mDropped;
+
+   void receive();
+   void flush();
+
+ public:
+   /**
+    * Links the given controller to 'stream', usually Serial. The
+    * stream must already be open.
+    */
+   TrackSerialLink(TrackController &ctrl, Stream &stream);
+   ~TrackSerialLink();
+
+   /**
+    * Packs 'frame' into a packet at 'out', which must hold
+    * MAX_ENCODED bytes, and returns its length.
+    */
+   static uint8_t encode(const TrackFrame &frame, uint8_t *out);
+
+   /**
+    * Unpacks a packet of 'length' bytes, without its delimiter.
+    * Returns false if it is malformed or its CRC is wrong.
+    */
+   static bool decode(const uint8_t *in, uint8_t length, TrackFrame &frame);
+
+   /**
+    * Counters: frames from the PC put on the bus, frames sent to the
+    * PC, packets from the PC thrown away and frames for the PC lost
+    * because the queue was full.
+    */
+   uint32_t getReceived() const { return mReceived; }
+   uint32_t getSent() const { return mSent; }
+   uint32_t getErrors() const { return mErrors; }
+   uint32_t getDropped() const { return mDropped; }
+
+   /**
+    * Moves frames in both directions. Call this as often as possible
+    * from loop(), after TrackController::update().
+    */
+   void update();
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKSERIALLINK_H
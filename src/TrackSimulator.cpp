@@ -0,0 +1,209 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackSimulator.h"
+#include "TrackCommand.h"
+
+static const uint32_t SIMULATED_UID = 0x47434711UL; // Looks like a Gleisbox UID
+static const uint16_t SIMULATED_TYPE = 0x0010;      // Device type of the Gleisbox
+
+/*
+   Texts of the simulated measurement channels 1..4: name, value at
+   raw 0, value at raw 0x0FFF and unit.
+*/
+static const char *const SIMULATED_CHANNELS[] = {
+    "MAIN\0" "0.000\0" "2.500\0" "A",
+    "PROG\0" "0.000\0" "1.000\0" "A",
+    "VOLT\0" "0.00\0" "30.00\0" "V",
+    "TEMP\0" "0.0\0" "100.0\0" "C"};
+
+/* -------------------------------------------------------------------
+   TrackSimulator (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackSimulator::TrackSimulator(TrackController &ctrl, uint16_t hash)
+    : mCtrl(ctrl),
+      mHash(hash),
+      mLoss(0),
+      mAnswered(0),
+      mDropped(0)
+{
+    memset(mStates, 0x00, sizeof(mStates));
+    mCtrl.addListener(this);
+}
+
+TrackSimulator::~TrackSimulator()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackSimulator::state
+-------------------------------------------------------------------  */
+
+TrackSimulator::State *TrackSimulator::state(uint16_t address)
+{
+    State *free = nullptr;
+
+    for (uint8_t i = 0; i < SLOTS; i++)
+    {
+        if (mStates[i].address == address)
+            return &mStates[i];
+        if (free == nullptr && mStates[i].address == 0)
+            free = &mStates[i];
+    }
+
+    if (free == nullptr)
+        free = &mStates[address % SLOTS]; // Table full, forget someone
+
+    memset(free, 0x00, sizeof(State));
+    free->address = address;
+    free->direction = DIR_FORWARD;
+    return free;
+}
+
+/* -------------------------------------------------------------------
+   TrackSimulator::onMessage
+-------------------------------------------------------------------  */
+
+void TrackSimulator::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (!outgoing || message.response)
+        return;
+
+    if (mLoss != 0 && random(100) < mLoss)
+    {
+        mDropped++;
+        return;
+    }
+
+    TrackMessage response = message;
+    response.response = true;
+    response.hash = mHash;
+
+    switch (message.command)
+    {
+    case CMD_LOCO_SPEED:
+    {
+        State *s = state(TrackCommand::address(message));
+        if (message.length >= 6)
+            s->speed = LocoSpeed::speed(message);
+        response.length = 6;
+        response.data[4] = TrackCommand::high(s->speed);
+        response.data[5] = TrackCommand::low(s->speed);
+        break;
+    }
+    case CMD_LOCO_DIR:
+    {
+        State *s = state(TrackCommand::address(message));
+        if (message.length >= 5)
+        {
+            const uint8_t direction = LocoDirection::direction(message);
+            if (direction == DIR_CHANGE)
+                s->direction = s->direction == DIR_FORWARD ? DIR_REVERSE : DIR_FORWARD;
+            else if (direction != DIR_CURRENT)
+                s->direction = direction;
+            s->speed = 0; // A change of direction stops the loco
+        }
+        response.length = 5;
+        response.data[4] = s->direction;
+        break;
+    }
+    case CMD_LOCO_FUNC:
+    {
+        State *s = state(TrackCommand::address(message));
+        const uint8_t function = LocoFunction::function(message) & 0x1F;
+        if (message.length >= 6)
+        {
+            if (LocoFunction::power(message))
+                s->functions |= 1UL << function;
+            else
+                s->functions &= ~(1UL << function);
+        }
+        response.length = 6;
+        response.data[5] = (s->functions >> function) & 0x01;
+        break;
+    }
+    case CMD_ACCESSORY:
+    {
+        State *s = state(TrackCommand::address(message));
+        if (message.length >= 6)
+            s->position = Accessory::position(message);
+        response.length = 6;
+        response.data[4] = s->position;
+        break;
+    }
+    case CMD_SYSTEM:
+        if (message.length >= 6 && SystemCommand::subcommand(message) == SYS_STATUS)
+        {
+            // A little noise around a quarter of the range
+            response.length = 8;
+            response.data[6] = 0x04;
+            response.data[7] = random(0x40);
+        }
+        break;
+    case CMD_STATUS_CONFIG:
+    {
+        const uint8_t index = StatusConfig::index(message);
+        if (message.length != 5 || index == 0 || index > 4)
+            break;
+
+        uint8_t description[48] = {index, 0xFD, 0x30, 0xF0, 0xE0, 0xC0, 0x00, 0x00, 0x04, 0x00, 0x08, 0x00, 0x0C, 0x00, 0x0F, 0xFF};
+        const char *texts = SIMULATED_CHANNELS[index - 1];
+        uint8_t size = 16;
+        for (uint8_t n = 0; n < 4; n++)
+        {
+            const uint8_t length = strlen(texts) + 1;
+            memcpy(&description[size], texts, length);
+            size += length;
+            texts += length;
+        }
+
+        // Packets numbered from 1 in the hash field, then the summary
+        const uint8_t packets = (size + 7) / 8;
+        for (uint8_t n = 0; n < packets; n++)
+        {
+            TrackMessage packet = response;
+            packet.hash = n + 1;
+            packet.length = 8;
+            memcpy(packet.data, &description[n * 8], 8);
+            mCtrl.injectMessage(packet);
+        }
+        response.length = 6;
+        response.data[5] = packets;
+        break;
+    }
+    case CMD_PING:
+        response.length = 8;
+        response.data[0] = (SIMULATED_UID >> 24) & 0xFF;
+        response.data[1] = (SIMULATED_UID >> 16) & 0xFF;
+        response.data[2] = (SIMULATED_UID >> 8) & 0xFF;
+        response.data[3] = SIMULATED_UID & 0xFF;
+        response.data[4] = TrackCommand::high(TRACKBOX_VERSION);
+        response.data[5] = TrackCommand::low(TRACKBOX_VERSION);
+        response.data[6] = TrackCommand::high(SIMULATED_TYPE);
+        response.data[7] = TrackCommand::low(SIMULATED_TYPE);
+        break;
+    default:
+        break; // Plain echo with the response bit set
+    }
+
+    if (mCtrl.injectMessage(response))
+        mAnswered++;
+    else
+        mDropped++;
+}
@@ -0,0 +1,81 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKSIMULATOR_H
+ #define TRACKSIMULATOR_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+
+ // ===================================================================
+ // === TrackSimulator ================================================
+ // ===================================================================
+
+ /**
+  * Simulates a connection box on the controller's receive path: every
+  * message the controller sends is answered with the response a
+  * Gleisbox would give, injected with injectMessage(). Speeds,
+  * directions, functions and accessory positions are remembered for
+  * up to 16 addresses, so queries return what was set. Four made-up
+  * measurement channels answer status requests. A loss rate
+  * can be set to exercise timeouts. Meant for benchmarks and for
+  * trying sketches without a layout; use it with loopback on or with
+  * no bus connected.
+  */
+ class TrackSimulator : public TrackListener
+ {
+ private:
+   static const uint8_t SLOTS = 16;
+
+   struct State
+   {
+     uint16_t address;
+     uint16_t speed;
+     uint8_t direction;
+     uint8_t position;
+     uint32_t functions;
+   };
+
+   TrackController &mCtrl;
+   State mStates[SLOTS];
+   uint16_t mHash;
+   uint8_t mLoss;
+   uint32_t mAnswered;
+   uint32_t mDropped;
+
+   State *state(uint16_t address);
+
+ public:
+   /**
+    * Attaches a simulator to the given controller. 'hash' is the hash
+    * the simulated box answers with.
+    */
+   TrackSimulator(TrackController &ctrl, uint16_t hash = 0x4711);
+   ~TrackSimulator();
+
+   /**
+    * Sets the percentage (0..100) of messages left unanswered.
+    */
+   void setLoss(uint8_t percent) { mLoss = percent; }
+
+   uint32_t getAnswered() const { return mAnswered; }
+   uint32_t getDropped() const { return mDropped; }
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKSIMULATOR_H
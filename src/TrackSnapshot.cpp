@@ -0,0 +1,272 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackSnapshot.h"
+#include "TrackCommand.h"
+#include "TrackCrc.h"
+
+/*
+   Block layout: kind, 13 bytes of payload and a CRC-16 of the first
+   14 bytes, big endian. Block 0 is the header, blocks 1 to
+   TRACK_MAX_LOCOS the slots of the loco table, then the blocks of
+   the accessory table.
+*/
+static const uint8_t KIND_FREE = 0x00;
+static const uint8_t KIND_HEADER = 'H';
+static const uint8_t KIND_LOCO = 'L';
+static const uint8_t KIND_ACCESSORY = 'A';
+static const uint8_t SNAPSHOT_VERSION = 2;
+static const uint8_t CRC_OFFSET = TrackStorage::BLOCK_SIZE - 2;
+static const uint16_t VERIFY_INTERVAL = 50; // ms between two verification queries
+
+/* -------------------------------------------------------------------
+   TrackSnapshot (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackSnapshot::TrackSnapshot(TrackController &ctrl, TrackStorage &storage, TrackLocoTable &locos, uint16_t interval)
+    : mCtrl(ctrl),
+      mStorage(storage),
+      mLocos(locos),
+      mAccessories(nullptr),
+      mInterval(interval),
+      mLast(0),
+      mVerified(0),
+      mVerify(TRACK_MAX_LOCOS),
+      mPower(false),
+      mReady(false),
+      mWrites(0)
+{
+    memset(mWritten, 0x00, sizeof(mWritten));
+    mCtrl.addListener(this);
+}
+
+TrackSnapshot::~TrackSnapshot()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::blocks
+-------------------------------------------------------------------  */
+
+uint16_t TrackSnapshot::blocks() const
+{
+    return mAccessories != nullptr ? MAX_BLOCKS : LOCO_BLOCKS;
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::emptyCrc
+-------------------------------------------------------------------  */
+
+uint16_t TrackSnapshot::emptyCrc(uint8_t block) const
+{
+    uint8_t data[CRC_OFFSET] = {0};
+    if (block >= LOCO_BLOCKS)
+        data[0] = KIND_ACCESSORY;
+    return TrackCrc::ccitt(data, CRC_OFFSET);
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::build
+-------------------------------------------------------------------  */
+
+void TrackSnapshot::build(uint8_t block, uint8_t *data)
+{
+    memset(data, 0x00, TrackStorage::BLOCK_SIZE);
+
+    if (block == 0)
+    {
+        data[0] = KIND_HEADER;
+        data[1] = SNAPSHOT_VERSION;
+        data[2] = TrackCommand::high(mCtrl.getHash());
+        data[3] = TrackCommand::low(mCtrl.getHash());
+        data[4] = mPower;
+        data[5] = TRACK_MAX_LOCOS;
+        data[6] = TrackCommand::high(TRACK_ACCESSORY_RANGE);
+        data[7] = TrackCommand::low(TRACK_ACCESSORY_RANGE);
+    }
+    else if (block >= LOCO_BLOCKS)
+    {
+        data[0] = KIND_ACCESSORY;
+        mAccessories->saveBlock(block - LOCO_BLOCKS, &data[1]);
+    }
+    else if (mLocos.getSlot(block - 1).address != 0) // Else KIND_FREE
+    {
+        const TrackLocoTable::Loco &loco = mLocos.getSlot(block - 1);
+        data[0] = KIND_LOCO;
+        data[1] = TrackCommand::high(loco.address);
+        data[2] = TrackCommand::low(loco.address);
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            data[3 + i] = loco.functions >> (24 - 8 * i);
+            data[7 + i] = loco.known >> (24 - 8 * i);
+        }
+        data[11] = TrackCommand::high(loco.speed);
+        data[12] = TrackCommand::low(loco.speed);
+        data[13] = (loco.flags << 4) | (loco.direction & 0x0F);
+    }
+
+    const uint16_t crc = TrackCrc::ccitt(data, CRC_OFFSET);
+    data[CRC_OFFSET] = TrackCommand::high(crc);
+    data[CRC_OFFSET + 1] = TrackCommand::low(crc);
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::load
+-------------------------------------------------------------------  */
+
+bool TrackSnapshot::load(uint8_t block, const uint8_t *data)
+{
+    const uint16_t crc = (data[CRC_OFFSET] << 8) | data[CRC_OFFSET + 1];
+    if (TrackCrc::ccitt(data, CRC_OFFSET) != crc)
+        return false;
+
+    if (block == 0)
+    {
+        if (data[0] != KIND_HEADER || data[1] != SNAPSHOT_VERSION || data[5] != TRACK_MAX_LOCOS ||
+            ((data[6] << 8) | data[7]) != TRACK_ACCESSORY_RANGE)
+            return false;
+        if (mCtrl.getHash() == 0)
+            mCtrl.setHash((data[2] << 8) | data[3]);
+        mPower = data[4];
+    }
+    else if (block >= LOCO_BLOCKS)
+    {
+        if (data[0] != KIND_ACCESSORY)
+            return false;
+        mAccessories->loadBlock(block - LOCO_BLOCKS, &data[1]);
+    }
+    else if (data[0] == KIND_LOCO)
+    {
+        TrackLocoTable::Loco loco;
+        loco.address = (data[1] << 8) | data[2];
+        loco.functions = 0;
+        loco.known = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            loco.functions = (loco.functions << 8) | data[3 + i];
+            loco.known = (loco.known << 8) | data[7 + i];
+        }
+        loco.speed = (data[11] << 8) | data[12];
+        loco.direction = data[13] & 0x0F;
+        loco.flags = data[13] >> 4;
+        loco.suppressed = 0;
+        mLocos.restore(loco);
+    }
+    else if (data[0] != KIND_FREE)
+        return false;
+
+    mWritten[block] = crc;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::restore
+-------------------------------------------------------------------  */
+
+bool TrackSnapshot::restore()
+{
+    mReady = mStorage.begin();
+    if (!mReady)
+        return false;
+
+    uint8_t data[TrackStorage::BLOCK_SIZE];
+    const bool valid = mStorage.read(0, data) && load(0, data);
+
+    for (uint16_t block = 1; block < blocks(); block++)
+    {
+        if (!mStorage.read(block, data))
+            mWritten[block] = emptyCrc(block); // Never written, no need to while empty
+        else if (valid)
+            load(block, data);
+    }
+    if (!valid)
+        return false;
+
+    // Check the restored locos in the background, starting now
+    mVerify = 0;
+    mVerified = millis() - VERIFY_INTERVAL;
+    mLast = millis();
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::save
+-------------------------------------------------------------------  */
+
+void TrackSnapshot::save()
+{
+    if (!mReady)
+        return;
+
+    uint8_t data[TrackStorage::BLOCK_SIZE];
+    for (uint16_t block = 0; block < blocks(); block++)
+    {
+        build(block, data);
+        const uint16_t crc = (data[CRC_OFFSET] << 8) | data[CRC_OFFSET + 1];
+        if (crc != mWritten[block] && mStorage.write(block, data))
+        {
+            mWritten[block] = crc;
+            mWrites++;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::update
+-------------------------------------------------------------------  */
+
+void TrackSnapshot::update()
+{
+    const uint32_t now = millis();
+
+    if (mVerify < TRACK_MAX_LOCOS && now - mVerified >= VERIFY_INTERVAL)
+    {
+        mVerified = now;
+        const uint16_t address = mLocos.getSlot(mVerify++).address;
+        if (address != 0)
+        {
+            // The answers update the loco table as they arrive
+            TrackMessage message = LocoSpeed::get(address);
+            mCtrl.sendMessage(message);
+            message = LocoDirection::get(address);
+            mCtrl.sendMessage(message);
+        }
+    }
+
+    if (now - mLast >= mInterval)
+    {
+        mLast = now;
+        save();
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackSnapshot::onMessage
+-------------------------------------------------------------------  */
+
+void TrackSnapshot::onMessage(const TrackMessage &message, bool)
+{
+    // Go and stop are broadcast, so any device switching the power is seen
+    if (message.command == CMD_SYSTEM && message.length == 5 && TrackCommand::uid(message) == 0)
+    {
+        if (SystemCommand::subcommand(message) == SYS_GO)
+            mPower = true;
+        else if (SystemCommand::subcommand(message) == SYS_STOP)
+            mPower = false;
+    }
+}
@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKSNAPSHOT_H
+ #define TRACKSNAPSHOT_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackLocoTable.h"
+ #include "TrackAccessoryTable.h"
+ #include "TrackStorage.h"
+
+ // ===================================================================
+ // === TrackSnapshot =================================================
+ // ===================================================================
+
+ /**
+  * Saves the state of the controller in a TrackStorage and brings it
+  * back after a reset: the hash, whether the track is powered, the
+  * speed, direction and functions in a TrackLocoTable and, if one is
+  * set, the positions in a TrackAccessoryTable.
+  *
+  * The state is cut into blocks, each with a CRC. update() compares
+  * the CRC of every block with the one last written, at most once
+  * per 'interval' ms, and writes only the blocks that changed, so a
+  * loco driven around costs one block write now and then. A block
+  * torn by a reset during the write fails its CRC and is skipped on
+  * restore.
+  *
+  * restore() takes milliseconds, so a sketch is back at work almost
+  * at once. The restored speeds and directions are then checked
+  * against the bus in the background, one loco after the other,
+  * without waiting for the answers: TrackLocoTable picks them up.
+  */
+ class TrackSnapshot : public TrackListener
+ {
+ private:
+   static const uint8_t LOCO_BLOCKS = 1 + TRACK_MAX_LOCOS;
+   static const uint16_t MAX_BLOCKS = LOCO_BLOCKS + TrackAccessoryTable::BLOCKS;
+
+   TrackController &mCtrl;
+   TrackStorage &mStorage;
+   TrackLocoTable &mLocos;
+   TrackAccessoryTable *mAccessories;
+   uint16_t mWritten[MAX_BLOCKS]; // CRC of each block as last written or read
+   uint16_t mInterval;
+   uint32_t mLast;
+   uint32_t mVerified; // Time of the last verification query
+   uint8_t mVerify;    // Next loco slot to check, TRACK_MAX_LOCOS when done
+   bool mPower;
+   bool mReady;
+   uint32_t mWrites;
+
+   uint16_t blocks() const;
+   uint16_t emptyCrc(uint8_t block) const;
+   void build(uint8_t block, uint8_t *data);
+   bool load(uint8_t block, const uint8_t *data);
+
+ public:
+   /**
+    * Saves the controller and loco table state in 'storage', at most
+    * once per 'interval' ms.
+    */
+   TrackSnapshot(TrackController &ctrl, TrackStorage &storage, TrackLocoTable &locos, uint16_t interval = 5000);
+   ~TrackSnapshot();
+
+   /**
+    * Saves the given accessory table as well, nullptr for none. Set
+    * it before restore().
+    */
+   void setAccessories(TrackAccessoryTable *accessories) { mAccessories = accessories; }
+
+   /**
+    * Opens the storage and loads the saved state. Call it once in
+    * setup(), before TrackController::begin(): a controller without
+    * a hash takes the saved one. Nothing is saved before. Returns
+    * false if there was no valid snapshot.
+    */
+   bool restore();
+
+   /**
+    * Writes the blocks that changed now.
+    */
+   void save();
+
+   /**
+    * Tells whether the track was powered, as last seen on the bus.
+    */
+   bool getPower() const { return mPower; }
+
+   /**
+    * Returns the number of blocks written since the start.
+    */
+   uint32_t getWrites() const { return mWrites; }
+
+   /**
+    * Saves and checks the restored state when due. Call this as
+    * often as possible from loop().
+    */
+   void update();
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKSNAPSHOT_H
@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackStorage.h"
+
+#if defined ARDUINO_ARCH_ESP32
+
+/* -------------------------------------------------------------------
+   blockKey
+-------------------------------------------------------------------  */
+
+static void blockKey(uint8_t block, char *key)
+{
+    static const char digits[] = "0123456789abcdef";
+    key[0] = 'b';
+    key[1] = digits[block >> 4];
+    key[2] = digits[block & 0x0F];
+    key[3] = '\0';
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageNVS (constructor)
+-------------------------------------------------------------------  */
+
+TrackStorageNVS::TrackStorageNVS(const char *name)
+    : mNamespace(name)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageNVS::begin
+-------------------------------------------------------------------  */
+
+bool TrackStorageNVS::begin()
+{
+    return mPreferences.begin(mNamespace, false);
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageNVS::read
+-------------------------------------------------------------------  */
+
+bool TrackStorageNVS::read(uint8_t block, uint8_t *data)
+{
+    char key[4];
+    blockKey(block, key);
+    return mPreferences.getBytes(key, data, BLOCK_SIZE) == BLOCK_SIZE;
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageNVS::write
+-------------------------------------------------------------------  */
+
+bool TrackStorageNVS::write(uint8_t block, const uint8_t *data)
+{
+    char key[4];
+    blockKey(block, key);
+    return mPreferences.putBytes(key, data, BLOCK_SIZE) == BLOCK_SIZE;
+}
+
+#elif defined ARDUINO_ARCH_AVR
+
+/* -------------------------------------------------------------------
+   TrackStorageEEPROM (constructor)
+-------------------------------------------------------------------  */
+
+TrackStorageEEPROM::TrackStorageEEPROM(uint16_t base)
+    : mBase(base)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageEEPROM::begin
+-------------------------------------------------------------------  */
+
+bool TrackStorageEEPROM::begin()
+{
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageEEPROM::read
+-------------------------------------------------------------------  */
+
+bool TrackStorageEEPROM::read(uint8_t block, uint8_t *data)
+{
+    const uint16_t address = mBase + block * BLOCK_SIZE;
+    if (address + BLOCK_SIZE > EEPROM.length())
+        return false;
+
+    for (uint8_t i = 0; i < BLOCK_SIZE; i++)
+        data[i] = EEPROM.read(address + i);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackStorageEEPROM::write
+-------------------------------------------------------------------  */
+
+bool TrackStorageEEPROM::write(uint8_t block, const uint8_t *data)
+{
+    const uint16_t address = mBase + block * BLOCK_SIZE;
+    if (address + BLOCK_SIZE > EEPROM.length())
+        return false;
+
+    for (uint8_t i = 0; i < BLOCK_SIZE; i++)
+        EEPROM.update(address + i, data[i]);
+    return true;
+}
+
+#endif
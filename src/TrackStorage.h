@@ -0,0 +1,112 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKSTORAGE_H
+ #define TRACKSTORAGE_H
+
+ #include <Arduino.h>
+
+ #if defined ARDUINO_ARCH_ESP32
+ #include <Preferences.h>
+ #elif defined ARDUINO_ARCH_AVR
+ #include <EEPROM.h>
+ #endif
+
+ // ===================================================================
+ // === TrackStorage ==================================================
+ // ===================================================================
+
+ /**
+  * Keeps numbered blocks of BLOCK_SIZE bytes across resets. Used by
+  * TrackSnapshot; each board has its own kind of non-volatile
+  * memory.
+  */
+ class TrackStorage
+ {
+ public:
+   static const uint8_t BLOCK_SIZE = 16;
+
+   virtual ~TrackStorage() {}
+
+   /**
+    * Opens the storage. Returns false if it cannot be used.
+    */
+   virtual bool begin() = 0;
+
+   /**
+    * Reads a block. Returns false if it was never written.
+    */
+   virtual bool read(uint8_t block, uint8_t *data) = 0;
+
+   /**
+    * Writes a block. Returns false if it could not be written.
+    */
+   virtual bool write(uint8_t block, const uint8_t *data) = 0;
+ };
+
+ #if defined ARDUINO_ARCH_ESP32
+
+ // ===================================================================
+ // === TrackStorageNVS ===============================================
+ // ===================================================================
+
+ /**
+  * Uses the NVS partition of the ESP32, one key per block in the
+  * given namespace. NVS spreads its writes over the flash pages
+  * itself.
+  */
+ class TrackStorageNVS : public TrackStorage
+ {
+ private:
+   Preferences mPreferences;
+   const char *mNamespace;
+
+ public:
+   TrackStorageNVS(const char *name = "railuino");
+
+   bool begin() override;
+   bool read(uint8_t block, uint8_t *data) override;
+   bool write(uint8_t block, const uint8_t *data) override;
+ };
+
+ #elif defined ARDUINO_ARCH_AVR
+
+ // ===================================================================
+ // === TrackStorageEEPROM ============================================
+ // ===================================================================
+
+ /**
+  * Uses the EEPROM of the AVR from byte 'base' on. Only the bytes
+  * that change are written, so each cell wears as little as
+  * possible.
+  */
+ class TrackStorageEEPROM : public TrackStorage
+ {
+ private:
+   uint16_t mBase;
+
+ public:
+   TrackStorageEEPROM(uint16_t base = 0);
+
+   bool begin() override;
+   bool read(uint8_t block, uint8_t *data) override;
+   bool write(uint8_t block, const uint8_t *data) override;
+ };
+
+ #endif
+
+ #endif // TRACKSTORAGE_H
@@ -0,0 +1,192 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackSupervisor.h"
+#include "TrackCommand.h"
+#include "TrackFrame.h"
+
+static const uint16_t MAX_WAIT = 1000; // ms between recovery attempts at most
+
+/* -------------------------------------------------------------------
+   isWorthHolding
+
+   Commands that set something, not queries: they carry their value.
+   A direction toggle does not: two held toggles would be merged into
+   one, and sent late it may toggle what was set meanwhile, as for
+   TrackRetry::isRetryable().
+-------------------------------------------------------------------  */
+
+static bool isWorthHolding(const TrackMessage &message)
+{
+    if (message.response)
+        return false;
+
+    switch (message.command)
+    {
+    case CMD_SYSTEM:
+        return message.length == 5 && SystemCommand::subcommand(message) <= SYS_LOCO_STOP;
+    case CMD_LOCO_SPEED:
+        return message.length == 6;
+    case CMD_LOCO_DIR:
+        return message.length == 5 && LocoDirection::direction(message) != DIR_CHANGE;
+    case CMD_LOCO_FUNC:
+        return message.length >= 6;
+    case CMD_ACCESSORY:
+        return message.length >= 5;
+    default:
+        return false;
+    }
+}
+
+/* -------------------------------------------------------------------
+   isSuperseded
+
+   Tells whether 'newer' makes 'older' pointless: same command, same
+   loco, accessory or device, same function. Stop, go and halt of a
+   device replace each other.
+-------------------------------------------------------------------  */
+
+static bool isSuperseded(const TrackMessage &older, const TrackMessage &newer)
+{
+    if (older.command != newer.command || memcmp(older.data, newer.data, 4) != 0)
+        return false;
+    if (newer.command == CMD_LOCO_DIR)
+        return LocoDirection::direction(older) != DIR_CHANGE && LocoDirection::direction(newer) != DIR_CHANGE;
+    if (newer.command == CMD_LOCO_FUNC)
+        return older.data[4] == newer.data[4];
+    if (newer.command == CMD_SYSTEM)
+        return SystemCommand::subcommand(older) <= SYS_HALT && SystemCommand::subcommand(newer) <= SYS_HALT;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSupervisor (constructor)
+-------------------------------------------------------------------  */
+
+TrackSupervisor::TrackSupervisor(uint16_t interval)
+    : mInterval(interval),
+      mWait(interval),
+      mChecked(0),
+      mAttempted(0),
+      mSince(0),
+      mState(TrackTransport::STATE_ACTIVE),
+      mTransmitErrors(0),
+      mReceiveErrors(0),
+      mBusOffs(0),
+      mDropped(0),
+      mLastDowntime(0),
+      mMaxDowntime(0),
+      mTotalDowntime(0)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackSupervisor::check
+-------------------------------------------------------------------  */
+
+bool TrackSupervisor::check(TrackTransport &transport, bool now)
+{
+    const uint32_t time = millis();
+    if (!now && time - mChecked < mInterval)
+        return !isBusOff();
+    mChecked = time;
+
+    const uint8_t previous = mState;
+    mState = transport.getState();
+    mTransmitErrors = transport.getTransmitErrors();
+    mReceiveErrors = transport.getReceiveErrors();
+
+    if (isBusOff())
+    {
+        if (previous != TrackTransport::STATE_BUS_OFF)
+        {
+            mBusOffs++;
+            mSince = time;
+            mWait = 0; // First attempt at once
+        }
+        if (time - mAttempted >= mWait)
+        {
+            mAttempted = time;
+            mWait = mWait == 0 ? mInterval : (mWait >= MAX_WAIT / 2 ? MAX_WAIT : mWait * 2);
+            transport.recover();
+        }
+        return false;
+    }
+
+    if (previous == TrackTransport::STATE_BUS_OFF)
+    {
+        mLastDowntime = time - mSince;
+        mTotalDowntime += mLastDowntime;
+        if (mLastDowntime > mMaxDowntime)
+            mMaxDowntime = mLastDowntime;
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSupervisor::hold
+-------------------------------------------------------------------  */
+
+bool TrackSupervisor::hold(const CANMessage &frame)
+{
+    CANMessage copy = frame;
+    TrackMessage message;
+    TrackFrameView(copy).toMessage(message);
+
+    if (!isWorthHolding(message))
+    {
+        mDropped++;
+        return false;
+    }
+
+    // Rotate the ring once, leaving out what the new frame replaces
+    const uint8_t count = mHeld.count();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        CANMessage held;
+        TrackMessage older;
+        mHeld.pop(held);
+        TrackFrameView(held).toMessage(older);
+        if (!isSuperseded(older, message))
+            mHeld.push(held);
+    }
+
+    if (mHeld.isFull())
+    {
+        CANMessage oldest;
+        mHeld.pop(oldest);
+        mDropped++;
+    }
+    mHeld.push(frame);
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackSupervisor::release
+-------------------------------------------------------------------  */
+
+uint8_t TrackSupervisor::release(TrackTransport &transport)
+{
+    uint8_t sent = 0;
+    while (!mHeld.isEmpty() && transport.tryToSend(mHeld[0]))
+    {
+        CANMessage frame;
+        mHeld.pop(frame);
+        sent++;
+    }
+    return sent;
+}
@@ -0,0 +1,119 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKSUPERVISOR_H
+ #define TRACKSUPERVISOR_H
+
+ #include <Arduino.h>
+ #include "Config.h"
+ #include "TrackMessage.h"
+ #include "TrackTransport.h"
+ #include "TrackRing.h"
+
+ // ===================================================================
+ // === TrackSupervisor ===============================================
+ // ===================================================================
+
+ /**
+  * Watches the error state of the CAN controller and brings it back
+  * when it went bus-off, after a short on the track connector or a
+  * handheld pulled out in the middle of a frame, instead of leaving
+  * every send failing until the next power cycle.
+  *
+  * The state is read at most once per 'interval' ms, and at once
+  * when a send fails. A controller found bus-off is told to recover,
+  * again and again with a growing wait up to one second while the
+  * fault lasts. Meanwhile the frames that change something on the
+  * layout (stop and go, speeds, directions, functions and accessory
+  * positions, but not direction toggles) are held, a newer frame for the same loco or accessory
+  * replacing the older one, and sent in order once the bus is back.
+  * Queries are dropped: nobody waits for their answer any more.
+  *
+  * Attach it with TrackController::setSupervisor().
+  */
+ class TrackSupervisor
+ {
+ private:
+   TrackRing<CANMessage, TRACK_HELD_FRAMES> mHeld;
+   uint16_t mInterval;
+   uint16_t mWait;      // ms until the next recovery attempt
+   uint32_t mChecked;   // Time of the last check
+   uint32_t mAttempted; // Time of the last recovery attempt
+   uint32_t mSince;     // Time the bus went off
+   uint8_t mState;
+   uint8_t mTransmitErrors;
+   uint8_t mReceiveErrors;
+   uint32_t mBusOffs;
+   uint32_t mDropped;
+   uint32_t mLastDowntime;
+   uint32_t mMaxDowntime;
+   uint32_t mTotalDowntime;
+
+ public:
+   /**
+    * Creates a supervisor checking the controller every 'interval'
+    * ms.
+    */
+   TrackSupervisor(uint16_t interval = 20);
+
+   /**
+    * Returns the last state seen, one of TrackTransport::STATE_*, and
+    * the error counters read with it.
+    */
+   uint8_t getState() const { return mState; }
+   bool isBusOff() const { return mState == TrackTransport::STATE_BUS_OFF; }
+   uint8_t getTransmitErrors() const { return mTransmitErrors; }
+   uint8_t getReceiveErrors() const { return mReceiveErrors; }
+
+   /**
+    * Counters: times the bus went off, frames held now and frames
+    * lost because they were queries or did not fit.
+    */
+   uint32_t getBusOffs() const { return mBusOffs; }
+   uint8_t getHeld() const { return mHeld.count(); }
+   uint32_t getDropped() const { return mDropped; }
+
+   /**
+    * Returns how long the bus was off, in ms: the last time, the
+    * longest time and all times together. The time running now
+    * counts once the bus is back.
+    */
+   uint32_t getLastDowntime() const { return mLastDowntime; }
+   uint32_t getMaxDowntime() const { return mMaxDowntime; }
+   uint32_t getTotalDowntime() const { return mTotalDowntime; }
+
+   /**
+    * Reads the state of 'transport' if due, or at once if 'now' is
+    * set, and starts or repeats a recovery while it is bus-off.
+    * Returns true if frames may be sent.
+    */
+   bool check(TrackTransport &transport, bool now);
+
+   /**
+    * Keeps a frame that could not be sent, if it is worth sending
+    * later. Returns false if it was dropped.
+    */
+   bool hold(const CANMessage &frame);
+
+   /**
+    * Sends the held frames, oldest first, until the transport takes
+    * no more. Returns the number sent.
+    */
+   uint8_t release(TrackTransport &transport);
+ };
+
+ #endif // TRACKSUPERVISOR_H
@@ -0,0 +1,346 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackTelemetry.h"
+#include "TrackCommand.h"
+
+static const uint16_t GLEISBOX_TYPE = 0x0010; // Device type answered to a ping
+static const uint8_t CONFIG_TRIES = 3;        // Configuration requests per channel
+
+/* -------------------------------------------------------------------
+   parseMilli
+
+   Turns a decimal text such as "2.500" or "-10.5" into thousandths.
+-------------------------------------------------------------------  */
+
+static int32_t parseMilli(const char *text)
+{
+    const bool negative = *text == '-';
+    if (negative)
+        text++;
+
+    int32_t value = 0;
+    while (*text >= '0' && *text <= '9')
+        value = value * 10 + (*text++ - '0');
+
+    uint8_t digits = 0;
+    if (*text == '.')
+        for (text++; *text >= '0' && *text <= '9' && digits < 3; digits++)
+            value = value * 10 + (*text++ - '0');
+    for (; digits < 3; digits++)
+        value *= 10;
+
+    return negative ? -value : value;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackTelemetry::TrackTelemetry(TrackController &ctrl, uint32_t uid, uint16_t interval)
+    : mCtrl(ctrl),
+      mAlarm(nullptr),
+      mUid(uid),
+      mGiven(uid),
+      mInterval(interval),
+      mLast(0),
+      mNext(0),
+      mSamples(0)
+{
+    clear();
+    for (uint8_t i = 0; i < TRACK_TELEMETRY_CHANNELS; i++)
+    {
+        mChannels[i].low = INT32_MIN;
+        mChannels[i].high = INT32_MAX;
+    }
+    mCtrl.addListener(this);
+}
+
+TrackTelemetry::~TrackTelemetry()
+{
+    mCtrl.removeListener(this);
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::clear
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::clear()
+{
+    for (uint8_t i = 0; i < TRACK_TELEMETRY_CHANNELS; i++)
+    {
+        Channel &channel = mChannels[i];
+        channel.raw.clear();
+        channel.zero = 0; // Raw values until configured
+        channel.top = 1;
+        channel.start = 0;
+        channel.end = 1;
+        channel.unit[0] = '\0';
+        channel.tries = 0;
+        channel.configured = false;
+        channel.alarm = false;
+    }
+    mUid = mGiven;
+    mNext = 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::setLimits
+-------------------------------------------------------------------  */
+
+bool TrackTelemetry::setLimits(uint8_t channel, int32_t low, int32_t high)
+{
+    if (channel == 0 || channel > TRACK_TELEMETRY_CHANNELS)
+        return false;
+
+    mChannels[channel - 1].low = low;
+    mChannels[channel - 1].high = high;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::scale
+
+   Maps the sum of 'count' raw values to the average reading.
+-------------------------------------------------------------------  */
+
+int32_t TrackTelemetry::scale(const Channel &channel, uint32_t raw, uint8_t count) const
+{
+    const int64_t offset = static_cast<int64_t>(raw) - static_cast<int64_t>(channel.zero) * count;
+    const int64_t span = static_cast<int64_t>(channel.top - channel.zero) * count;
+    return channel.start + static_cast<int32_t>(offset * (channel.end - channel.start) / span);
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::getStats
+-------------------------------------------------------------------  */
+
+bool TrackTelemetry::getStats(uint8_t channel, TrackTelemetryStats &stats) const
+{
+    if (channel == 0 || channel > TRACK_TELEMETRY_CHANNELS)
+        return false;
+
+    const Channel &c = mChannels[channel - 1];
+    const uint8_t count = c.raw.count();
+    if (count == 0)
+        return false;
+
+    uint16_t minimum = 0xFFFF;
+    uint16_t maximum = 0;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint16_t raw = c.raw[i];
+        if (raw < minimum)
+            minimum = raw;
+        if (raw > maximum)
+            maximum = raw;
+        sum += raw;
+    }
+
+    // The scale is linear, so it keeps averages; a falling scale swaps min and max
+    stats.latest = scale(c, c.raw[count - 1], 1);
+    stats.minimum = scale(c, minimum, 1);
+    stats.maximum = scale(c, maximum, 1);
+    if (stats.minimum > stats.maximum)
+    {
+        const int32_t swap = stats.minimum;
+        stats.minimum = stats.maximum;
+        stats.maximum = swap;
+    }
+    stats.average = scale(c, sum, count);
+    stats.count = count;
+    return true;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::getUnit
+-------------------------------------------------------------------  */
+
+const char *TrackTelemetry::getUnit(uint8_t channel) const
+{
+    if (channel == 0 || channel > TRACK_TELEMETRY_CHANNELS)
+        return "";
+    return mChannels[channel - 1].unit;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::isAlarm
+-------------------------------------------------------------------  */
+
+bool TrackTelemetry::isAlarm(uint8_t channel) const
+{
+    if (channel == 0 || channel > TRACK_TELEMETRY_CHANNELS)
+        return false;
+    return mChannels[channel - 1].alarm;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::update
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::update()
+{
+    const uint32_t now = millis();
+    if (now - mLast < mInterval)
+        return;
+    mLast = now;
+
+    if (mUid == 0)
+    {
+        TrackMessage message = DeviceCommand::ping();
+        mCtrl.sendMessage(message);
+        return;
+    }
+
+    // Ask for the configuration of each channel before polling values
+    for (uint8_t i = 0; i < TRACK_TELEMETRY_CHANNELS; i++)
+    {
+        Channel &channel = mChannels[i];
+        if (!channel.configured && channel.tries < CONFIG_TRIES)
+        {
+            channel.tries++;
+            memset(mConfig, 0, sizeof(mConfig));
+            TrackMessage message = StatusConfig::request(mUid, i + 1);
+            mCtrl.sendMessage(message);
+            return;
+        }
+    }
+
+    TrackMessage message = SystemCommand::status(mUid, mNext + 1);
+    mCtrl.sendMessage(message);
+    mNext = (mNext + 1) % TRACK_TELEMETRY_CHANNELS;
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::onMessage
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::onMessage(const TrackMessage &message, bool outgoing)
+{
+    if (outgoing || !message.response)
+        return;
+
+    switch (message.command)
+    {
+    case CMD_PING:
+        if (mUid == 0 && message.length == 8 && ((message.data[6] << 8) | message.data[7]) == GLEISBOX_TYPE)
+            mUid = TrackCommand::uid(message);
+        break;
+    case CMD_SYSTEM:
+        if (message.length == 8 && SystemCommand::subcommand(message) == SYS_STATUS && TrackCommand::uid(message) == mUid)
+            receiveStatus(message);
+        break;
+    case CMD_STATUS_CONFIG:
+        receiveConfig(message);
+        break;
+    default:
+        break;
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::receiveStatus
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::receiveStatus(const TrackMessage &message)
+{
+    const uint8_t number = SystemCommand::channel(message);
+    if (number == 0 || number > TRACK_TELEMETRY_CHANNELS)
+        return;
+
+    Channel &channel = mChannels[number - 1];
+    uint16_t oldest;
+    if (channel.raw.isFull())
+        channel.raw.pop(oldest);
+    channel.raw.push(SystemCommand::value(message));
+    mSamples++;
+
+    const int32_t value = scale(channel, SystemCommand::value(message), 1);
+    const bool alarm = value < channel.low || value > channel.high;
+    if (alarm != channel.alarm)
+    {
+        channel.alarm = alarm;
+        if (mAlarm != nullptr)
+            mAlarm(number, value, alarm);
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::receiveConfig
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::receiveConfig(const TrackMessage &message)
+{
+    if (message.length == 8)
+    {
+        // One packet of the description, numbered by the hash field
+        const uint16_t packet = message.hash;
+        if (packet >= 1 && packet <= CONFIG_BYTES / 8)
+            memcpy(&mConfig[(packet - 1) * 8], message.data, 8);
+    }
+    else if (message.length == 6 && TrackCommand::uid(message) == mUid)
+    {
+        const uint8_t index = StatusConfig::index(message);
+        if (index >= 1 && index <= TRACK_TELEMETRY_CHANNELS)
+            parseConfig(mChannels[index - 1], StatusConfig::packets(message));
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackTelemetry::parseConfig
+
+   Channel description: number, exponent, four colours, the raw zero
+   point and the raw ends of four ranges (big endian), then the name,
+   the values at the zero point and at the end of the last range, and
+   the unit, as zero-terminated texts.
+-------------------------------------------------------------------  */
+
+void TrackTelemetry::parseConfig(Channel &channel, uint8_t packets)
+{
+    const uint8_t size = packets * 8;
+    if (size > CONFIG_BYTES || size < 20)
+        return;
+
+    // Find the four texts following the 16 byte header
+    const char *texts[4];
+    uint8_t found = 0;
+    uint8_t i = 16;
+    while (found < 4 && i < size)
+    {
+        texts[found++] = reinterpret_cast<const char *>(&mConfig[i]);
+        while (i < size && mConfig[i] != 0)
+            i++;
+        i++; // Skip the terminator
+    }
+    if (found < 4 || i > size)
+        return;
+
+    const uint16_t zero = (mConfig[6] << 8) | mConfig[7];
+    const uint16_t top = (mConfig[14] << 8) | mConfig[15];
+    if (top == zero)
+        return;
+
+    channel.zero = zero;
+    channel.top = top;
+    channel.start = parseMilli(texts[1]);
+    channel.end = parseMilli(texts[2]);
+    strncpy(channel.unit, texts[3], sizeof(channel.unit) - 1);
+    channel.unit[sizeof(channel.unit) - 1] = '\0';
+    channel.configured = true;
+    channel.raw.clear(); // Older readings were on another scale
+}
@@ -0,0 +1,156 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKTELEMETRY_H
+ #define TRACKTELEMETRY_H
+
+ #include <Arduino.h>
+ #include "TrackController.h"
+ #include "TrackRing.h"
+
+ /**
+  * Called when a reading leaves the limits of its channel ('alarm'
+  * true) and when it comes back within them ('alarm' false). The
+  * value is in thousandths of the channel's unit.
+  */
+ typedef void (*TrackTelemetryAlarm)(uint8_t channel, int32_t value, bool alarm);
+
+ /**
+  * Summary of the readings kept for a channel, in thousandths of its
+  * unit.
+  */
+ struct TrackTelemetryStats
+ {
+   int32_t latest;
+   int32_t minimum;
+   int32_t maximum;
+   int32_t average;
+   uint8_t count;
+ };
+
+ // ===================================================================
+ // === TrackTelemetry ================================================
+ // ===================================================================
+
+ /**
+  * Watches the measurement channels of the connection box: track
+  * current, programming track current, voltage and temperature on a
+  * Gleisbox. update() asks for one channel at a time, round robin,
+  * with fire-and-forget status requests (0x00/0x0B); the responses
+  * are picked up as a listener, so nothing ever waits and the
+  * command path is not slowed down.
+  *
+  * The scale of each channel is read once from the box's status
+  * configuration (0x1D) and turns raw values into thousandths of the
+  * unit, so 2500 on a channel in A means 2.5 A. A channel whose
+  * configuration did not arrive reports raw values and an empty
+  * unit. The last TRACK_TELEMETRY_WINDOW readings of each channel are
+  * kept for the minimum, maximum and average.
+  *
+  * Without a UID, the first Gleisbox answering a ping is used.
+  */
+ class TrackTelemetry : public TrackListener
+ {
+ private:
+   static const uint8_t CONFIG_BYTES = 64;
+
+   struct Channel
+   {
+     TrackRing<uint16_t, TRACK_TELEMETRY_WINDOW> raw;
+     uint16_t zero;  // Raw value at 'start'
+     uint16_t top;   // Raw value at 'end'
+     int32_t start;  // Thousandths of the unit
+     int32_t end;
+     int32_t low;    // Limits, thousandths of the unit
+     int32_t high;
+     char unit[4];
+     uint8_t tries;  // Configuration requests sent
+     bool configured;
+     bool alarm;
+   };
+
+   TrackController &mCtrl;
+   Channel mChannels[TRACK_TELEMETRY_CHANNELS];
+   TrackTelemetryAlarm mAlarm;
+   uint32_t mUid;
+   uint32_t mGiven; // UID passed to the constructor
+   uint16_t mInterval;
+   uint32_t mLast;
+   uint8_t mNext;
+   uint8_t mConfig[CONFIG_BYTES];
+   uint32_t mSamples;
+
+   int32_t scale(const Channel &channel, uint32_t raw, uint8_t count) const;
+   void receiveStatus(const TrackMessage &message);
+   void receiveConfig(const TrackMessage &message);
+   void parseConfig(Channel &channel, uint8_t packets);
+
+ public:
+   /**
+    * Watches the device with the given UID, or the first Gleisbox
+    * found if 0, sending one request every 'interval' ms.
+    */
+   TrackTelemetry(TrackController &ctrl, uint32_t uid = 0, uint16_t interval = 250);
+   ~TrackTelemetry();
+
+   /**
+    * Sets the function called when a channel goes out of its limits
+    * or comes back.
+    */
+   void setAlarm(TrackTelemetryAlarm alarm) { mAlarm = alarm; }
+
+   /**
+    * Sets the limits of a channel (1..TRACK_TELEMETRY_CHANNELS) in
+    * thousandths of its unit.
+    */
+   bool setLimits(uint8_t channel, int32_t low, int32_t high);
+
+   /**
+    * Gives the readings of a channel. Returns false if there are
+    * none yet.
+    */
+   bool getStats(uint8_t channel, TrackTelemetryStats &stats) const;
+
+   /**
+    * Returns the unit of a channel as sent by the box, "" if unknown.
+    */
+   const char *getUnit(uint8_t channel) const;
+
+   /**
+    * Tells whether a channel is currently outside its limits.
+    */
+   bool isAlarm(uint8_t channel) const;
+
+   uint32_t getUid() const { return mUid; }
+   uint32_t getSamples() const { return mSamples; }
+
+   /**
+    * Forgets all readings and configurations, and the device if it
+    * was found by ping.
+    */
+   void clear();
+
+   /**
+    * Sends the next request when it is due. Call this as often as
+    * possible from loop().
+    */
+   void update();
+
+   void onMessage(const TrackMessage &message, bool outgoing) override;
+ };
+
+ #endif // TRACKTELEMETRY_H
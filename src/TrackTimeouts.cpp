@@ -0,0 +1,167 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackTimeouts.h"
+#include "TrackCommand.h"
+
+static const uint8_t MAX_BACKOFF = 3; // Timeouts grow at most 8 times
+
+/* -------------------------------------------------------------------
+   TrackTimeouts (constructor)
+-------------------------------------------------------------------  */
+
+TrackTimeouts::TrackTimeouts(uint32_t minimum, uint8_t warmup)
+    : mMinimum(minimum),
+      mWarmup(warmup ? warmup : 1)
+{
+    clear();
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::clear
+-------------------------------------------------------------------  */
+
+void TrackTimeouts::clear()
+{
+    memset(mEstimates, 0x00, sizeof(mEstimates));
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::commandIndex
+-------------------------------------------------------------------  */
+
+uint8_t TrackTimeouts::commandIndex(uint8_t command)
+{
+    switch (command)
+    {
+    case CMD_SYSTEM:
+        return 0;
+    case CMD_LOCO_SPEED:
+        return 1;
+    case CMD_LOCO_DIR:
+        return 2;
+    case CMD_LOCO_FUNC:
+        return 3;
+    case CMD_READ_CONFIG:
+        return 4;
+    case CMD_WRITE_CONFIG:
+        return 5;
+    case CMD_ACCESSORY:
+        return 6;
+    default:
+        return 7;
+    }
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::addressClass
+-------------------------------------------------------------------  */
+
+uint8_t TrackTimeouts::addressClass(uint16_t address)
+{
+    if (address >= ADDR_DCC)
+        return CLASS_DCC;
+    if (address >= ADDR_SX2)
+        return CLASS_SX2;
+    if (address >= ADDR_MFX)
+        return CLASS_MFX;
+    if (address >= ADDR_ACC_DCC)
+        return CLASS_ACC_DCC;
+    if (address > ADDR_ACC_MM2)
+        return CLASS_ACC_MM2;
+    if (address >= ADDR_ACC_SX1)
+        return CLASS_ACC_SX1;
+    if (address >= ADDR_SX1)
+        return CLASS_SX1;
+    return CLASS_MM2;
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::estimate
+-------------------------------------------------------------------  */
+
+TrackTimeouts::Estimate &TrackTimeouts::estimate(const TrackMessage &request)
+{
+    return mEstimates[commandIndex(request.command)][addressClass(TrackCommand::address(request))];
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::getTimeout
+-------------------------------------------------------------------  */
+
+uint32_t TrackTimeouts::getTimeout(const TrackMessage &request, uint32_t fallback)
+{
+    const Estimate &e = estimate(request);
+    if (e.samples < mWarmup)
+        return fallback;
+
+    uint32_t timeout = (static_cast<uint32_t>(e.smoothed) + 4UL * e.deviation) << UNIT_SHIFT;
+    if (timeout < mMinimum)
+        timeout = mMinimum;
+    timeout <<= e.backoff;
+    return timeout < fallback ? timeout : fallback;
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::getSmoothed
+-------------------------------------------------------------------  */
+
+uint32_t TrackTimeouts::getSmoothed(const TrackMessage &request)
+{
+    return static_cast<uint32_t>(estimate(request).smoothed) << UNIT_SHIFT;
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::sample
+-------------------------------------------------------------------  */
+
+void TrackTimeouts::sample(const TrackMessage &request, uint32_t latency)
+{
+    Estimate &e = estimate(request);
+    uint32_t units = latency >> UNIT_SHIFT;
+    if (units > 0xFFFF)
+        units = 0xFFFF;
+
+    if (e.samples == 0)
+    {
+        e.smoothed = units;
+        e.deviation = units / 2;
+    }
+    else
+    {
+        // RFC 6298: deviation gains 1/4 of the error, smoothed 1/8
+        const int32_t error = static_cast<int32_t>(units) - e.smoothed;
+        const int32_t magnitude = error < 0 ? -error : error;
+        e.deviation = e.deviation + (magnitude - e.deviation) / 4;
+        e.smoothed = e.smoothed + error / 8;
+    }
+
+    if (e.samples < 0xFF)
+        e.samples++;
+    e.backoff = 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackTimeouts::expired
+-------------------------------------------------------------------  */
+
+void TrackTimeouts::expired(const TrackMessage &request)
+{
+    Estimate &e = estimate(request);
+    if (e.backoff < MAX_BACKOFF)
+        e.backoff++;
+}
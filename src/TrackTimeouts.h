@@ -0,0 +1,121 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKTIMEOUTS_H
+ #define TRACKTIMEOUTS_H
+
+ #include <Arduino.h>
+ #include "TrackMessage.h"
+
+ /**
+  * Constants for the address classes response times are learned for.
+  */
+ #define CLASS_MM2      0
+ #define CLASS_SX1      1
+ #define CLASS_ACC_SX1  2
+ #define CLASS_ACC_MM2  3
+ #define CLASS_ACC_DCC  4
+ #define CLASS_MFX      5
+ #define CLASS_SX2      6
+ #define CLASS_DCC      7
+
+ // ===================================================================
+ // === TrackTimeouts =================================================
+ // ===================================================================
+
+ /**
+  * Learns how long responses take, per command (speed, direction,
+  * function, config read, ...) and per address class (MM2, mfx,
+  * DCC, ...), and derives the timeout of each exchange from it. Like
+  * TCP, it keeps a smoothed response time and its mean deviation;
+  * the timeout is the smoothed time plus four deviations, which is
+  * above nearly all (about 99 %) observed response times. A fast mfx
+  * decoder thus times out after a few ms while config reads keep a
+  * long timeout. Until enough responses have been seen, and as an
+  * upper bound, the controller's fixed timeout applies. Each timeout
+  * doubles the next one of that kind, up to eight times.
+  *
+  * Attach it with TrackController::setTimeouts(). The table takes
+  * 384 bytes of RAM.
+  */
+ class TrackTimeouts
+ {
+ public:
+   static const uint8_t COMMANDS = 8;
+   static const uint8_t CLASSES = 8;
+
+ private:
+   /**
+    * Times are stored in units of 16 us, so they fit into 16 bits
+    * up to about one second.
+    */
+   static const uint8_t UNIT_SHIFT = 4;
+
+   struct Estimate
+   {
+     uint16_t smoothed;
+     uint16_t deviation;
+     uint8_t samples;
+     uint8_t backoff;
+   };
+
+   Estimate mEstimates[COMMANDS][CLASSES];
+   uint32_t mMinimum;
+   uint8_t mWarmup;
+
+   Estimate &estimate(const TrackMessage &request);
+
+ public:
+   /**
+    * Creates an empty table. Learned timeouts are never below
+    * 'minimum' microseconds, and are used once 'warmup' responses of
+    * their kind have been seen.
+    */
+   TrackTimeouts(uint32_t minimum = 5000, uint8_t warmup = 8);
+
+   /**
+    * Returns the timeout for the given request in microseconds, at
+    * most 'fallback', which is also returned while still learning.
+    */
+   uint32_t getTimeout(const TrackMessage &request, uint32_t fallback);
+
+   /**
+    * Returns the smoothed response time learned for the given
+    * request in microseconds, or 0 if there is none yet.
+    */
+   uint32_t getSmoothed(const TrackMessage &request);
+
+   /**
+    * Records the response time of a request, in microseconds.
+    */
+   void sample(const TrackMessage &request, uint32_t latency);
+
+   /**
+    * Records that a request got no response in time.
+    */
+   void expired(const TrackMessage &request);
+
+   /**
+    * Forgets everything learned.
+    */
+   void clear();
+
+   static uint8_t commandIndex(uint8_t command);
+   static uint8_t addressClass(uint16_t address);
+ };
+
+ #endif // TRACKTIMEOUTS_H
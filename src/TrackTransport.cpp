@@ -0,0 +1,294 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackTransport.h"
+
+#if defined ARDUINO_ARCH_ESP32
+#include <soc/soc.h>
+#endif
+
+static const uint32_t DESIRED_BIT_RATE = 250UL * 1000UL; // Marklin CAN baudrate = 250Kbit/s
+
+/* -------------------------------------------------------------------
+   printSettings
+-------------------------------------------------------------------  */
+
+template <typename S>
+static void printSettings(const S &settings)
+{
+    Serial.print(F("Bit Rate prescaler: "));
+    Serial.println(settings.mBitRatePrescaler);
+    Serial.print(F("Triple Sampling: "));
+    Serial.println(settings.mTripleSampling ? F("yes") : F("no"));
+    Serial.print(F("Actual bit rate: "));
+    Serial.print(settings.actualBitRate());
+    Serial.println(F(" bit/s"));
+    Serial.print(F("Exact bit rate ? "));
+    Serial.println(settings.exactBitRate() ? F("yes") : F("no"));
+    Serial.print(F("Sample point: "));
+    Serial.print(settings.samplePointFromBitStart());
+    Serial.println(F("%"));
+}
+
+/* -------------------------------------------------------------------
+   stateOf
+
+   Both controllers follow ISO 11898: warning at 96 errors, passive
+   at 128.
+-------------------------------------------------------------------  */
+
+static uint8_t stateOf(bool busOff, uint8_t transmitErrors, uint8_t receiveErrors)
+{
+    if (busOff)
+        return TrackTransport::STATE_BUS_OFF;
+    if (transmitErrors >= 128 || receiveErrors >= 128)
+        return TrackTransport::STATE_PASSIVE;
+    if (transmitErrors >= 96 || receiveErrors >= 96)
+        return TrackTransport::STATE_WARNING;
+    return TrackTransport::STATE_ACTIVE;
+}
+
+#if defined ARDUINO_ARCH_ESP32
+
+/*
+   The TWAI controller is an SJA1000 with 32 bit wide registers.
+   ACAN_ESP32 does not give its error state, so it is read here.
+*/
+#if defined DR_REG_TWAI_BASE
+static const uint32_t TWAI_BASE = DR_REG_TWAI_BASE;
+#else
+static const uint32_t TWAI_BASE = DR_REG_CAN_BASE;
+#endif
+static const uint32_t TWAI_MODE = TWAI_BASE + 0x00;
+static const uint32_t TWAI_STATUS = TWAI_BASE + 0x08;
+static const uint32_t TWAI_RX_ERRORS = TWAI_BASE + 0x38;
+static const uint32_t TWAI_TX_ERRORS = TWAI_BASE + 0x3C;
+static const uint32_t TWAI_MODE_RESET = 0x01;
+static const uint32_t TWAI_STATUS_BUS_OFF = 0x80;
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32 (constructor)
+-------------------------------------------------------------------  */
+
+TrackTransportESP32::TrackTransportESP32(uint8_t rxPin, uint8_t txPin)
+    : mRxPin(rxPin),
+      mTxPin(txPin)
+{
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::setPins
+-------------------------------------------------------------------  */
+
+void TrackTransportESP32::setPins(uint8_t rxPin, uint8_t txPin)
+{
+    mRxPin = rxPin;
+    mTxPin = txPin;
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::begin
+-------------------------------------------------------------------  */
+
+uint32_t TrackTransportESP32::begin()
+{
+    Serial.println(F("Configure ESP32 CAN"));
+    ACAN_ESP32_Settings settings(DESIRED_BIT_RATE);
+    settings.mRxPin = (gpio_num_t)mRxPin;
+    settings.mTxPin = (gpio_num_t)mTxPin;
+    const uint32_t errorCode = ACAN_ESP32::can.begin(settings);
+    if (errorCode == 0)
+        printSettings(settings);
+    return errorCode;
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::tryToSend
+-------------------------------------------------------------------  */
+
+bool TrackTransportESP32::tryToSend(const CANMessage &frame)
+{
+    return ACAN_ESP32::can.tryToSend(frame);
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::receive
+-------------------------------------------------------------------  */
+
+bool TrackTransportESP32::receive(CANMessage &frame)
+{
+    return ACAN_ESP32::can.receive(frame);
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::getState / getTransmitErrors / getReceiveErrors
+-------------------------------------------------------------------  */
+
+uint8_t TrackTransportESP32::getState()
+{
+    const bool busOff = (REG_READ(TWAI_STATUS) & TWAI_STATUS_BUS_OFF) != 0;
+    return stateOf(busOff, getTransmitErrors(), getReceiveErrors());
+}
+
+uint8_t TrackTransportESP32::getTransmitErrors()
+{
+    return REG_READ(TWAI_TX_ERRORS) & 0xFF;
+}
+
+uint8_t TrackTransportESP32::getReceiveErrors()
+{
+    return REG_READ(TWAI_RX_ERRORS) & 0xFF;
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportESP32::recover
+
+   On bus-off the controller puts itself in reset mode. Leaving it
+   starts the recovery the standard asks for, 128 times 11 recessive
+   bits, about 6 ms at 250 kbit/s, after which it is active again on
+   its own. The driver and its buffers are left alone.
+-------------------------------------------------------------------  */
+
+bool TrackTransportESP32::recover()
+{
+    REG_CLR_BIT(TWAI_MODE, TWAI_MODE_RESET);
+    return true;
+}
+
+#endif
+
+#if defined TRACK_HAS_MCP2515
+
+TrackTransportMCP2515 *TrackTransportMCP2515::sInstances[MAX_INSTANCES];
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515 (constructor / destructor)
+-------------------------------------------------------------------  */
+
+TrackTransportMCP2515::TrackTransportMCP2515(uint8_t csPin, uint8_t intPin, SPIClass &spi, uint32_t quartz)
+    : mCan(csPin, spi, intPin),
+      mSpi(spi),
+      mQuartz(quartz)
+{
+}
+
+TrackTransportMCP2515::~TrackTransportMCP2515()
+{
+    mCan.end(); // Detaches the interrupt before the slot is freed
+    for (uint8_t i = 0; i < MAX_INSTANCES; i++)
+        if (sInstances[i] == this)
+            sInstances[i] = nullptr;
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::isr0 / isr1
+-------------------------------------------------------------------  */
+
+void TrackTransportMCP2515::isr0()
+{
+    sInstances[0]->mCan.isr();
+}
+
+void TrackTransportMCP2515::isr1()
+{
+    sInstances[1]->mCan.isr();
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::begin
+-------------------------------------------------------------------  */
+
+uint32_t TrackTransportMCP2515::begin()
+{
+    static void (*const routines[MAX_INSTANCES])() = {isr0, isr1};
+    uint8_t slot = MAX_INSTANCES;
+
+    // Reuse our slot when begin() is called again, else take a free one
+    for (uint8_t i = 0; i < MAX_INSTANCES && slot == MAX_INSTANCES; i++)
+        if (sInstances[i] == this)
+            slot = i;
+    for (uint8_t i = 0; i < MAX_INSTANCES && slot == MAX_INSTANCES; i++)
+        if (sInstances[i] == nullptr)
+            slot = i;
+    if (slot == MAX_INSTANCES)
+        return 0xFFFFFFFFUL;
+    sInstances[slot] = this;
+
+    //--- Begin SPI
+    mSpi.begin();
+    Serial.println(F("Configure ACAN2515"));
+    ACAN2515Settings settings(mQuartz, DESIRED_BIT_RATE);
+    const uint16_t errorCode = mCan.begin(settings, routines[slot]);
+    if (errorCode == 0)
+        printSettings(settings);
+    return errorCode;
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::tryToSend
+-------------------------------------------------------------------  */
+
+bool TrackTransportMCP2515::tryToSend(const CANMessage &frame)
+{
+    return mCan.tryToSend(frame);
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::receive
+-------------------------------------------------------------------  */
+
+bool TrackTransportMCP2515::receive(CANMessage &frame)
+{
+    return mCan.receive(frame);
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::getState / getTransmitErrors / getReceiveErrors
+-------------------------------------------------------------------  */
+
+uint8_t TrackTransportMCP2515::getState()
+{
+    const bool busOff = (mCan.errorFlagRegister() & 0x20) != 0; // EFLG.TXBO
+    return stateOf(busOff, mCan.transmitErrorCounter(), mCan.receiveErrorCounter());
+}
+
+uint8_t TrackTransportMCP2515::getTransmitErrors()
+{
+    return mCan.transmitErrorCounter();
+}
+
+uint8_t TrackTransportMCP2515::getReceiveErrors()
+{
+    return mCan.receiveErrorCounter();
+}
+
+/* -------------------------------------------------------------------
+   TrackTransportMCP2515::recover
+
+   The MCP2515 rejoins the bus by itself once it has seen enough
+   recessive bits. If it is still off when asked, it is restarted.
+-------------------------------------------------------------------  */
+
+bool TrackTransportMCP2515::recover()
+{
+    if ((mCan.errorFlagRegister() & 0x20) == 0)
+        return true;
+    mCan.end();
+    return begin() == 0;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKTRANSPORT_H
+ #define TRACKTRANSPORT_H
+
+ #include <Arduino.h>
+
+ #if defined ARDUINO_ARCH_ESP32
+ #include <ACAN_ESP32.h> // https://github.com/pierremolinaro/acan-esp32.git
+ #endif
+
+ /*
+    The MCP2515 transport is always there on AVR. On ESP32 it is
+    there when the ACAN2515 library is installed, so a board can drive
+    a second bus through an MCP2515 next to its built-in controller.
+ */
+ #if defined ARDUINO_ARCH_AVR
+ #define TRACK_HAS_MCP2515 1
+ #elif defined __has_include
+ #if __has_include(<ACAN2515.h>)
+ #define TRACK_HAS_MCP2515 1
+ #endif
+ #endif
+
+ #if defined TRACK_HAS_MCP2515
+ #include <ACAN2515.h> // https://github.com/pierremolinaro/acan2515.git
+ #endif
+
+ // ===================================================================
+ // === TrackTransport ================================================
+ // ===================================================================
+
+ /**
+  * Moves raw CAN frames between a TrackController and one CAN bus.
+  * Each controller owns a pointer to its transport, so a sketch can
+  * run several controllers on separate buses, each with its own
+  * transport. All frames use the Märklin bit rate of 250 kbit/s.
+  */
+ class TrackTransport
+ {
+ public:
+   /**
+    * Error states of the CAN controller, as given by getState(). A
+    * controller seeing too many errors first warns, then only sends
+    * passive error flags and finally leaves the bus altogether.
+    */
+   static const uint8_t STATE_ACTIVE = 0;
+   static const uint8_t STATE_WARNING = 1; // An error counter reached 96
+   static const uint8_t STATE_PASSIVE = 2; // An error counter reached 128
+   static const uint8_t STATE_BUS_OFF = 3; // Transmit errors reached 256
+
+   virtual ~TrackTransport() {}
+
+   /**
+    * Configures the CAN hardware. Returns 0 on success, otherwise
+    * the error code of the driver.
+    */
+   virtual uint32_t begin() = 0;
+
+   /**
+    * Queues a frame for sending. Returns false if the transmit
+    * buffer is full.
+    */
+   virtual bool tryToSend(const CANMessage &frame) = 0;
+
+   /**
+    * Takes a received frame, if any. Does not block.
+    */
+   virtual bool receive(CANMessage &frame) = 0;
+
+   /**
+    * Reads the error state and counters of the CAN controller. A
+    * transport that cannot tell is always active.
+    */
+   virtual uint8_t getState() { return STATE_ACTIVE; }
+   virtual uint8_t getTransmitErrors() { return 0; }
+   virtual uint8_t getReceiveErrors() { return 0; }
+
+   /**
+    * Brings a controller that went bus-off back on the bus. Returns
+    * false if it could not be restarted. Frames queued in the driver
+    * may be lost.
+    */
+   virtual bool recover() { return begin() == 0; }
+ };
+
+ #if defined ARDUINO_ARCH_ESP32
+
+ // ===================================================================
+ // === TrackTransportESP32 ===========================================
+ // ===================================================================
+
+ /**
+  * Uses the CAN controller built into the ESP32. There is only one,
+  * so there should be only one instance of this class.
+  */
+ class TrackTransportESP32 : public TrackTransport
+ {
+ private:
+   uint8_t mRxPin;
+   uint8_t mTxPin;
+
+ public:
+   TrackTransportESP32(uint8_t rxPin = 5, uint8_t txPin = 4);
+
+   void setPins(uint8_t rxPin, uint8_t txPin);
+
+   uint32_t begin() override;
+   bool tryToSend(const CANMessage &frame) override;
+   bool receive(CANMessage &frame) override;
+   uint8_t getState() override;
+   uint8_t getTransmitErrors() override;
+   uint8_t getReceiveErrors() override;
+   bool recover() override;
+ };
+
+ #endif
+
+ #if defined TRACK_HAS_MCP2515
+
+ // ===================================================================
+ // === TrackTransportMCP2515 =========================================
+ // ===================================================================
+
+ /**
+  * Uses an MCP2515 connected over SPI. Each instance drives its own
+  * chip, given by its chip select and interrupt pins. Up to
+  * MAX_INSTANCES chips can be used at once, since the interrupt
+  * service routines cannot take arguments.
+  */
+ class TrackTransportMCP2515 : public TrackTransport
+ {
+ public:
+   static const uint8_t MAX_INSTANCES = 2;
+
+ private:
+   ACAN2515 mCan;
+   SPIClass &mSpi;
+   uint32_t mQuartz;
+
+   static TrackTransportMCP2515 *sInstances[MAX_INSTANCES];
+   static void isr0();
+   static void isr1();
+
+ public:
+   /**
+    * Creates a transport for the MCP2515 at the given pins. 'quartz'
+    * is the frequency of the crystal on the MCP2515 board.
+    */
+   TrackTransportMCP2515(uint8_t csPin, uint8_t intPin, SPIClass &spi = SPI, uint32_t quartz = 16UL * 1000UL * 1000UL);
+   ~TrackTransportMCP2515();
+
+   uint32_t begin() override;
+   bool tryToSend(const CANMessage &frame) override;
+   bool receive(CANMessage &frame) override;
+   uint8_t getState() override;
+   uint8_t getTransmitErrors() override;
+   uint8_t getReceiveErrors() override;
+   bool recover() override;
+ };
+
+ #endif
+
+ #endif // TRACKTRANSPORT_H
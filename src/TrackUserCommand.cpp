@@ -0,0 +1,204 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include "TrackUserCommand.h"
+
+/*
+   Syntax of each command: word, command type, minimum and maximum
+   number of arguments, the largest value allowed per argument and
+   the argument that may also be written the old way, as two digits
+   packed into one token (0 for none). The table lives in flash on
+   AVR, so entries are copied out one at a time.
+*/
+struct UserCommandSyntax
+{
+    char word[10];
+    uint8_t type;
+    uint8_t minArgs;
+    uint8_t maxArgs;
+    uint16_t limits[4];
+    uint8_t packed;
+};
+
+static const UserCommandSyntax SYNTAX[] PROGMEM = {
+    {"power", USER_POWER, 1, 1, {1, 0, 0, 0}, 0},
+    {"emergency", USER_EMERGENCY, 1, 1, {0xFFFF, 0, 0, 0}, 0},
+    {"halt", USER_HALT, 1, 1, {0xFFFF, 0, 0, 0}, 0},
+    {"direction", USER_DIRECTION, 2, 2, {0xFFFF, DIR_CHANGE, 0, 0}, 0},
+    {"speed", USER_SPEED, 2, 2, {0xFFFF, 1023, 0, 0}, 0},
+    {"function", USER_FUNCTION, 3, 3, {0xFFFF, 31, 31, 0}, 1},   // Old form: function 16391 01
+    {"accessory", USER_ACCESSORY, 3, 4, {0xFFFF, 3, 31, 0xFFFF}, 1}, // Old form: accessory 12289 11 20
+};
+
+static const uint8_t SYNTAX_COUNT = sizeof(SYNTAX) / sizeof(SYNTAX[0]);
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* -------------------------------------------------------------------
+   TrackUserCommandParser::parseNumber
+-------------------------------------------------------------------  */
+
+bool TrackUserCommandParser::parseNumber(const char *&p, const char *end, uint32_t *value)
+{
+    uint32_t result = 0;
+    uint8_t base = 10;
+    uint8_t digits = 0;
+
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    {
+        base = 16;
+        p += 2;
+    }
+
+    while (p < end && !isBlank(*p))
+    {
+        const char c = *p;
+        uint8_t digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (base == 16 && c >= 'a' && c <= 'f')
+            digit = 10 + c - 'a';
+        else if (base == 16 && c >= 'A' && c <= 'F')
+            digit = 10 + c - 'A';
+        else
+            return false;
+
+        result = result * base + digit;
+        if (result > 0xFFFFUL)
+            result = 0x10000UL; // Saturate, reported as out of range
+        digits++;
+        p++;
+    }
+
+    *value = result;
+    return digits > 0;
+}
+
+/* -------------------------------------------------------------------
+   TrackUserCommandParser::parse
+-------------------------------------------------------------------  */
+
+uint8_t TrackUserCommandParser::parse(const char *text, size_t length, TrackUserCommand &command)
+{
+    const char *p = text;
+    const char *end = text + length;
+
+    command.type = USER_NONE;
+    command.argc = 0;
+
+    while (p < end && isBlank(*p))
+        p++;
+    if (p == end)
+        return PARSE_EMPTY;
+
+    const char *word = p;
+    while (p < end && !isBlank(*p))
+        p++;
+    const size_t wordLength = p - word;
+
+    UserCommandSyntax entry;
+    const UserCommandSyntax *syntax = nullptr;
+    for (uint8_t i = 0; i < SYNTAX_COUNT && syntax == nullptr; i++)
+    {
+        memcpy_P(&entry, &SYNTAX[i], sizeof(entry));
+        if (strlen(entry.word) == wordLength && strncmp(entry.word, word, wordLength) == 0)
+            syntax = &entry;
+    }
+    if (syntax == nullptr)
+        return PARSE_UNKNOWN;
+
+    const char *packed = nullptr; // Two digit token that may be of the old form
+    for (;;)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+        if (p == end)
+            break;
+        if (command.argc == syntax->maxArgs)
+            return PARSE_TOO_MANY;
+
+        const char *token = p;
+        uint32_t value;
+        if (!parseNumber(p, end, &value))
+            return PARSE_BAD_NUMBER;
+        if (syntax->packed != 0 && command.argc == syntax->packed && p - token == 2)
+            packed = token; // Two decimal digits; range checked below, once the form is known
+        else if (value > syntax->limits[command.argc])
+            return PARSE_RANGE;
+        command.args[command.argc++] = value;
+    }
+
+    if (packed != nullptr)
+    {
+        // With room for one more argument, the token is the old form:
+        // one digit each for the packed argument and the next
+        const uint8_t i = syntax->packed;
+        if (command.argc < syntax->maxArgs)
+        {
+            for (uint8_t j = command.argc; j > i + 1; j--)
+                command.args[j] = command.args[j - 1];
+            command.args[i] = packed[0] - '0';
+            command.args[i + 1] = packed[1] - '0';
+            command.argc++;
+            if (command.args[i + 1] > syntax->limits[i + 1])
+                return PARSE_RANGE;
+        }
+        if (command.args[i] > syntax->limits[i])
+            return PARSE_RANGE;
+    }
+
+    if (command.argc < syntax->minArgs)
+        return PARSE_MISSING_ARG;
+
+    for (uint8_t i = command.argc; i < 4; i++)
+        command.args[i] = 0;
+
+    command.type = syntax->type;
+    return PARSE_OK;
+}
+
+/* -------------------------------------------------------------------
+   TrackUserCommandParser::errorText
+-------------------------------------------------------------------  */
+
+const __FlashStringHelper *TrackUserCommandParser::errorText(uint8_t error)
+{
+    switch (error)
+    {
+    case PARSE_OK:
+        return F("ok");
+    case PARSE_EMPTY:
+        return F("empty command");
+    case PARSE_UNKNOWN:
+        return F("unknown command");
+    case PARSE_MISSING_ARG:
+        return F("missing argument");
+    case PARSE_TOO_MANY:
+        return F("too many arguments");
+    case PARSE_BAD_NUMBER:
+        return F("bad number");
+    case PARSE_RANGE:
+        return F("argument out of range");
+    case PARSE_QUEUE_FULL:
+        return F("command queue full");
+    default:
+        return F("unknown error");
+    }
+}
@@ -0,0 +1,94 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef TRACKUSERCOMMAND_H
+ #define TRACKUSERCOMMAND_H
+
+ #include <Arduino.h>
+ #include "Config.h"
+
+ /**
+  * Constants for the commands of the text protocol.
+  */
+ #define USER_NONE       0
+ #define USER_POWER      1 // power <0|1>
+ #define USER_EMERGENCY  2 // emergency <address>
+ #define USER_HALT       3 // halt <address>
+ #define USER_DIRECTION  4 // direction <address> <direction>
+ #define USER_SPEED      5 // speed <address> <speed>
+ #define USER_FUNCTION   6 // function <address> <function> <power>
+ #define USER_ACCESSORY  7 // accessory <address> <position> <power> [time]
+
+ /**
+  * Constants for the results of the text protocol parser.
+  */
+ #define PARSE_OK           0
+ #define PARSE_EMPTY        1 // Nothing but whitespace
+ #define PARSE_UNKNOWN      2 // Unknown command word
+ #define PARSE_MISSING_ARG  3 // Too few arguments
+ #define PARSE_TOO_MANY     4 // Too many arguments
+ #define PARSE_BAD_NUMBER   5 // Argument is not a number
+ #define PARSE_RANGE        6 // Argument out of range
+ #define PARSE_QUEUE_FULL   7 // Parsed fine, but no room left in the queue
+
+ // ===================================================================
+ // === TrackUserCommand ==============================================
+ // ===================================================================
+
+ /**
+  * One parsed command of the text protocol used on the serial and
+  * TCP ports. Arguments are stored in the order they are written.
+  */
+ struct TrackUserCommand
+ {
+   uint8_t type;
+   uint8_t argc;
+   uint16_t args[4];
+ };
+
+ // ===================================================================
+ // === TrackUserCommandParser ========================================
+ // ===================================================================
+
+ /**
+  * Tokenizes the text protocol without any dynamic memory. A line
+  * holds one or more commands separated by ';', each made of a
+  * command word and whitespace separated numbers, decimal or
+  * hexadecimal with a 0x prefix, for instance:
+  *
+  * power 1; speed 0x4007 500; function 16391 0 1
+  */
+ class TrackUserCommandParser
+ {
+ public:
+   /**
+    * Parses a single command from text[0..length). Returns one of
+    * the PARSE_* constants, PARSE_OK meaning 'command' is valid.
+    */
+   static uint8_t parse(const char *text, size_t length, TrackUserCommand &command);
+
+   /**
+    * Returns a short human readable text for a PARSE_* constant. The
+    * text stays in flash on AVR; print it with Print::print().
+    */
+   static const __FlashStringHelper *errorText(uint8_t error);
+
+ private:
+   static bool parseNumber(const char *&p, const char *end, uint32_t *value);
+ };
+
+ #endif // TRACKUSERCOMMAND_H
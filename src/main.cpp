@@ -1,8 +1,21 @@
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackLocoTable.h"
+#include "TrackTelemetry.h"
+#include "TrackSnapshot.h"
+#include "TrackAccessoryTable.h"
+#include "TrackConfig.h"
+#include "TrackLayout.h"
+
+#if defined ARDUINO_ARCH_ESP32
+
+/*
+   ESP32: web server for the pages in data/.
+*/
+
 #include <WiFi.h>
 #include <WebServer.h>
 #include <SPIFFS.h>
-#include "Config.h"
-#include "TrackController.h"
 #include <ACAN_ESP32.h>
 
 bool powerState = false; // Variable globale pour suivre l'état de l'alimentation
@@ -11,7 +24,15 @@ const bool DEBUG = true;
 byte cBuffer[13];
 byte sBuffer[13];
 
-TrackController ctrl(0xDF24, DEBUG);
+TrackController ctrl(0xDF24, DEBUG, 1000);
+TrackLocoTable locos(ctrl);
+TrackTelemetry telemetry(ctrl, 0, 500);
+TrackAccessoryTable accessories(ctrl);
+TrackStorageNVS storage;
+TrackSnapshot snapshot(ctrl, storage, locos);
+TrackSupervisor supervisor;
+TrackLayout layout(ctrl);
+TrackConfig config(ctrl);
 
 const char *ssid = "**********";
 const char *password = "**********";
@@ -138,6 +159,11 @@ void handleSetPower()
         server.send(200, "text/plain", "Error power function");
 }
 
+void handleGetPower()
+{
+    server.send(200, "text/plain", powerState ? "true" : "false");
+}
+
 void handleSetStop()
 {
     if (server.hasArg("address"))
@@ -219,6 +245,136 @@ void handleSetFunction()
         server.send(400, "text/plain", "Function parameter missing");
 }
 
+void handleSetFunctions()
+{
+    if (server.hasArg("address") && server.hasArg("mask") && server.hasArg("values"))
+    {
+        uint16_t address = server.arg("address").toInt();
+        uint32_t mask = strtoul(server.arg("mask").c_str(), nullptr, 0);
+        uint32_t values = strtoul(server.arg("values").c_str(), nullptr, 0);
+        uint8_t sent = locos.setFunctions(address, mask, values);
+        server.send(200, "text/plain", String(sent));
+    }
+    else
+        server.send(400, "text/plain", "Functions parameter missing");
+}
+
+void handleGetFunctions()
+{
+    if (server.hasArg("address"))
+    {
+        uint16_t address = server.arg("address").toInt();
+        uint32_t functions = 0;
+        uint32_t known = 0;
+        locos.getFunctions(address, &functions, &known);
+        char json[64];
+        snprintf(json, sizeof(json), "{\"address\":%u,\"functions\":%lu,\"known\":%lu}",
+                 address, (unsigned long)functions, (unsigned long)known);
+        server.send(200, "application/json", json);
+    }
+    else
+        server.send(400, "text/plain", "Address parameter missing");
+}
+
+void handleGetTelemetry()
+{
+    // Served from the readings kept by the poller, never waits for the bus
+    String json = "[";
+    for (uint8_t channel = 1; channel <= TRACK_TELEMETRY_CHANNELS; channel++)
+    {
+        TrackTelemetryStats stats;
+        if (!telemetry.getStats(channel, stats))
+            continue;
+        char item[160];
+        snprintf(item, sizeof(item),
+                 "%s{\"channel\":%u,\"unit\":\"%s\",\"latest\":%ld,\"min\":%ld,\"max\":%ld,\"avg\":%ld,\"count\":%u,\"alarm\":%s}",
+                 json.length() > 1 ? "," : "", channel, telemetry.getUnit(channel), (long)stats.latest,
+                 (long)stats.minimum, (long)stats.maximum, (long)stats.average, stats.count,
+                 telemetry.isAlarm(channel) ? "true" : "false");
+        json += item;
+    }
+    json += "]";
+    server.send(200, "application/json", json);
+}
+
+void handleGetBus()
+{
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"state\":%u,\"txErrors\":%u,\"rxErrors\":%u,\"busOffs\":%lu,\"lastDowntime\":%lu,\"maxDowntime\":%lu,\"dropped\":%lu}",
+             supervisor.getState(), supervisor.getTransmitErrors(), supervisor.getReceiveErrors(),
+             (unsigned long)supervisor.getBusOffs(), (unsigned long)supervisor.getLastDowntime(),
+             (unsigned long)supervisor.getMaxDowntime(), (unsigned long)supervisor.getDropped());
+    server.send(200, "application/json", json);
+}
+
+void handleGetAccessories()
+{
+    // Accessories changed after 'since', 64 at a time: call again with 'cursor' until it is 0
+    const uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 0) : 0;
+    uint16_t cursor = server.hasArg("cursor") ? server.arg("cursor").toInt() : 0;
+    TrackAccessoryState states[64];
+    const uint32_t version = accessories.getVersion();
+    const uint8_t count = accessories.getChanges(since, cursor, states, 64);
+
+    String json = "{\"version\":" + String((unsigned long)version) + ",\"cursor\":" + String(cursor) + ",\"accessories\":[";
+    for (uint8_t i = 0; i < count; i++)
+    {
+        char item[24];
+        snprintf(item, sizeof(item), "%s[%u,%u,%u]", i ? "," : "", states[i].address, states[i].position, states[i].power);
+        json += item;
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+}
+
+void handleGetLocos()
+{
+    // The locos of the layout configuration, for the buttons of the page
+    String json = "{\"locos\":[";
+    for (uint8_t i = 0; i < config.getLocoCount(); i++)
+    {
+        const TrackConfig::Entry &loco = config.getLoco(i);
+        json += i ? ",[" : "[";
+        json += String(loco.address) + ",\"";
+        for (const char *c = loco.name; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+                json += '\\';
+            json += *c;
+        }
+        json += "\"]";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+}
+
+void handleGetBlocks()
+{
+    // Occupancy of the blocks of the layout configuration, from its feedback contacts
+    String json = "{\"blocks\":[";
+    for (uint8_t i = 0; i < layout.getBlockCount(); i++)
+    {
+        json += i ? "," : "";
+        json += layout.isOccupied(i) ? "true" : "false";
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+}
+
+bool loadConfig(const char *path)
+{
+    // Read in one go and checked as a whole, there is no text to parse
+    File file = SPIFFS.open(path, "r");
+    if (!file)
+        return false;
+    uint8_t table[TrackConfig::MAX_SIZE];
+    const size_t size = file.size();
+    const bool read = size <= sizeof(table) && file.read(table, size) == size;
+    file.close();
+    return read && config.load(table, size);
+}
+
 void handleNotFound()
 {
     server.send(404, "text/plain", "Not found");
@@ -254,19 +410,96 @@ void setup()
     server.on("/favicon.ico", handleFavinco);
 
     server.on("/setPower", HTTP_POST, handleSetPower);
+    server.on("/getPower", HTTP_GET, handleGetPower);
     server.on("/setStop", HTTP_POST, handleSetStop);
     server.on("/setSystemHalt", HTTP_POST, handleSetSystemHalt);
     server.on("/setDirection", HTTP_POST, handleSetDirection);
     server.on("/setSpeed", HTTP_POST, handleSetSpeed);
     server.on("/setAddress", HTTP_POST, handleSetAddress);
     server.on("/setFunction", HTTP_POST, handleSetFunction);
+    server.on("/setFunctions", HTTP_POST, handleSetFunctions);
+    server.on("/getFunctions", HTTP_GET, handleGetFunctions);
+    server.on("/getTelemetry", HTTP_GET, handleGetTelemetry);
+    server.on("/getAccessories", HTTP_GET, handleGetAccessories);
+    server.on("/getBus", HTTP_GET, handleGetBus);
+    server.on("/getLocos", HTTP_GET, handleGetLocos);
+    server.on("/getBlocks", HTTP_GET, handleGetBlocks);
     server.onNotFound(handleNotFound);
 
     server.begin();
+    snapshot.setAccessories(&accessories);
+    ctrl.setProxy(&locos, &accessories); // Known state is read locally
+    ctrl.setSupervisor(&supervisor);
+    layout.setAccessories(&accessories); // Routes leave out turnouts already set
+    config.setLocos(&locos);
+    config.setLayout(&layout);
+    if (!loadConfig("/config.bin")) // Else the settings in this file stay
+        Serial.print("No valid layout configuration\n");
+    snapshot.restore(); // Before begin(), so the saved state is back at once
+    powerState = snapshot.getPower();
     ctrl.begin();
 }
 
 void loop()
 {
     server.handleClient();
-}
\ No newline at end of file
+    ctrl.update();
+    telemetry.update();
+    snapshot.update();
+}
+
+#else
+
+/*
+   AVR: text commands on the serial port, see
+   TrackController::queueUserCommands(). This is what the uno,
+   uno_lean and megaatmega2560 environments build.
+*/
+
+TrackController ctrl(0xDF24, false, 500);
+TrackLocoTable locos(ctrl);
+TrackStorageEEPROM storage;
+TrackSnapshot snapshot(ctrl, storage, locos);
+
+char line[64]; // Line being received, without dynamic memory
+uint8_t length = 0;
+bool tooLong = false; // Line overflowed, discarded up to its end
+
+void setup()
+{
+    Serial.begin(115200);
+    ctrl.setProxy(&locos, nullptr);
+    snapshot.restore();
+    ctrl.begin();
+}
+
+void loop()
+{
+    while (Serial.available())
+    {
+        char c = Serial.read();
+        if (c == '\r')
+            continue;
+        if (c == '\n')
+        {
+            if (tooLong)
+                Serial.println(F("!!! Line too long, ignored"));
+            else
+            {
+                line[length] = '\0';
+                ctrl.queueUserCommands(line, &Serial);
+            }
+            length = 0;
+            tooLong = false;
+        }
+        else if (length < sizeof(line) - 1)
+            line[length++] = c;
+        else
+            tooLong = true; // Never run the start of a longer command
+    }
+
+    ctrl.update();
+    snapshot.update();
+}
+
+#endif
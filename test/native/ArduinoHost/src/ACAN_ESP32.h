@@ -0,0 +1,87 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef ACAN_ESP32_H
+ #define ACAN_ESP32_H
+
+ #include <Arduino.h>
+
+ /*
+    The CAN driver of the ESP32 with no bus behind it: frames sent are
+    accepted and dropped, nothing is ever received. Tests drive the
+    controller with loopback and TrackSimulator instead.
+ */
+
+ typedef int gpio_num_t;
+
+ class CANMessage
+ {
+ public:
+   uint32_t id = 0;
+   bool ext = false;
+   bool rtr = false;
+   uint8_t idx = 0;
+   uint8_t len = 0;
+   union
+   {
+     uint64_t data64;
+     uint32_t data32[2];
+     uint16_t data16[4];
+     uint8_t data[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+   };
+ };
+
+ class ACAN_ESP32_Settings
+ {
+ public:
+   enum CANMode
+   {
+     NormalMode,
+     LoopBackMode,
+     ListenOnlyMode
+   };
+
+   gpio_num_t mRxPin = 4;
+   gpio_num_t mTxPin = 5;
+   CANMode mRequestedCANMode = NormalMode;
+   uint8_t mBitRatePrescaler = 16;
+   bool mTripleSampling = true;
+   uint16_t mDriverReceiveBufferSize = 32;
+   uint16_t mDriverTransmitBufferSize = 16;
+
+   ACAN_ESP32_Settings(uint32_t bitRate) : mBitRate(bitRate) {}
+
+   uint32_t actualBitRate() const { return mBitRate; }
+   bool exactBitRate() const { return true; }
+   uint32_t samplePointFromBitStart() const { return 75; }
+
+ private:
+   uint32_t mBitRate;
+ };
+
+ class ACAN_ESP32
+ {
+ public:
+   static ACAN_ESP32 can;
+
+   uint32_t begin(const ACAN_ESP32_Settings &) { return 0; }
+   bool tryToSend(const CANMessage &) { return true; }
+   bool receive(CANMessage &) { return false; }
+   bool available() const { return false; }
+ };
+
+ #endif // ACAN_ESP32_H
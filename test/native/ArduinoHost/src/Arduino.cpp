@@ -0,0 +1,189 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include <Arduino.h>
+#include <time.h>
+
+HardwareSerial Serial;
+
+/* -------------------------------------------------------------------
+   Time
+-------------------------------------------------------------------  */
+
+static uint64_t elapsed()
+{
+    static timespec origin;
+    timespec now;
+    if (origin.tv_sec == 0 && origin.tv_nsec == 0)
+        clock_gettime(CLOCK_MONOTONIC, &origin);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - origin.tv_sec) * 1000000000ULL + now.tv_nsec - origin.tv_nsec;
+}
+
+// Both wrap around at 32 bits, as on the boards
+unsigned long millis()
+{
+    return static_cast<uint32_t>(elapsed() / 1000000);
+}
+
+unsigned long micros()
+{
+    return static_cast<uint32_t>(elapsed() / 1000);
+}
+
+void delay(unsigned long ms)
+{
+    const timespec pause = {static_cast<time_t>(ms / 1000), static_cast<long>(ms % 1000) * 1000000L};
+    nanosleep(&pause, nullptr);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    const timespec pause = {0, static_cast<long>(us) * 1000L};
+    nanosleep(&pause, nullptr);
+}
+
+void yield()
+{
+}
+
+/* -------------------------------------------------------------------
+   Random numbers
+-------------------------------------------------------------------  */
+
+long random(long max)
+{
+    return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max)
+{
+    return max > min ? min + rand() % (max - min) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+    srand(seed);
+}
+
+/* -------------------------------------------------------------------
+   String
+-------------------------------------------------------------------  */
+
+static std::string format(unsigned long value, int base, bool negative)
+{
+    char digits[34];
+    char *p = digits + sizeof(digits);
+    *--p = '\0';
+    do
+    {
+        *--p = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    if (negative)
+        *--p = '-';
+    return p;
+}
+
+String::String(int value, int base) : String(static_cast<long>(value), base) {}
+String::String(unsigned int value, int base) : String(static_cast<unsigned long>(value), base) {}
+
+String::String(long value, int base)
+    : mText(base == DEC && value < 0 ? format(-static_cast<unsigned long>(value), base, true) : format(value, base, false))
+{
+}
+
+String::String(unsigned long value, int base) : mText(format(value, base, false)) {}
+
+String String::substring(unsigned int from) const
+{
+    return from < mText.size() ? String(mText.substr(from)) : String();
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    return from < mText.size() && from < to ? String(mText.substr(from, to - from)) : String();
+}
+
+/* -------------------------------------------------------------------
+   Print
+-------------------------------------------------------------------  */
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (size--)
+        written += write(*buffer++);
+    return written;
+}
+
+size_t Print::printNumber(unsigned long value, int base)
+{
+    return print(String(value, base));
+}
+
+size_t Print::print(long value, int base)
+{
+    return print(String(value, base));
+}
+
+size_t Print::print(double value, int digits)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return print(text);
+}
+
+/* -------------------------------------------------------------------
+   Stream
+-------------------------------------------------------------------  */
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+    size_t count = 0;
+    int c;
+    while (count < length && (c = read()) >= 0)
+        buffer[count++] = c;
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t count = 0;
+    int c;
+    while (count < length && (c = read()) >= 0 && c != terminator)
+        buffer[count++] = c;
+    return count;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String text;
+    int c;
+    while ((c = read()) >= 0 && c != terminator)
+        text += static_cast<char>(c);
+    return text;
+}
+
+/* -------------------------------------------------------------------
+   HardwareSerial
+-------------------------------------------------------------------  */
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef ARDUINO_H
+ #define ARDUINO_H
+
+ // ===================================================================
+ // === ArduinoHost ===================================================
+ // ===================================================================
+
+ /*
+    The parts of the Arduino core the library uses, on top of the C
+    and C++ libraries of a PC, for the native test environment. Time
+    comes from the monotonic clock, so timings are real; delay()
+    sleeps. Serial writes to stdout and never has input.
+ */
+
+ #include <stdint.h>
+ #include <stddef.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <string>
+
+ typedef uint8_t byte;
+ typedef bool boolean;
+
+ #define HEX 16
+ #define DEC 10
+
+ #define PROGMEM
+ #define PSTR(s) (s)
+ #define PGM_P const char *
+ #define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+ #define memcpy_P memcpy
+ #define strlen_P strlen
+ #define strncmp_P strncmp
+ #define pgm_read_byte(p) (*reinterpret_cast<const uint8_t *>(p))
+ #define pgm_read_word(p) (*reinterpret_cast<const uint16_t *>(p))
+
+ class __FlashStringHelper;
+
+ unsigned long millis();
+ unsigned long micros();
+ void delay(unsigned long ms);
+ void delayMicroseconds(unsigned int us);
+ void yield();
+ long random(long max);
+ long random(long min, long max);
+ void randomSeed(unsigned long seed);
+
+ // Macros like the Arduino cores', so names that clash with them fail here too
+ #define bit(b) (1UL << (b))
+ #define bitRead(value, b) (((value) >> (b)) & 0x01)
+ #define bitSet(value, b) ((value) |= (1UL << (b)))
+ #define bitClear(value, b) ((value) &= ~(1UL << (b)))
+ #define bitWrite(value, b, v) ((v) ? bitSet(value, b) : bitClear(value, b))
+
+ inline uint8_t highByte(uint16_t w) { return w >> 8; }
+ inline uint8_t lowByte(uint16_t w) { return w & 0xFF; }
+
+ template <class T> T min(T a, T b) { return a < b ? a : b; }
+ template <class T> T max(T a, T b) { return a > b ? a : b; }
+ template <class T, class L, class H> T constrain(T x, L low, H high) { return x < low ? low : (x > high ? high : x); }
+
+ // ===================================================================
+ // === String ========================================================
+ // ===================================================================
+
+ class String
+ {
+ private:
+   std::string mText;
+
+ public:
+   String() {}
+   String(const char *text) : mText(text) {}
+   String(const std::string &text) : mText(text) {}
+   String(char c) : mText(1, c) {}
+   String(int value, int base = DEC);
+   String(unsigned int value, int base = DEC);
+   String(long value, int base = DEC);
+   String(unsigned long value, int base = DEC);
+
+   unsigned int length() const { return mText.size(); }
+   const char *c_str() const { return mText.c_str(); }
+   char charAt(unsigned int i) const { return i < mText.size() ? mText[i] : 0; }
+   char operator[](unsigned int i) const { return charAt(i); }
+   bool startsWith(const char *prefix) const { return mText.compare(0, strlen(prefix), prefix) == 0; }
+   String substring(unsigned int from) const;
+   String substring(unsigned int from, unsigned int to) const;
+   long toInt() const { return atol(mText.c_str()); }
+   void reserve(unsigned int size) { mText.reserve(size); }
+
+   String &operator+=(const String &text) { mText += text.mText; return *this; }
+   String &operator+=(const char *text) { mText += text; return *this; }
+   String &operator+=(char c) { mText += c; return *this; }
+   bool operator==(const String &text) const { return mText == text.mText; }
+   bool operator==(const char *text) const { return mText == text; }
+   bool operator!=(const char *text) const { return mText != text; }
+
+   friend String operator+(const String &a, const String &b) { return String(a.mText + b.mText); }
+ };
+
+ // ===================================================================
+ // === Print / Stream ================================================
+ // ===================================================================
+
+ class Print;
+
+ class Printable
+ {
+ public:
+   virtual ~Printable() {}
+   virtual size_t printTo(Print &p) const = 0;
+ };
+
+ class Print
+ {
+ private:
+   size_t printNumber(unsigned long value, int base);
+
+ public:
+   virtual ~Print() {}
+   virtual size_t write(uint8_t c) = 0;
+   virtual size_t write(const uint8_t *buffer, size_t size);
+   virtual int availableForWrite() { return 0; }
+   virtual void flush() {}
+
+   size_t write(const char *text) { return write(reinterpret_cast<const uint8_t *>(text), strlen(text)); }
+
+   size_t print(const char *text) { return write(text); }
+   size_t print(const __FlashStringHelper *text) { return write(reinterpret_cast<const char *>(text)); }
+   size_t print(const String &text) { return write(text.c_str()); }
+   size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+   size_t print(unsigned char value, int base = DEC) { return printNumber(value, base); }
+   size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+   size_t print(unsigned int value, int base = DEC) { return printNumber(value, base); }
+   size_t print(long value, int base = DEC);
+   size_t print(unsigned long value, int base = DEC) { return printNumber(value, base); }
+   size_t print(long long value, int base = DEC) { return print(static_cast<long>(value), base); }
+   size_t print(unsigned long long value, int base = DEC) { return printNumber(value, base); }
+   size_t print(double value, int digits = 2);
+   size_t print(const Printable &item) { return item.printTo(*this); }
+
+   size_t println() { return write("\r\n"); }
+   template <class T> size_t println(const T &value) { return print(value) + println(); }
+   template <class T> size_t println(const T &value, int format) { return print(value, format) + println(); }
+ };
+
+ class Stream : public Print
+ {
+ public:
+   virtual int available() = 0;
+   virtual int read() = 0;
+   virtual int peek() = 0;
+
+   size_t readBytes(uint8_t *buffer, size_t length);
+   size_t readBytes(char *buffer, size_t length) { return readBytes(reinterpret_cast<uint8_t *>(buffer), length); }
+   size_t readBytesUntil(char terminator, char *buffer, size_t length);
+   String readStringUntil(char terminator);
+ };
+
+ class HardwareSerial : public Stream
+ {
+ public:
+   void begin(unsigned long) {}
+   size_t write(uint8_t c) override;
+   using Print::write;
+   int availableForWrite() override { return 64; }
+   int available() override { return 0; }
+   int read() override { return -1; }
+   int peek() override { return -1; }
+   operator bool() const { return true; }
+ };
+
+ extern HardwareSerial Serial;
+
+ #endif // ARDUINO_H
@@ -0,0 +1,50 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+#include <ACAN_ESP32.h>
+#include <Preferences.h>
+#include <soc/soc.h>
+
+ACAN_ESP32 ACAN_ESP32::can;
+uint32_t hostTwaiRegisters[32];
+
+/* -------------------------------------------------------------------
+   Preferences
+-------------------------------------------------------------------  */
+
+bool Preferences::clear()
+{
+    mValues.clear();
+    return true;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t length)
+{
+    const std::map<std::string, std::vector<uint8_t>>::const_iterator value = mValues.find(key);
+    if (value == mValues.end())
+        return 0;
+    const size_t count = value->second.size() < length ? value->second.size() : length;
+    memcpy(buffer, value->second.data(), count);
+    return count;
+}
+
+size_t Preferences::putBytes(const char *key, const void *buffer, size_t length)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(buffer);
+    mValues[key].assign(bytes, bytes + length);
+    return length;
+}
@@ -0,0 +1,42 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef PREFERENCES_H
+ #define PREFERENCES_H
+
+ #include <Arduino.h>
+ #include <map>
+ #include <vector>
+
+ /*
+    The NVS key-value store of the ESP32, kept in memory: it starts
+    empty with every run.
+ */
+ class Preferences
+ {
+ private:
+   std::map<std::string, std::vector<uint8_t>> mValues;
+
+ public:
+   bool begin(const char *, bool = false) { return true; }
+   void end() {}
+   bool clear();
+   size_t getBytes(const char *key, void *buffer, size_t length);
+   size_t putBytes(const char *key, const void *buffer, size_t length);
+ };
+
+ #endif // PREFERENCES_H
@@ -0,0 +1,35 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+ #ifndef SOC_SOC_H
+ #define SOC_SOC_H
+
+ #include <stdint.h>
+
+ /*
+    The TWAI (CAN) registers of the ESP32 as plain memory, all zero:
+    the controller is error active with no errors counted.
+ */
+
+ extern uint32_t hostTwaiRegisters[32];
+
+ #define DR_REG_TWAI_BASE 0x00
+ #define REG_READ(address) (hostTwaiRegisters[(address) / 4])
+ #define REG_WRITE(address, value) (hostTwaiRegisters[(address) / 4] = (value))
+ #define REG_CLR_BIT(address, bits) (hostTwaiRegisters[(address) / 4] &= ~(bits))
+
+ #endif // SOC_SOC_H
@@ -0,0 +1,172 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackAutomation against a controller whose requests are never
+   answered: update() must not wait for answers, and the accessory
+   must be switched off by its sequence after the pulse, or when the
+   sequence is stopped during it.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackAutomation.h"
+
+static const uint16_t LOCO = ADDR_MFX + 7;
+static const uint16_t TURNOUT = ADDR_ACC_MM2 + 1;
+static const uint16_t TIMEOUT = 100; // ms, what a blocking request would wait
+
+static TrackController ctrl(0xDF24, false, TIMEOUT, true);
+static TrackAutomation automation(ctrl);
+
+/* -------------------------------------------------------------------
+   Sent
+
+   Remembers the frames sent and when.
+-------------------------------------------------------------------  */
+
+class Sent : public TrackListener
+{
+public:
+    TrackMessage messages[16];
+    uint32_t times[16];
+    uint8_t count = 0;
+
+    void onMessage(const TrackMessage &message, bool outgoing) override
+    {
+        if (outgoing && count < 16)
+        {
+            messages[count] = message;
+            times[count++] = millis();
+        }
+    }
+};
+
+static Sent sent;
+
+static const TrackStep SEQUENCE[] = {
+    STEP_SPEED(400),
+    STEP_ACCESSORY(TURNOUT, ACC_ROUND),
+    STEP_WAIT_MS(50),
+    STEP_FUNCTION(0, 1),
+    STEP_STOP(),
+    STEP_END()};
+
+static const TrackStep PULSE[] = {
+    STEP_ACCESSORY(TURNOUT, ACC_STRAIGHT),
+    STEP_FUNCTION(0, 1),
+    STEP_END()};
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_update_does_not_block()
+{
+    uint32_t longest = 0;
+
+    TEST_ASSERT_EQUAL(0, automation.start(SEQUENCE, sizeof(SEQUENCE) / sizeof(SEQUENCE[0]), LOCO));
+    const uint32_t start = millis();
+    while (automation.isRunning(0) && millis() - start < 1000)
+    {
+        ctrl.update();
+        const uint32_t before = micros();
+        automation.update();
+        const uint32_t elapsed = micros() - before;
+        if (elapsed > longest)
+            longest = elapsed;
+    }
+
+    TEST_ASSERT_FALSE(automation.isRunning(0));
+    TEST_ASSERT_LESS_THAN(TIMEOUT * 1000UL / 10, longest);
+}
+
+void test_frames_and_pulse()
+{
+    TEST_ASSERT_EQUAL(5, sent.count);
+    TEST_ASSERT_EQUAL(CMD_LOCO_SPEED, sent.messages[0].command);
+    TEST_ASSERT_EQUAL(400, LocoSpeed::speed(sent.messages[0]));
+
+    TEST_ASSERT_EQUAL(CMD_ACCESSORY, sent.messages[1].command);
+    TEST_ASSERT_EQUAL(1, Accessory::power(sent.messages[1]));
+    TEST_ASSERT_EQUAL(CMD_ACCESSORY, sent.messages[2].command);
+    TEST_ASSERT_EQUAL(0, Accessory::power(sent.messages[2]));
+    TEST_ASSERT_EQUAL(ACC_ROUND, Accessory::position(sent.messages[2]));
+    TEST_ASSERT_GREATER_OR_EQUAL(20, sent.times[2] - sent.times[1]);
+
+    // The wait starts once the accessory is off
+    TEST_ASSERT_EQUAL(CMD_LOCO_FUNC, sent.messages[3].command);
+    TEST_ASSERT_GREATER_OR_EQUAL(50, sent.times[3] - sent.times[2]);
+    TEST_ASSERT_EQUAL(CMD_SYSTEM, sent.messages[4].command);
+}
+
+void test_pulse_off_is_its_own_step()
+{
+    sent.count = 0;
+    TEST_ASSERT_EQUAL(0, automation.start(PULSE, sizeof(PULSE) / sizeof(PULSE[0]), LOCO));
+    automation.update();
+    TEST_ASSERT_EQUAL(1, sent.count);
+
+    delay(25); // Longer than the 20 ms pulse
+    automation.update();
+    TEST_ASSERT_EQUAL(2, sent.count);
+    TEST_ASSERT_EQUAL(0, Accessory::power(sent.messages[1]));
+
+    automation.update();
+    TEST_ASSERT_EQUAL(3, sent.count);
+    TEST_ASSERT_EQUAL(CMD_LOCO_FUNC, sent.messages[2].command);
+    automation.update();
+    TEST_ASSERT_FALSE(automation.isRunning(0));
+}
+
+void test_stop_during_pulse_switches_off()
+{
+    sent.count = 0;
+    TEST_ASSERT_EQUAL(0, automation.start(PULSE, sizeof(PULSE) / sizeof(PULSE[0]), LOCO));
+    automation.update();
+    TEST_ASSERT_EQUAL(1, sent.count);
+    TEST_ASSERT_EQUAL(1, Accessory::power(sent.messages[0]));
+
+    automation.stop(0);
+    TEST_ASSERT_FALSE(automation.isRunning(0));
+    TEST_ASSERT_EQUAL(2, sent.count);
+    TEST_ASSERT_EQUAL(CMD_ACCESSORY, sent.messages[1].command);
+    TEST_ASSERT_EQUAL(0, Accessory::power(sent.messages[1]));
+    TEST_ASSERT_EQUAL(ACC_STRAIGHT, Accessory::position(sent.messages[1]));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+    ctrl.addListener(&sent);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_update_does_not_block);
+    RUN_TEST(test_frames_and_pulse);
+    RUN_TEST(test_pulse_off_is_its_own_step);
+    RUN_TEST(test_stop_during_pulse_switches_off);
+    return UNITY_END();
+}
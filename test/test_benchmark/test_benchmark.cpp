@@ -0,0 +1,210 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   The protocol hot paths measured on the PC: nanoseconds and heap
+   allocations per operation, one line each, so a change can be
+   judged by numbers. The hot paths must not allocate; that is the
+   part that fails the suite. Times depend on the machine and are
+   only printed. Run with
+
+     pio test -e native -f test_benchmark -v
+*/
+
+#include <unity.h>
+#include <new>
+#include "Config.h"
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackFrame.h"
+#include "TrackSimulator.h"
+#include "TrackUserCommand.h"
+
+static const uint16_t LOCO = ADDR_MFX + 7;
+static const uint16_t HASH = 0xDF24;
+static const uint16_t TIMEOUT = 50; // ms
+static const uint32_t RUNS = 100000;
+
+static TrackController ctrl(HASH, false, TIMEOUT, true);
+static TrackSimulator gleisbox(ctrl);
+
+static uint32_t allocations = 0;
+static volatile uint32_t sink = 0;
+
+/* -------------------------------------------------------------------
+   Allocation counting
+-------------------------------------------------------------------  */
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/* -------------------------------------------------------------------
+   NullPrint
+
+   Swallows everything, so printing costs no output time.
+-------------------------------------------------------------------  */
+
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+};
+
+static NullPrint nullPrint;
+
+/* -------------------------------------------------------------------
+   measure
+
+   Runs 'body' and prints one line. Returns the allocations per 1000
+   operations.
+-------------------------------------------------------------------  */
+
+template <typename F>
+static uint32_t measure(const char *name, uint32_t runs, F body)
+{
+    body(); // Warm up caches and first-time allocations
+
+    const uint32_t before = allocations;
+    const uint32_t start = micros();
+    for (uint32_t i = 0; i < runs; i++)
+        body();
+    const uint32_t elapsed = micros() - start;
+    const uint32_t allocs = allocations - before;
+
+    printf("%-34s %8lu ns/op %8.2f allocs/op\n", name,
+           static_cast<unsigned long>(static_cast<uint64_t>(elapsed) * 1000 / runs),
+           static_cast<double>(allocs) / runs);
+    return static_cast<uint32_t>(static_cast<uint64_t>(allocs) * 1000 / runs);
+}
+
+static TrackMessage speedMessage()
+{
+    TrackMessage message = LocoSpeed::set(LOCO, 500);
+    message.hash = HASH;
+    return message;
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_print_and_parse()
+{
+    const TrackMessage message = speedMessage();
+    const char *text = "df24   04 6 00 00 40 07 01 f4";
+
+    TEST_ASSERT_EQUAL(0, measure("TrackMessage::printTo", RUNS, [&]()
+                                 { sink += message.printTo(nullPrint); }));
+    TEST_ASSERT_EQUAL(0, measure("TrackMessage::parseFrom", RUNS, [&]()
+                                 { TrackMessage m; sink += m.parseFrom(text); }));
+
+    TrackMessage parsed;
+    TEST_ASSERT_TRUE(parsed.parseFrom(text));
+    TEST_ASSERT_EQUAL(500, LocoSpeed::speed(parsed));
+}
+
+void test_frame_packing()
+{
+    const TrackMessage message = speedMessage();
+    CANMessage frame;
+    TrackFrameView view(frame);
+
+    TEST_ASSERT_EQUAL(0, measure("id packing (sendMessage)", RUNS * 10, [&]()
+                                 { view.fromMessage(message); sink += frame.id; }));
+    TEST_ASSERT_EQUAL(0, measure("frame decoding (receiveMessage)", RUNS * 10, [&]()
+                                 { TrackMessage m; view.toMessage(m); sink += m.command; }));
+
+    TrackMessage decoded;
+    view.toMessage(decoded);
+    TEST_ASSERT_EQUAL(CMD_LOCO_SPEED, decoded.command);
+    TEST_ASSERT_EQUAL(LOCO, TrackCommand::address(decoded));
+}
+
+void test_receive_path()
+{
+    const TrackMessage message = speedMessage();
+
+    TEST_ASSERT_EQUAL(0, measure("receive path (inject + receive)", RUNS, [&]()
+                                 { TrackMessage m = message; ctrl.injectMessage(m); sink += ctrl.receiveMessage(m); }));
+}
+
+void test_command_parser()
+{
+    const char *line = "speed 16391 500";
+    String legacy = line;
+    TrackUserCommand command;
+
+    TEST_ASSERT_EQUAL(0, measure("text command parser", RUNS, [&]()
+                                 { sink += TrackUserCommandParser::parse(line, strlen(line), command); }));
+
+    // For comparison only. On the boards each substring() allocates;
+    // the std::string behind String here keeps short text inline
+    measure("legacy startsWith/substring parse", RUNS, [&]()
+            {
+              if (legacy.startsWith("speed "))
+                sink += legacy.substring(6, 11).toInt() + legacy.substring(12).toInt();
+            });
+}
+
+void test_exchange()
+{
+    const uint32_t answered = gleisbox.getAnswered();
+
+    TEST_ASSERT_EQUAL(0, measure("exchangeMessage (simulated box)", RUNS / 10, [&]()
+                                 { TrackMessage m = LocoSpeed::set(LOCO, 500); sink += ctrl.exchangeMessage(m, m, TIMEOUT); }));
+
+    TEST_ASSERT_EQUAL(RUNS / 10 + 1, gleisbox.getAnswered() - answered);
+    TEST_ASSERT_EQUAL(0, gleisbox.getDropped());
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_print_and_parse);
+    RUN_TEST(test_frame_packing);
+    RUN_TEST(test_receive_path);
+    RUN_TEST(test_command_parser);
+    RUN_TEST(test_exchange);
+    return UNITY_END();
+}
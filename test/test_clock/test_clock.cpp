@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackClock comparisons across the 32 bit wrap. The checks on
+   constant arguments are static_asserts, so broken arithmetic fails
+   the build of this suite; the tests below sweep the wrap at run
+   time and check the host counter.
+*/
+
+#include <unity.h>
+#include "TrackClock.h"
+
+static_assert(TrackClock::reached(5, 0xFFFFFFF0UL), "Deadline before the wrap not reached after it");
+static_assert(!TrackClock::reached(0xFFFFFFF0UL, 5), "Deadline after the wrap reached before it");
+static_assert(TrackClock::before(0xFFFFFFF0UL, 5), "Bad ordering across the wrap");
+static_assert(TrackClock::deadline(0xFFFFFFF0UL, 0x20) == 0x10, "Deadline does not wrap");
+static_assert(TrackClock::reached(100, 100), "Deadline not reached on time");
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_deadline_across_wrap()
+{
+    // Starts just before the wrap, the deadline lies after it
+    for (uint32_t start = 0xFFFFFF00UL; start != 0x100; start++)
+    {
+        const uint32_t deadline = TrackClock::deadline(start, 1000);
+        TEST_ASSERT_FALSE(TrackClock::reached(start, deadline));
+        TEST_ASSERT_FALSE(TrackClock::reached(start + 999, deadline));
+        TEST_ASSERT_TRUE(TrackClock::reached(start + 1000, deadline));
+        TEST_ASSERT_TRUE(TrackClock::reached(start + 1001, deadline));
+    }
+}
+
+void test_before_across_wrap()
+{
+    for (uint32_t a = 0xFFFFFF00UL; a != 0x100; a++)
+    {
+        TEST_ASSERT_TRUE(TrackClock::before(a, a + 1));
+        TEST_ASSERT_FALSE(TrackClock::before(a + 1, a));
+        TEST_ASSERT_FALSE(TrackClock::before(a, a));
+    }
+}
+
+void test_longest_span()
+{
+    // 35 minutes still compare right, whatever the start
+    const uint32_t start = 0xFFFFFFF0UL;
+    const uint32_t end = TrackClock::deadline(start, 35UL * 60 * 1000000);
+    TEST_ASSERT_TRUE(TrackClock::before(start, end));
+    TEST_ASSERT_FALSE(TrackClock::reached(start, end));
+    TEST_ASSERT_TRUE(TrackClock::reached(end, start));
+}
+
+void test_now_moves_forward()
+{
+    const uint32_t start = TrackClock::now();
+    uint32_t last = start;
+    while (!TrackClock::reached(last, TrackClock::deadline(start, 2000)))
+    {
+        const uint32_t now = TrackClock::now();
+        TEST_ASSERT_FALSE(TrackClock::before(now, last));
+        last = now;
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_deadline_across_wrap);
+    RUN_TEST(test_before_across_wrap);
+    RUN_TEST(test_longest_span);
+    RUN_TEST(test_now_moves_forward);
+    return UNITY_END();
+}
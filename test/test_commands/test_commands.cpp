@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   The command builders and decoders of TrackCommand.h, checked
+   against frames from the CS2 protocol documentation. The checks on
+   constant arguments are static_asserts, so a broken encoder fails
+   the build of this suite; the tests below cover what is built at
+   run time.
+*/
+
+#include <unity.h>
+#include "TrackCommand.h"
+#include "TrackFrame.h"
+
+static_assert(TrackCommand::canId(0x00, CMD_LOCO_SPEED, false, 0xDF24) == 0x0008DF24UL, "Bad CAN id packing");
+static_assert(TrackCommand::canId(0x01, CMD_WRITE_CONFIG, true, 0x0300) == 0x02110300UL, "Bad CAN id packing");
+static_assert(TrackCommand::command(0x0009DF24UL) == CMD_LOCO_SPEED, "Bad CAN id decoding");
+static_assert(TrackCommand::response(0x0009DF24UL), "Bad CAN id decoding");
+static_assert(TrackCommand::hash(0x0009DF24UL) == 0xDF24, "Bad CAN id decoding");
+static_assert(TrackCommand::prio(0x02110300UL) == 0x01, "Bad CAN id decoding");
+
+static_assert(LocoSpeed::set(ADDR_MFX + 7, 1000).length == 6, "Bad speed length");
+static_assert(LocoSpeed::set(ADDR_MFX + 7, 1000).data[2] == 0x40, "Bad speed address");
+static_assert(LocoSpeed::set(ADDR_MFX + 7, 1000).data[3] == 0x07, "Bad speed address");
+static_assert(LocoSpeed::speed(LocoSpeed::set(ADDR_MFX + 7, 1000)) == 1000, "Bad speed round trip");
+static_assert(TrackCommand::address(LocoSpeed::get(ADDR_DCC + 3)) == ADDR_DCC + 3, "Bad address round trip");
+static_assert(LocoDirection::set(ADDR_MM2 + 24, DIR_CHANGE).data[4] == DIR_CHANGE, "Bad direction");
+static_assert(LocoFunction::set(ADDR_MFX + 7, 31, 1).data[4] == 31, "Bad function");
+static_assert(LocoFunction::get(ADDR_MFX + 7, 0).length == 5, "Bad function query length");
+static_assert(Accessory::set(ADDR_ACC_MM2 + 1, ACC_STRAIGHT, 1).data[2] == 0x30, "Bad accessory address");
+static_assert(Accessory::set(ADDR_ACC_MM2 + 1, ACC_STRAIGHT, 1).data[3] == 0x00, "Bad accessory address");
+static_assert(LocoConfig::write(ADDR_MFX + 7, 1, 3).prio == 0x01, "Bad write config prio");
+static_assert(SystemCommand::power(true).data[4] == SYS_GO, "Bad system go");
+static_assert(TrackCommand::uid(SystemCommand::status(0x47434711UL, 1)) == 0x47434711UL, "Bad status UID");
+static_assert(SystemCommand::mfxCounter(3).data[6] == 0x03, "Bad MFX counter");
+static_assert(DeviceCommand::wakeUp().data[4] == 0x11, "Bad bootloader wake-up");
+static_assert(FeedbackEvent::contact(FeedbackEvent::make(1, 42, 1)) == 42, "Bad feedback contact");
+static_assert(FeedbackEvent::state(FeedbackEvent::make(1, 42, 1)) == 1, "Bad feedback state");
+static_assert(!TrackCommand::isResponseTo(LocoSpeed::get(ADDR_MFX + 7), LocoSpeed::get(ADDR_MFX + 7)), "Request taken as its own response");
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_address_round_trip()
+{
+    static const uint16_t bases[] = {ADDR_MM2, ADDR_SX1, ADDR_MFX, ADDR_SX2, ADDR_DCC, ADDR_ACC_SX1, ADDR_ACC_MM2, ADDR_ACC_DCC};
+
+    for (uint8_t b = 0; b < sizeof(bases) / sizeof(bases[0]); b++)
+        for (uint16_t n = 0; n < 1024; n++)
+        {
+            const uint16_t address = bases[b] + n;
+            TEST_ASSERT_EQUAL(address, TrackCommand::address(LocoSpeed::get(address)));
+            TEST_ASSERT_EQUAL(address, TrackCommand::address(Accessory::set(address, ACC_ROUND, 1)));
+        }
+}
+
+void test_speed_round_trip()
+{
+    for (uint16_t speed = 0; speed <= 1023; speed++)
+        TEST_ASSERT_EQUAL(speed, LocoSpeed::speed(LocoSpeed::set(ADDR_MFX + 7, speed)));
+}
+
+void test_frame_round_trip()
+{
+    TrackMessage message = LocoFunction::set(ADDR_DCC + 3, 12, 1);
+    message.hash = 0xDF24;
+    message.response = true;
+
+    CANMessage frame;
+    TrackFrameView view(frame);
+    view.fromMessage(message);
+    TEST_ASSERT_EQUAL_HEX32(0x000DDF24UL, frame.id);
+
+    TrackMessage decoded;
+    view.toMessage(decoded);
+    TEST_ASSERT_EQUAL(message.command, decoded.command);
+    TEST_ASSERT_TRUE(decoded.response);
+    TEST_ASSERT_EQUAL(message.length, decoded.length);
+    for (uint8_t i = 0; i < message.length; i++)
+        TEST_ASSERT_EQUAL(message.data[i], decoded.data[i]);
+}
+
+void test_response_matching()
+{
+    const TrackMessage request = LocoSpeed::get(ADDR_MFX + 7);
+
+    TrackMessage response = LocoSpeed::set(ADDR_MFX + 7, 300);
+    response.response = true;
+    TEST_ASSERT_TRUE(TrackCommand::isResponseTo(request, response));
+
+    TrackMessage other = LocoSpeed::set(ADDR_MFX + 8, 300);
+    other.response = true;
+    TEST_ASSERT_FALSE(TrackCommand::isResponseTo(request, other));
+
+    TrackMessage pong = SystemCommand::status(0x47434711UL, 1);
+    pong.command = CMD_PING;
+    pong.response = true;
+    TrackMessage ping;
+    ping.command = CMD_PING;
+    TEST_ASSERT_TRUE(TrackCommand::isResponseTo(ping, pong));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_address_round_trip);
+    RUN_TEST(test_speed_round_trip);
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_response_matching);
+    return UNITY_END();
+}
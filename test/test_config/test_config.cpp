@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackConfig with a table made by tools/layoutconfig.py, longer
+   than 256 bytes: it must load in full, with the layout, and a
+   single changed byte must make it refused.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackLocoTable.h"
+#include "TrackLayout.h"
+#include "TrackConfig.h"
+
+/*
+   python tools/layoutconfig.py test/test_config/layout.json config.bin
+   (359 bytes)
+*/
+static const uint8_t TABLE[] = {
+    0x52, 0x43, 0x01, 0x06, 0x48, 0x00, 0x04, 0xDF, 0x24, 0x01, 0xF4, 0x4C,
+    0x00, 0x70, 0x40, 0x07, 0x42, 0x52, 0x20, 0x38, 0x39, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x08, 0x42, 0x52, 0x20, 0x32, 0x31, 0x32,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x09, 0x56, 0x20, 0x32, 0x30,
+    0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x0A, 0x45, 0x20,
+    0x31, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x0B,
+    0x42, 0x52, 0x20, 0x30, 0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x0C, 0x4B, 0x6F, 0x65, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x18, 0x42, 0x52, 0x20, 0x37, 0x34, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xC0, 0x03, 0x49, 0x43, 0x45, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x41, 0x00, 0xA8, 0x30, 0x00, 0x57,
+    0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30,
+    0x01, 0x57, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x30, 0x02, 0x57, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x30, 0x03, 0x57, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x04, 0x57, 0x35, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x05, 0x57, 0x36, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x06, 0x53,
+    0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30,
+    0x07, 0x53, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x30, 0x08, 0x53, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x30, 0x09, 0x53, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x0A, 0x44, 0x4B, 0x57, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x0B, 0x42, 0x61, 0x68,
+    0x6E, 0x68, 0x6F, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x00, 0x03,
+    0xC0, 0x00, 0x7E, 0x43, 0x00, 0x0A, 0x00, 0x40, 0x07, 0x00, 0x64, 0x00,
+    0x40, 0x08, 0x01, 0x5F, 0x47, 0x00, 0x26, 0x4C, 0x47, 0x01, 0x03, 0x03,
+    0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x01, 0x0A, 0x30, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x05, 0x30, 0x01, 0x00, 0x30, 0x06, 0x01,
+    0x00, 0x02, 0x1E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xDC, 0x5D};
+
+static TrackController ctrl(0xDF24, false, 50, true);
+static TrackLocoTable locos(ctrl);
+static TrackLayout layout(ctrl);
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_long_table_loads()
+{
+    TrackConfig config(ctrl);
+    config.setLocos(&locos);
+    config.setLayout(&layout);
+
+    TEST_ASSERT_TRUE(sizeof(TABLE) > 256);
+    TEST_ASSERT_TRUE(config.load(TABLE, sizeof(TABLE)));
+
+    TEST_ASSERT_EQUAL(8, config.getLocoCount());
+    TEST_ASSERT_EQUAL(12, config.getAccessoryCount());
+    TEST_ASSERT_EQUAL_STRING("BR 89", config.nameOf(0x4007));
+    TEST_ASSERT_EQUAL_STRING("Bahnhof", config.nameOf(0x300B));
+    TEST_ASSERT_EQUAL(126, locos.getSteps(0xC003));
+    TEST_ASSERT_EQUAL(0xDF24, ctrl.getHash());
+
+    TEST_ASSERT_EQUAL(3, layout.getBlockCount());
+    TEST_ASSERT_EQUAL(2, layout.blockOf(3));
+
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 2, route));
+    TEST_ASSERT_EQUAL(15, route.cost);
+    TEST_ASSERT_EQUAL(3, route.length);
+}
+
+void test_corrupt_table_refused()
+{
+    uint8_t copy[sizeof(TABLE)];
+    TrackConfig config(ctrl);
+
+    for (uint16_t i = 4; i < sizeof(TABLE) - 2; i += 50)
+    {
+        memcpy(copy, TABLE, sizeof(TABLE));
+        copy[i] ^= 0x01;
+        TEST_ASSERT_FALSE(config.load(copy, sizeof(copy)));
+    }
+    TEST_ASSERT_EQUAL(0, config.getLocoCount());
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_long_table_loads);
+    RUN_TEST(test_corrupt_table_refused);
+    return UNITY_END();
+}
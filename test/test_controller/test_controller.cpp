@@ -0,0 +1,227 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackController against a simulated Gleisbox on loopback: an
+   exchange takes the response to its own request only, not a late
+   one to an earlier request with the same command. The same holds
+   while a request backs off before it is sent again. And a frame
+   held while the bus is off counts as sent, and must not halt a
+   controller in debug mode.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackSimulator.h"
+#include "TrackRetry.h"
+#include "TrackFrame.h"
+#include "TrackSupervisor.h"
+
+static const uint16_t LOCO_A = ADDR_MFX + 7;
+static const uint16_t LOCO_B = ADDR_MFX + 8;
+
+static TrackController ctrl(0xDF24, false, 50, true);
+static TrackSimulator simulator(ctrl);
+
+/* -------------------------------------------------------------------
+   Late
+
+   A bus where nobody answers, but for one frame that comes in once
+   a given time has passed.
+-------------------------------------------------------------------  */
+
+class Late : public TrackTransport
+{
+public:
+    CANMessage frame;
+    uint32_t releaseAt = 0;
+    bool held = false;
+
+    void hold(const TrackMessage &message, uint32_t at)
+    {
+        TrackFrameView(frame).fromMessage(message);
+        releaseAt = at;
+        held = true;
+    }
+
+    uint32_t begin() override { return 0; }
+    bool tryToSend(const CANMessage &) override { return true; }
+
+    bool receive(CANMessage &out) override
+    {
+        if (!held || (int32_t)(micros() - releaseAt) < 0)
+            return false;
+        out = frame;
+        held = false;
+        return true;
+    }
+};
+
+static Late late;
+static TrackController quiet(late, 0xDF24, false, 10);
+
+/* -------------------------------------------------------------------
+   Faulty
+
+   A bus that went off and only comes back when told to.
+-------------------------------------------------------------------  */
+
+class Faulty : public TrackTransport
+{
+public:
+    bool off = true;
+    uint8_t sent = 0;
+
+    uint32_t begin() override { return 0; }
+    bool recover() override { return true; }
+    uint8_t getState() override { return off ? STATE_BUS_OFF : STATE_ACTIVE; }
+
+    bool tryToSend(const CANMessage &) override
+    {
+        if (off)
+            return false;
+        sent++;
+        return true;
+    }
+
+    bool receive(CANMessage &) override { return false; }
+};
+
+static Faulty faulty;
+static TrackController debugging(faulty, 0xDF24, true, 10);
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_late_response_is_passed_over()
+{
+    TEST_ASSERT_TRUE(ctrl.setLocoSpeed(LOCO_A, 100));
+    TEST_ASSERT_TRUE(ctrl.setLocoSpeed(LOCO_B, 200));
+
+    // The answer to a query for A that had already timed out
+    TrackMessage late = LocoSpeed::set(LOCO_A, 100);
+    late.response = true;
+    TEST_ASSERT_TRUE(ctrl.injectMessage(late));
+
+    uint16_t speed = 0;
+    TEST_ASSERT_TRUE(ctrl.getLocoSpeed(LOCO_B, &speed));
+    TEST_ASSERT_EQUAL(200, speed);
+}
+
+void test_exchange_matches_request()
+{
+    TrackMessage late = LocoSpeed::set(LOCO_A, 100);
+    late.response = true;
+    TEST_ASSERT_TRUE(ctrl.injectMessage(late));
+
+    TrackMessage out = LocoSpeed::get(LOCO_B);
+    TrackMessage in;
+    TEST_ASSERT_TRUE(ctrl.exchangeMessage(out, in, 50));
+    TEST_ASSERT_EQUAL(LOCO_B, (in.data[2] << 8) | in.data[3]);
+}
+
+void test_late_response_during_backoff()
+{
+    TrackRetry retry(2, 20000); // One resend, after 10 to 20 ms
+    quiet.setRetry(&retry);
+
+    // The answer to a query for A, 15 ms late: after the first
+    // attempt for B timed out, while it backs off
+    TrackMessage answer = LocoSpeed::set(LOCO_A, 100);
+    answer.response = true;
+    late.hold(answer, micros() + 15000);
+
+    uint16_t speed = 0;
+    TEST_ASSERT_FALSE(quiet.getLocoSpeed(LOCO_B, &speed));
+    TEST_ASSERT_FALSE(late.held);
+    TEST_ASSERT_EQUAL(0, retry.getRecovered());
+    TEST_ASSERT_EQUAL(1, retry.getRetries());
+    TEST_ASSERT_EQUAL(1, retry.getFailures());
+
+    quiet.setRetry(nullptr);
+}
+
+void test_held_frame_does_not_halt()
+{
+    TrackSupervisor supervisor(5);
+    debugging.setSupervisor(&supervisor);
+
+    TEST_ASSERT_FALSE(debugging.setLocoSpeed(LOCO_A, 300));
+    TEST_ASSERT_TRUE(supervisor.isBusOff());
+    TEST_ASSERT_EQUAL(1, supervisor.getHeld());
+
+    faulty.off = false;
+    delay(10);
+    debugging.update();
+    TEST_ASSERT_EQUAL(0, supervisor.getHeld());
+    TEST_ASSERT_EQUAL(1, faulty.sent);
+
+    debugging.setSupervisor(nullptr);
+}
+
+void test_held_frame_counts_as_sent()
+{
+    TrackSupervisor supervisor(5);
+    debugging.setSupervisor(&supervisor);
+    faulty.off = true;
+    faulty.sent = 0;
+
+    // Held: sent once the bus is back, so a caller must not send it again
+    TrackMessage speed = LocoSpeed::set(LOCO_A, 300);
+    TEST_ASSERT_TRUE(debugging.sendMessage(speed));
+    TEST_ASSERT_TRUE(debugging.forwardMessage(LocoSpeed::set(LOCO_B, 300)));
+    TEST_ASSERT_EQUAL(2, supervisor.getHeld());
+
+    // Dropped: a query nobody waits for any more
+    TrackMessage query = LocoSpeed::get(LOCO_A);
+    TEST_ASSERT_FALSE(debugging.sendMessage(query));
+    TEST_ASSERT_EQUAL(2, supervisor.getHeld());
+
+    faulty.off = false;
+    delay(10);
+    debugging.update();
+    TEST_ASSERT_EQUAL(0, supervisor.getHeld());
+    TEST_ASSERT_EQUAL(2, faulty.sent);
+
+    debugging.setSupervisor(nullptr);
+}
+
+void setUp()
+{
+    ctrl.update(); // Drop what earlier tests left
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+    quiet.begin();
+    debugging.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_late_response_is_passed_over);
+    RUN_TEST(test_exchange_matches_request);
+    RUN_TEST(test_late_response_during_backoff);
+    RUN_TEST(test_held_frame_does_not_halt);
+    RUN_TEST(test_held_frame_counts_as_sent);
+    return UNITY_END();
+}
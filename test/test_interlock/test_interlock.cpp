@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackInterlock against a simulated Gleisbox on loopback, as in the
+   Interlock example: a train driving into a block whose next block
+   is occupied must be stopped, and both the reaction and the
+   confirmation must come within 10 ms.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackSimulator.h"
+#include "TrackInterlock.h"
+#include "TrackClock.h"
+
+static const uint16_t LOCO_1 = ADDR_MFX + 7;
+static const uint16_t LOCO_2 = ADDR_MM2 + 24;
+static const uint16_t S88 = 0x0001;
+static const uint16_t CONTACT_FIRST = 1;
+static const uint16_t CONTACT_MIDDLE = 2;
+static const uint16_t CONTACT_LAST = 3;
+static const uint16_t RUNS = 100;
+static const uint32_t LIMIT = 10000; // us
+
+static TrackController ctrl(0xDF24, false, 50, true);
+static TrackSimulator gleisbox(ctrl);
+
+static void contact(uint16_t number, uint8_t state)
+{
+    ctrl.injectMessage(FeedbackEvent::make(S88, number, state));
+    ctrl.update();
+}
+
+static void print(const char *name, const TrackInterlockStats &stats)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %lu stops, min %lu us, avg %lu us, max %lu us", name,
+             (unsigned long)stats.count, (unsigned long)stats.minimum, (unsigned long)stats.average,
+             (unsigned long)stats.maximum);
+    TEST_MESSAGE(line);
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_stop_latency()
+{
+    TrackInterlock interlock(ctrl);
+    const int8_t last = interlock.addBlock(CONTACT_LAST);
+    const int8_t middle = interlock.addBlock(CONTACT_MIDDLE, last);
+    const int8_t first = interlock.addBlock(CONTACT_FIRST, middle);
+
+    interlock.setLoco(last, LOCO_2);
+    contact(CONTACT_LAST, 1);
+
+    for (uint16_t i = 0; i < RUNS; i++)
+    {
+        interlock.setLoco(first, LOCO_1);
+        interlock.setLoco(middle, 0);
+        contact(CONTACT_FIRST, 1);
+        TEST_ASSERT_TRUE(ctrl.setLocoSpeed(LOCO_1, 400));
+        contact(CONTACT_MIDDLE, 1);
+        TEST_ASSERT_EQUAL(LOCO_1, interlock.getLoco(middle));
+        contact(CONTACT_FIRST, 0);
+        contact(CONTACT_MIDDLE, 0);
+    }
+    contact(CONTACT_LAST, 0);
+
+    TrackInterlockStats reaction, confirmation;
+    TEST_ASSERT_TRUE(interlock.getReaction(reaction));
+    TEST_ASSERT_TRUE(interlock.getConfirmation(confirmation));
+    print("Reaction", reaction);
+    print("Confirmation", confirmation);
+
+    TEST_ASSERT_EQUAL(RUNS, reaction.count);
+    TEST_ASSERT_EQUAL(RUNS, confirmation.count);
+    TEST_ASSERT_TRUE(reaction.maximum < LIMIT);
+    TEST_ASSERT_TRUE(confirmation.maximum < LIMIT);
+    TEST_ASSERT_TRUE(confirmation.minimum >= reaction.minimum);
+}
+
+void test_latency_from_seen()
+{
+    TrackInterlock interlock(ctrl);
+    const int8_t last = interlock.addBlock(CONTACT_LAST);
+    const int8_t middle = interlock.addBlock(CONTACT_MIDDLE, last);
+
+    interlock.setLoco(last, LOCO_2);
+    interlock.setLoco(middle, LOCO_1);
+    interlock.onContact(CONTACT_LAST, 1);
+
+    // Seen 3 ms ago, handed over only now
+    interlock.onContact(CONTACT_MIDDLE, 1, TrackClock::now() - 3000);
+
+    TrackInterlockStats reaction;
+    TEST_ASSERT_TRUE(interlock.getReaction(reaction));
+    TEST_ASSERT_EQUAL(1, reaction.count);
+    TEST_ASSERT_TRUE(reaction.latest >= 3000);
+}
+
+void setUp()
+{
+    ctrl.update();
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_stop_latency);
+    RUN_TEST(test_latency_from_seen);
+    return UNITY_END();
+}
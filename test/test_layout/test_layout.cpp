@@ -0,0 +1,180 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackLayout on a small graph with two ways from block 0 to block
+   4, the cheaper one through block 1:
+
+       0 --10--> 1 --10--> 3 --5--> 4 --1--> 5
+       0 --15--> 2 --10--> 3
+
+   The route must be the cheapest one, list only the accessories not
+   yet in position, come from the cache while occupancy changes off
+   the route, and be searched again when a block on the route gets
+   occupied or a block the search ran into gets free.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackAccessoryTable.h"
+#include "TrackLayout.h"
+
+static const uint16_t T1 = 0x3000;
+static const uint16_t T2 = 0x3001;
+static const uint16_t T3 = 0x3002;
+
+static const uint8_t GRAPH[] = {
+    'L', 'G', TrackLayout::VERSION, 6, 6,
+    0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00, 0x05, 0x00, 0x06,
+    0, 1, 10, 0x30, 0x00, 1, 0x00, 0x00, 0,
+    1, 3, 10, 0x30, 0x01, 0, 0x00, 0x00, 0,
+    0, 2, 15, 0x30, 0x00, 0, 0x00, 0x00, 0,
+    2, 3, 10, 0x00, 0x00, 0, 0x00, 0x00, 0,
+    3, 4, 5, 0x30, 0x02, 1, 0x30, 0x01, 0, // T2 again, listed once
+    4, 5, 1, 0x00, 0x00, 0, 0x00, 0x00, 0};
+
+static TrackController ctrl(0xDF24, false, 50, true);
+static TrackAccessoryTable accessories(ctrl);
+static TrackLayout layout(ctrl);
+
+static void expectBlocks(const TrackRoute &route, uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    TEST_ASSERT_EQUAL(4, route.length);
+    TEST_ASSERT_EQUAL(a, route.blocks[0]);
+    TEST_ASSERT_EQUAL(b, route.blocks[1]);
+    TEST_ASSERT_EQUAL(c, route.blocks[2]);
+    TEST_ASSERT_EQUAL(d, route.blocks[3]);
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_cheapest_route()
+{
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    expectBlocks(route, 0, 1, 3, 4);
+    TEST_ASSERT_EQUAL(25, route.cost);
+
+    TEST_ASSERT_EQUAL(3, route.changeCount);
+    TEST_ASSERT_EQUAL(T1, route.changes[0].address);
+    TEST_ASSERT_EQUAL(1, route.changes[0].position);
+    TEST_ASSERT_EQUAL(T2, route.changes[1].address);
+    TEST_ASSERT_EQUAL(0, route.changes[1].position);
+    TEST_ASSERT_EQUAL(T3, route.changes[2].address);
+    TEST_ASSERT_EQUAL(1, route.changes[2].position);
+}
+
+void test_changes_leave_out_set_accessories()
+{
+    // T3 reported in position, T1 in the wrong one
+    TrackMessage message = Accessory::set(T3, 1, 1);
+    message.response = true;
+    TEST_ASSERT_TRUE(ctrl.injectMessage(message));
+    message = Accessory::set(T1, 0, 1);
+    message.response = true;
+    TEST_ASSERT_TRUE(ctrl.injectMessage(message));
+    ctrl.update();
+
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    TEST_ASSERT_EQUAL(2, route.changeCount);
+    TEST_ASSERT_EQUAL(T1, route.changes[0].address);
+    TEST_ASSERT_EQUAL(T2, route.changes[1].address);
+}
+
+void test_cache_hit_off_route()
+{
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    const uint32_t searches = layout.getSearches();
+    const uint32_t hits = layout.getCacheHits();
+
+    layout.setOccupied(5, true);
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    expectBlocks(route, 0, 1, 3, 4);
+    TEST_ASSERT_EQUAL(searches, layout.getSearches());
+    TEST_ASSERT_EQUAL(hits + 1, layout.getCacheHits());
+}
+
+void test_search_when_route_occupied()
+{
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    const uint32_t searches = layout.getSearches();
+
+    layout.setOccupied(1, true);
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    expectBlocks(route, 0, 2, 3, 4);
+    TEST_ASSERT_EQUAL(30, route.cost);
+    TEST_ASSERT_EQUAL(searches + 1, layout.getSearches());
+}
+
+void test_search_when_touched_block_free()
+{
+    TrackRoute route;
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route)); // Around block 1, cached
+    const uint32_t searches = layout.getSearches();
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    TEST_ASSERT_EQUAL(searches, layout.getSearches());
+
+    layout.setOccupied(1, false);
+    TEST_ASSERT_TRUE(layout.findRoute(0, 4, route));
+    expectBlocks(route, 0, 1, 3, 4);
+    TEST_ASSERT_EQUAL(searches + 1, layout.getSearches());
+}
+
+void test_contact_events()
+{
+    ctrl.injectMessage(FeedbackEvent::make(1, 3, 1));
+    ctrl.update();
+    TEST_ASSERT_TRUE(layout.isOccupied(2));
+
+    TrackRoute route;
+    TEST_ASSERT_FALSE(layout.findRoute(0, 2, route));
+
+    ctrl.injectMessage(FeedbackEvent::make(1, 3, 0));
+    ctrl.update();
+    TEST_ASSERT_TRUE(layout.findRoute(0, 2, route));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+    layout.setAccessories(&accessories);
+    if (!layout.load(GRAPH, sizeof(GRAPH)))
+        return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_cheapest_route);
+    RUN_TEST(test_changes_leave_out_set_accessories);
+    RUN_TEST(test_cache_hit_off_route);
+    RUN_TEST(test_search_when_route_occupied);
+    RUN_TEST(test_search_when_touched_block_free);
+    RUN_TEST(test_contact_events);
+    return UNITY_END();
+}
@@ -0,0 +1,79 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackLoadGenerator on the host, with short steps: a layout within
+   the loco table is tracked in full, a bigger one reports the table
+   as saturated, and the requests are answered in time.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackLoadGenerator.h"
+
+static const uint32_t STEP_MS = 200;
+
+static TrackController ctrl(0xDF24, false, 50, true);
+static TrackLoadGenerator load(ctrl);
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+static void check(uint16_t locos, uint8_t clients)
+{
+    TrackLoadStats stats;
+    load.run(locos, 4 * locos, locos / 2, clients, STEP_MS, stats);
+    TrackLoadGenerator::print(Serial, stats);
+
+    TEST_ASSERT_EQUAL(locos, stats.locos);
+    TEST_ASSERT_TRUE(stats.rate > 0);
+    TEST_ASSERT_TRUE(stats.median <= stats.p99);
+    TEST_ASSERT_TRUE(stats.p99 < 20000);
+    TEST_ASSERT_EQUAL(locos < TRACK_MAX_LOCOS ? locos : TRACK_MAX_LOCOS, stats.tracked);
+}
+
+void test_layout_curve()
+{
+    TrackLoadGenerator::printHeader(Serial);
+    for (uint16_t n = 4; n <= 64; n *= 2)
+        check(n, TRACK_MAX_REQUESTS);
+}
+
+void test_client_curve()
+{
+    for (uint8_t c = 1; c <= TRACK_MAX_REQUESTS; c *= 2)
+        check(8, c);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_layout_curve);
+    RUN_TEST(test_client_curve);
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackLocoTable following the frames of a controller whose bus can
+   be made to refuse frames: the table must only learn what went out,
+   must take stops into account, and must leave out speed frames that
+   do not change the speed step.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackLocoTable.h"
+
+static const uint16_t LOCO = ADDR_MFX + 7;
+
+/* -------------------------------------------------------------------
+   Bus
+
+   Takes frames unless told to refuse them, and counts them.
+-------------------------------------------------------------------  */
+
+class Bus : public TrackTransport
+{
+public:
+    bool refusing = false;
+    uint16_t sent = 0;
+
+    uint32_t begin() override { return 0; }
+    bool receive(CANMessage &) override { return false; }
+
+    bool tryToSend(const CANMessage &) override
+    {
+        if (refusing)
+            return false;
+        sent++;
+        return true;
+    }
+};
+
+static Bus bus;
+static TrackController ctrl(bus, 0xDF24, false, 10);
+static TrackLocoTable locos(ctrl);
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_failed_function_is_sent_again()
+{
+    uint32_t functions, known;
+
+    bus.refusing = true;
+    TEST_ASSERT_EQUAL(0, locos.setFunctions(LOCO, 0x01, 0x01));
+    TEST_ASSERT_FALSE(locos.getFunctions(LOCO, &functions, &known) && (known & 0x01));
+
+    bus.refusing = false;
+    TEST_ASSERT_EQUAL(1, locos.setFunctions(LOCO, 0x01, 0x01));
+    TEST_ASSERT_TRUE(locos.getFunctions(LOCO, &functions, &known));
+    TEST_ASSERT_EQUAL(0x01, known & 0x01);
+    TEST_ASSERT_EQUAL(0x01, functions & 0x01);
+}
+
+void test_failed_speed_is_not_known()
+{
+    uint16_t speed;
+
+    TrackMessage message = LocoSpeed::set(LOCO + 1, 500);
+    bus.refusing = true;
+    TEST_ASSERT_FALSE(ctrl.sendMessage(message));
+    TEST_ASSERT_FALSE(locos.getSpeed(LOCO + 1, &speed));
+    TEST_ASSERT_FALSE(locos.suppressSpeed(LOCO + 1, 500));
+
+    bus.refusing = false;
+    TEST_ASSERT_TRUE(ctrl.sendMessage(message));
+    TEST_ASSERT_TRUE(locos.getSpeed(LOCO + 1, &speed));
+    TEST_ASSERT_EQUAL(500, speed);
+}
+
+void test_emergency_stop_clears_speed()
+{
+    uint16_t speed;
+
+    ctrl.setProxy(&locos, nullptr);
+    TrackMessage message = LocoSpeed::set(LOCO, 600);
+    TEST_ASSERT_TRUE(ctrl.sendMessage(message));
+
+    // As TrackInterlock stops it
+    message = SystemCommand::emergency(LOCO);
+    TEST_ASSERT_TRUE(ctrl.sendMessage(message));
+    TEST_ASSERT_TRUE(locos.getSpeed(LOCO, &speed));
+    TEST_ASSERT_EQUAL(0, speed);
+
+    // Driving on at the old speed is not suppressed
+    const uint16_t sent = bus.sent;
+    ctrl.setLocoSpeed(LOCO, 600);
+    TEST_ASSERT_EQUAL(sent + 1, bus.sent);
+    ctrl.setProxy(nullptr, nullptr);
+}
+
+void test_halt_clears_all_speeds()
+{
+    uint16_t speed;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TrackMessage message = LocoSpeed::set(LOCO + i, 300 + 100 * i);
+        TEST_ASSERT_TRUE(ctrl.sendMessage(message));
+    }
+    TrackMessage halt = SystemCommand::halt(0);
+    TEST_ASSERT_TRUE(ctrl.sendMessage(halt));
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_TRUE(locos.getSpeed(LOCO + i, &speed));
+        TEST_ASSERT_EQUAL(0, speed);
+    }
+}
+
+void test_slider_sweep_frames()
+{
+    // A slider swept over 0..1000 in steps of 5 on an MM2 loco: only
+    // the speeds landing on another of the 14 steps go out
+    const uint16_t mm2 = ADDR_MM2 + 24;
+    ctrl.setProxy(&locos, nullptr);
+
+    const uint16_t sent = bus.sent;
+    for (uint16_t speed = 0; speed <= 1000; speed += 5)
+        ctrl.setLocoSpeed(mm2, speed);
+    ctrl.setProxy(nullptr, nullptr);
+
+    char line[64];
+    snprintf(line, sizeof(line), "201 speeds, %u frames, %u suppressed", bus.sent - sent, locos.getSuppressed(mm2));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(201, bus.sent - sent + locos.getSuppressed(mm2));
+    TEST_ASSERT_EQUAL(17, bus.sent - sent);
+}
+
+void setUp()
+{
+    bus.refusing = false;
+    locos.clear();
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_failed_function_is_sent_again);
+    RUN_TEST(test_failed_speed_is_not_known);
+    RUN_TEST(test_emergency_stop_clears_speed);
+    RUN_TEST(test_halt_clears_all_speeds);
+    RUN_TEST(test_slider_sweep_frames);
+    return UNITY_END();
+}
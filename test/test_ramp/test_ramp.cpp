@@ -0,0 +1,145 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackRamp on a loopback controller: a loco that already runs must
+   ramp from its speed, not from 0, and a tick over all the ramps must
+   stay within its frame budget. Prints what a tick costs on the host.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackLocoTable.h"
+#include "TrackRamp.h"
+
+static const uint16_t LOCO = ADDR_MFX + 7;
+static const uint8_t FRAMES_PER_TICK = 8;
+
+static TrackController ctrl(0xDF24, false, 100, true);
+static TrackLocoTable locos(ctrl);
+
+/* -------------------------------------------------------------------
+   Sent
+
+   Remembers the speeds sent.
+-------------------------------------------------------------------  */
+
+class Sent : public TrackListener
+{
+public:
+    uint16_t speeds[64];
+    uint8_t count = 0;
+
+    void onMessage(const TrackMessage &message, bool outgoing) override
+    {
+        if (outgoing && message.command == CMD_LOCO_SPEED && message.length == 6 && count < 64)
+            speeds[count++] = (message.data[4] << 8) | message.data[5];
+    }
+};
+
+static Sent sent;
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_ramp_starts_from_known_speed()
+{
+    TrackRamp ramp(ctrl, 100, FRAMES_PER_TICK);
+    ramp.setLocos(&locos);
+
+    TrackMessage running = LocoSpeed::set(LOCO, 800);
+    TEST_ASSERT_TRUE(ctrl.sendMessage(running));
+    sent.count = 0;
+
+    TEST_ASSERT_TRUE(ramp.setRate(LOCO, 100, 100));
+    TEST_ASSERT_EQUAL(800, ramp.getSpeed(LOCO));
+    TEST_ASSERT_TRUE(ramp.setTarget(LOCO, 400));
+    ramp.tick();
+
+    TEST_ASSERT_EQUAL(1, sent.count);
+    TEST_ASSERT_TRUE(sent.speeds[0] < 800);
+    TEST_ASSERT_TRUE(sent.speeds[0] >= 780);
+}
+
+void test_set_current()
+{
+    TrackRamp ramp(ctrl, 100, FRAMES_PER_TICK);
+
+    TEST_ASSERT_TRUE(ramp.setCurrent(LOCO + 1, 600));
+    TEST_ASSERT_FALSE(ramp.isRamping(LOCO + 1));
+    sent.count = 0;
+    ramp.tick();
+    TEST_ASSERT_EQUAL(0, sent.count);
+
+    TEST_ASSERT_TRUE(ramp.setTarget(LOCO + 1, 0));
+    ramp.tick();
+    TEST_ASSERT_EQUAL(1, sent.count);
+    TEST_ASSERT_TRUE(sent.speeds[0] > 500);
+}
+
+void test_tick_cost()
+{
+    TrackRamp ramp(ctrl, 100, FRAMES_PER_TICK);
+    uint32_t total = 0, longest = 0;
+    uint16_t ticks = 0;
+
+    for (uint8_t i = 0; i < TRACK_MAX_RAMPS; i++)
+    {
+        TEST_ASSERT_TRUE(ramp.setRate(LOCO + i, 100 + 10 * i, 300));
+        TEST_ASSERT_TRUE(ramp.setTarget(LOCO + i, 600));
+    }
+
+    while (ramp.isRamping(LOCO + TRACK_MAX_RAMPS - 1) && ticks < 1000)
+    {
+        const uint32_t frames = ramp.getFramesSent();
+        ramp.tick();
+        TEST_ASSERT_TRUE(ramp.getFramesSent() - frames <= FRAMES_PER_TICK);
+        total += ramp.getTickMicros();
+        if (ramp.getTickMicros() > longest)
+            longest = ramp.getTickMicros();
+        ticks++;
+    }
+
+    TEST_ASSERT_TRUE(ticks < 1000);
+    char line[96];
+    snprintf(line, sizeof(line), "%u ramps, %u ticks: %lu us per tick, %lu us at most",
+             (unsigned)TRACK_MAX_RAMPS, ticks, (unsigned long)(total / ticks), (unsigned long)longest);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(longest < 10000);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+    ctrl.addListener(&sent);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ramp_starts_from_known_speed);
+    RUN_TEST(test_set_current);
+    RUN_TEST(test_tick_cost);
+    return UNITY_END();
+}
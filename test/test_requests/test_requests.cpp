@@ -0,0 +1,101 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackRequests on a loopback controller, where nothing answers: a
+   request times out, or with a retry policy is sent again after the
+   backoff, even if the policy was dropped in between.
+*/
+
+#include <unity.h>
+#include "TrackController.h"
+#include "TrackCommand.h"
+#include "TrackRequests.h"
+#include "TrackRetry.h"
+
+static const uint16_t LOCO = ADDR_MFX + 7;
+static const uint32_t TIMEOUT = 2000; // us
+
+static TrackController ctrl(0xDF24, false, 100, true);
+
+static void run(TrackRequests &requests, uint8_t handle, uint32_t micro)
+{
+    const uint32_t start = micros();
+    while (requests.getState(handle) != REQUEST_TIMEOUT && micros() - start < micro)
+    {
+        ctrl.update();
+        requests.update();
+    }
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_timeout_without_retry()
+{
+    TrackRequests requests(ctrl);
+    TrackMessage message = LocoSpeed::set(LOCO, 100);
+
+    const uint8_t handle = requests.send(message, TIMEOUT);
+    TEST_ASSERT_NOT_EQUAL(0, handle);
+    run(requests, handle, 10 * TIMEOUT);
+    TEST_ASSERT_EQUAL(REQUEST_TIMEOUT, requests.getState(handle));
+    TEST_ASSERT_EQUAL(1, requests.getTimeouts());
+}
+
+void test_retry_dropped_during_backoff()
+{
+    TrackRequests requests(ctrl);
+    TrackRetry retry(3, TIMEOUT);
+    TrackMessage message = LocoSpeed::set(LOCO, 100);
+
+    requests.setRetry(&retry);
+    const uint8_t handle = requests.send(message, TIMEOUT);
+    TEST_ASSERT_NOT_EQUAL(0, handle);
+
+    const uint32_t start = micros();
+    while (requests.getState(handle) != REQUEST_RETRY && micros() - start < 10 * TIMEOUT)
+    {
+        ctrl.update();
+        requests.update();
+    }
+    TEST_ASSERT_EQUAL(REQUEST_RETRY, requests.getState(handle));
+
+    requests.setRetry(nullptr);
+    run(requests, handle, 20 * TIMEOUT);
+    TEST_ASSERT_EQUAL(REQUEST_TIMEOUT, requests.getState(handle));
+    TEST_ASSERT_EQUAL(0, retry.getRetries());
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    ctrl.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_timeout_without_retry);
+    RUN_TEST(test_retry_dropped_during_backoff);
+    return UNITY_END();
+}
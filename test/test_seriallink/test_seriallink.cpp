@@ -0,0 +1,186 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   The packets of TrackSerialLink: frames with zero bytes anywhere
+   survive the COBS round trip, damaged and overlong packets are
+   refused, and the bytes match those of tools/seriallink.py, the PC
+   side of the link.
+*/
+
+#include <unity.h>
+#include <string.h>
+#include "TrackSerialLink.h"
+
+/* -------------------------------------------------------------------
+   Reference
+
+   Packets made by pack() of tools/seriallink.py for the same frames.
+   The last two have a zero in the high and low byte of their CRC.
+-------------------------------------------------------------------  */
+
+struct Reference
+{
+    uint32_t id;
+    uint8_t length;
+    uint8_t data[8];
+    uint8_t packet[TrackSerialLink::MAX_ENCODED];
+};
+
+static const Reference REFERENCES[] = {
+    {0x0008DF24UL, 6, {0x00, 0x00, 0x40, 0x05, 0x01, 0x2C},
+     {0x01, 0x05, 0x08, 0xDF, 0x24, 0x06, 0x01, 0x05, 0x40, 0x05, 0x01, 0x2C, 0x01, 0x03, 0x22, 0x31, 0x00}},
+    {0x00000000UL, 0, {0},
+     {0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x03, 0x28, 0x0C, 0x00}},
+    {0x0008DF24UL, 6, {0x00, 0x00, 0x40, 0x05, 0x00, 0xB3},
+     {0x01, 0x05, 0x08, 0xDF, 0x24, 0x06, 0x01, 0x03, 0x40, 0x05, 0x02, 0xB3, 0x01, 0x01, 0x02, 0x8D, 0x00}},
+    {0x0008DF24UL, 6, {0x00, 0x00, 0x40, 0x05, 0x01, 0x23},
+     {0x01, 0x05, 0x08, 0xDF, 0x24, 0x06, 0x01, 0x05, 0x40, 0x05, 0x01, 0x23, 0x01, 0x02, 0x0E, 0x01, 0x00}}};
+
+static const uint8_t REFERENCE_COUNT = sizeof(REFERENCES) / sizeof(REFERENCES[0]);
+
+/* -------------------------------------------------------------------
+   Helpers
+-------------------------------------------------------------------  */
+
+static TrackFrame makeFrame(const Reference &reference)
+{
+    TrackFrame frame;
+    frame.clear();
+    frame.setId(reference.id);
+    frame.bytes[4] = reference.length;
+    memcpy(frame.data(), reference.data, 8);
+    return frame;
+}
+
+/* Encodes 'frame', checks the packet is well formed and decodes it. */
+static void roundTrip(const TrackFrame &frame)
+{
+    uint8_t packet[TrackSerialLink::MAX_ENCODED];
+    const uint8_t length = TrackSerialLink::encode(frame, packet);
+
+    TEST_ASSERT_LESS_OR_EQUAL(TrackSerialLink::MAX_ENCODED, length);
+    TEST_ASSERT_EQUAL(0x00, packet[length - 1]);
+    for (uint8_t i = 0; i < length - 1; i++)
+        TEST_ASSERT_NOT_EQUAL(0x00, packet[i]);
+
+    TrackFrame decoded;
+    decoded.clear();
+    TEST_ASSERT_TRUE(TrackSerialLink::decode(packet, length - 1, decoded));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame.bytes, decoded.bytes, TrackFrame::SIZE);
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_same_bytes_as_python_tool()
+{
+    for (uint8_t r = 0; r < REFERENCE_COUNT; r++)
+    {
+        uint8_t packet[TrackSerialLink::MAX_ENCODED];
+        const TrackFrame frame = makeFrame(REFERENCES[r]);
+        TEST_ASSERT_EQUAL(TrackSerialLink::MAX_ENCODED, TrackSerialLink::encode(frame, packet));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(REFERENCES[r].packet, packet, TrackSerialLink::MAX_ENCODED);
+
+        TrackFrame decoded;
+        TEST_ASSERT_TRUE(TrackSerialLink::decode(REFERENCES[r].packet, TrackSerialLink::MAX_ENCODED - 1, decoded));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(frame.bytes, decoded.bytes, TrackFrame::SIZE);
+    }
+}
+
+void test_zero_in_every_position()
+{
+    TrackFrame frame;
+
+    for (uint8_t i = 0; i < TrackFrame::SIZE; i++)
+    {
+        // A single zero, then a single non zero byte among zeros
+        memset(frame.bytes, 0x5A, TrackFrame::SIZE);
+        frame.bytes[i] = 0x00;
+        roundTrip(frame);
+
+        frame.clear();
+        frame.bytes[i] = 0xA5;
+        roundTrip(frame);
+    }
+
+    // No zero at all, then a run of them in the middle
+    memset(frame.bytes, 0xFF, TrackFrame::SIZE);
+    roundTrip(frame);
+    memset(frame.bytes + 3, 0x00, 5);
+    roundTrip(frame);
+}
+
+void test_corrupted_packet_refused()
+{
+    uint8_t packet[TrackSerialLink::MAX_ENCODED];
+    TrackFrame frame;
+
+    // Both CRC bytes, then a data byte
+    const uint8_t damaged[] = {14, 15, 8};
+    for (uint8_t d = 0; d < sizeof(damaged); d++)
+    {
+        memcpy(packet, REFERENCES[0].packet, sizeof(packet));
+        packet[damaged[d]] ^= 0x01;
+        TEST_ASSERT_FALSE(TrackSerialLink::decode(packet, sizeof(packet) - 1, frame));
+    }
+
+    // A code byte pointing past the end
+    memcpy(packet, REFERENCES[0].packet, sizeof(packet));
+    packet[13] = 0x10;
+    TEST_ASSERT_FALSE(TrackSerialLink::decode(packet, sizeof(packet) - 1, frame));
+}
+
+void test_overlong_packet_refused()
+{
+    uint8_t packet[TrackSerialLink::MAX_ENCODED + 1];
+    TrackFrame frame;
+
+    // One byte too many before the CRC, the COBS itself is valid
+    memcpy(packet, REFERENCES[0].packet, 13);
+    packet[13] = 0x04;
+    packet[14] = 0x99;
+    memcpy(packet + 15, REFERENCES[0].packet + 14, 3);
+    TEST_ASSERT_FALSE(TrackSerialLink::decode(packet, sizeof(packet) - 1, frame));
+
+    // A single block longer than any packet
+    packet[0] = sizeof(packet);
+    memset(packet + 1, 0x11, sizeof(packet) - 1);
+    TEST_ASSERT_FALSE(TrackSerialLink::decode(packet, sizeof(packet), frame));
+
+    // And one byte short
+    TEST_ASSERT_FALSE(TrackSerialLink::decode(REFERENCES[0].packet, TrackSerialLink::MAX_ENCODED - 2, frame));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_same_bytes_as_python_tool);
+    RUN_TEST(test_zero_in_every_position);
+    RUN_TEST(test_corrupted_packet_refused);
+    RUN_TEST(test_overlong_packet_refused);
+    return UNITY_END();
+}
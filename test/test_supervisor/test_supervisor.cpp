@@ -0,0 +1,120 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   TrackSupervisor holding frames while the bus is off: a newer frame
+   replaces an older one for the same loco, queries are dropped, and
+   direction toggles are never held, so two of them cannot become one.
+*/
+
+#include <unity.h>
+#include "TrackCommand.h"
+#include "TrackFrame.h"
+#include "TrackSupervisor.h"
+
+static const uint16_t LOCO_A = ADDR_MFX + 7;
+static const uint16_t LOCO_B = ADDR_MFX + 8;
+
+/* -------------------------------------------------------------------
+   Bus
+
+   Takes every frame and remembers them.
+-------------------------------------------------------------------  */
+
+class Bus : public TrackTransport
+{
+public:
+    TrackMessage sent[8];
+    uint8_t count = 0;
+
+    uint32_t begin() override { return 0; }
+    bool receive(CANMessage &) override { return false; }
+
+    bool tryToSend(const CANMessage &frame) override
+    {
+        CANMessage copy = frame;
+        if (count < 8)
+            TrackFrameView(copy).toMessage(sent[count++]);
+        return true;
+    }
+};
+
+static bool hold(TrackSupervisor &supervisor, const TrackMessage &message)
+{
+    CANMessage frame;
+    TrackFrameView(frame).fromMessage(message);
+    return supervisor.hold(frame);
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_newer_frame_replaces_older()
+{
+    TrackSupervisor supervisor;
+    Bus bus;
+
+    TEST_ASSERT_TRUE(hold(supervisor, LocoSpeed::set(LOCO_A, 100)));
+    TEST_ASSERT_TRUE(hold(supervisor, LocoSpeed::set(LOCO_B, 200)));
+    TEST_ASSERT_TRUE(hold(supervisor, LocoSpeed::set(LOCO_A, 300)));
+    TEST_ASSERT_TRUE(hold(supervisor, LocoDirection::set(LOCO_A, DIR_FORWARD)));
+    TEST_ASSERT_TRUE(hold(supervisor, LocoDirection::set(LOCO_A, DIR_REVERSE)));
+    TEST_ASSERT_EQUAL(3, supervisor.getHeld());
+
+    TEST_ASSERT_EQUAL(3, supervisor.release(bus));
+    TEST_ASSERT_EQUAL(LOCO_B, TrackCommand::address(bus.sent[0]));
+    TEST_ASSERT_EQUAL(300, LocoSpeed::speed(bus.sent[1]));
+    TEST_ASSERT_EQUAL(DIR_REVERSE, LocoDirection::direction(bus.sent[2]));
+}
+
+void test_query_dropped()
+{
+    TrackSupervisor supervisor;
+
+    TEST_ASSERT_FALSE(hold(supervisor, LocoSpeed::get(LOCO_A)));
+    TEST_ASSERT_EQUAL(0, supervisor.getHeld());
+    TEST_ASSERT_EQUAL(1, supervisor.getDropped());
+}
+
+void test_toggle_not_held()
+{
+    TrackSupervisor supervisor;
+
+    TEST_ASSERT_TRUE(hold(supervisor, LocoDirection::set(LOCO_A, DIR_FORWARD)));
+    TEST_ASSERT_FALSE(hold(supervisor, LocoDirection::set(LOCO_A, DIR_CHANGE)));
+    TEST_ASSERT_FALSE(hold(supervisor, LocoDirection::set(LOCO_A, DIR_CHANGE)));
+    TEST_ASSERT_EQUAL(1, supervisor.getHeld());
+    TEST_ASSERT_EQUAL(2, supervisor.getDropped());
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_newer_frame_replaces_older);
+    RUN_TEST(test_query_dropped);
+    RUN_TEST(test_toggle_not_held);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Railuino - Hacking your Märklin
+ *
+ * Copyright (C) 2012 Joerg Pleumann
+ * Copyright (C) 2024 christophe bobille
+ *
+ * This example is free software; you can redistribute it and/or
+ * modify it under the terms of the Creative Commons Zero License,
+ * version 1.0, as published by the Creative Commons Organisation.
+ * This effectively puts the file into the public domain.
+ *
+ * This example is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * LICENSE file for more details.
+ */
+
+/*
+   The text protocol parser, in its current form and in the old
+   fixed-offset form of function and accessory, which existing
+   scripts still send.
+*/
+
+#include <unity.h>
+#include "TrackUserCommand.h"
+
+static uint8_t parse(const char *text, TrackUserCommand &command)
+{
+    return TrackUserCommandParser::parse(text, strlen(text), command);
+}
+
+/* -------------------------------------------------------------------
+   Tests
+-------------------------------------------------------------------  */
+
+void test_current_form()
+{
+    TrackUserCommand command;
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("speed 0x4007 500", command));
+    TEST_ASSERT_EQUAL(USER_SPEED, command.type);
+    TEST_ASSERT_EQUAL(0x4007, command.args[0]);
+    TEST_ASSERT_EQUAL(500, command.args[1]);
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("function 16391 12 1", command));
+    TEST_ASSERT_EQUAL(12, command.args[1]);
+    TEST_ASSERT_EQUAL(1, command.args[2]);
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("accessory 12289 1 1 20", command));
+    TEST_ASSERT_EQUAL(4, command.argc);
+    TEST_ASSERT_EQUAL(1, command.args[1]);
+    TEST_ASSERT_EQUAL(1, command.args[2]);
+    TEST_ASSERT_EQUAL(20, command.args[3]);
+}
+
+void test_old_form()
+{
+    TrackUserCommand command;
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("accessory 12289 11 20", command));
+    TEST_ASSERT_EQUAL(USER_ACCESSORY, command.type);
+    TEST_ASSERT_EQUAL(4, command.argc);
+    TEST_ASSERT_EQUAL(12289, command.args[0]);
+    TEST_ASSERT_EQUAL(1, command.args[1]);
+    TEST_ASSERT_EQUAL(1, command.args[2]);
+    TEST_ASSERT_EQUAL(20, command.args[3]);
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("accessory 12289 01", command));
+    TEST_ASSERT_EQUAL(0, command.args[1]);
+    TEST_ASSERT_EQUAL(1, command.args[2]);
+    TEST_ASSERT_EQUAL(0, command.args[3]);
+
+    TEST_ASSERT_EQUAL(PARSE_OK, parse("function 16391 01", command));
+    TEST_ASSERT_EQUAL(USER_FUNCTION, command.type);
+    TEST_ASSERT_EQUAL(0, command.args[1]);
+    TEST_ASSERT_EQUAL(1, command.args[2]);
+}
+
+void test_errors()
+{
+    TrackUserCommand command;
+
+    TEST_ASSERT_EQUAL(PARSE_RANGE, parse("accessory 12289 41 20", command));
+    TEST_ASSERT_EQUAL(PARSE_RANGE, parse("accessory 12289 12 1 20", command));
+    TEST_ASSERT_EQUAL(PARSE_MISSING_ARG, parse("function 16391 1", command));
+    TEST_ASSERT_EQUAL(PARSE_TOO_MANY, parse("speed 16391 500 1", command));
+    TEST_ASSERT_EQUAL(PARSE_UNKNOWN, parse("turbo 16391", command));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_current_form);
+    RUN_TEST(test_old_form);
+    RUN_TEST(test_errors);
+    return UNITY_END();
+}
@@ -0,0 +1,63 @@
+# Railuino - Hacking your Märklin
+#
+# PlatformIO extra script that reports the static RAM and flash used
+# by each symbol of the firmware, as part of the build. The largest
+# symbols are printed after linking and the full list is written to
+# footprint.txt in the build directory. Enable it with
+#
+#   extra_scripts = post:tools/footprint.py
+
+import os
+import subprocess
+
+Import("env")
+
+RAM_TYPES = "bBdD"       # .bss, .data
+FLASH_TYPES = "tTrRdDW"  # Code, constants, initial values of .data
+TOP = 15
+
+
+def read_symbols(elf):
+    nm = env.subst("$CC").replace("gcc", "nm")
+    output = subprocess.check_output(
+        [nm, "--print-size", "--size-sort", "--demangle", "--radix=d", elf],
+        env=env["ENV"]).decode(errors="replace")
+
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4:
+            size, kind, name = int(fields[1]), fields[2], fields[3]
+            ram = size if kind in RAM_TYPES else 0
+            flash = size if kind in FLASH_TYPES else 0
+            if ram or flash:
+                symbols.append((ram, flash, kind, name))
+    return symbols
+
+
+def print_top(title, symbols, column):
+    print("%s, largest %d:" % (title, TOP))
+    for symbol in sorted(symbols, key=lambda s: -s[column])[:TOP]:
+        if symbol[column]:
+            print("  %6d  %s" % (symbol[column], symbol[3]))
+
+
+def footprint(source, target, env):
+    elf = str(target[0])
+    symbols = read_symbols(elf)
+    report = os.path.join(env.subst("$BUILD_DIR"), "footprint.txt")
+
+    with open(report, "w") as out:
+        out.write("%6s %6s %s %s\n" % ("RAM", "FLASH", "T", "SYMBOL"))
+        for ram, flash, kind, name in sorted(symbols, key=lambda s: (-s[0], -s[1])):
+            out.write("%6d %6d %s %s\n" % (ram, flash, kind, name))
+
+    print("")
+    print("Footprint: %d bytes of static RAM, %d bytes of flash in symbols" % (
+        sum(s[0] for s in symbols), sum(s[1] for s in symbols)))
+    print_top("RAM", symbols, 0)
+    print_top("Flash", symbols, 1)
+    print("Full list in %s" % report)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", footprint)
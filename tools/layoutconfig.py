@@ -0,0 +1,141 @@
+# Railuino - Hacking your Märklin
+#
+# Compiles a layout configuration written in JSON into the binary
+# table read by TrackConfig, so the board never parses text. Upload
+# the result to SPIFFS as /config.bin with the other files in data/.
+#
+#   python tools/layoutconfig.py layout.json data/config.bin
+#   python tools/layoutconfig.py --dump data/config.bin
+#
+# Addresses are numbers or strings such as "0x4007". Blocks are named
+# and edges refer to them by name:
+#
+#   {
+#     "hash": "0xDF24", "timeout": 1000,
+#     "locos": [{"address": 16391, "name": "BR 89"}],
+#     "accessories": [{"address": "0x3000", "name": "W1"}],
+#     "steps": [{"base": "0xC000", "steps": 28}],
+#     "consists": [{"consist": 0, "address": 16391, "inverted": false, "trim": 100}],
+#     "layout": {
+#       "blocks": [{"name": "A", "contact": 1}, {"name": "B", "contact": 2}],
+#       "edges": [{"from": "A", "to": "B", "cost": 10, "set": [["0x3000", 1]]}]
+#     }
+#   }
+#
+# Every key is optional. Keep it in step with src/TrackConfig.h.
+
+import argparse
+import json
+import struct
+import sys
+
+VERSION = 1
+LAYOUT_VERSION = 1
+NAME_SIZE = 12
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def number(value):
+    return int(value, 0) if isinstance(value, str) else int(value)
+
+
+def entries(items):
+    out = bytearray()
+    for item in items:
+        name = item.get("name", "").encode("ascii")
+        if len(name) > NAME_SIZE:
+            sys.exit("name too long, at most %d characters: %s" % (NAME_SIZE, item["name"]))
+        out += struct.pack(">H", number(item["address"])) + name.ljust(NAME_SIZE, b"\x00")
+    return bytes(out)
+
+
+def layout(graph):
+    blocks = graph.get("blocks", [])
+    names = {block.get("name", str(index)): index for index, block in enumerate(blocks)}
+
+    def block(ref):
+        return names[ref] if isinstance(ref, str) else int(ref)
+
+    out = bytearray(b"LG" + bytes([LAYOUT_VERSION, len(blocks), len(graph.get("edges", []))]))
+    for item in blocks:
+        out += struct.pack(">H", number(item.get("contact", 0)))
+    for edge in graph.get("edges", []):
+        settings = [(number(a), int(p)) for a, p in edge.get("set", [])]
+        if len(settings) > 2:
+            sys.exit("at most 2 accessories per edge: %s -> %s" % (edge["from"], edge["to"]))
+        out += bytes([block(edge["from"]), block(edge["to"]), int(edge.get("cost", 1))])
+        for address, position in (settings + [(0, 0)] * 2)[:2]:
+            out += struct.pack(">HB", address, position)
+    return bytes(out)
+
+
+def compile_config(config):
+    sections = []
+    if "hash" in config or "timeout" in config:
+        sections.append((b"H", struct.pack(">HH", number(config.get("hash", 0)), int(config.get("timeout", 0)))))
+    if "locos" in config:
+        sections.append((b"L", entries(config["locos"])))
+    if "accessories" in config:
+        sections.append((b"A", entries(config["accessories"])))
+    if "steps" in config:
+        sections.append((b"S", b"".join(struct.pack(">HB", number(s["base"]), int(s["steps"]))
+                                        for s in config["steps"])))
+    if "consists" in config:
+        sections.append((b"C", b"".join(struct.pack(">BHBB", int(m["consist"]), number(m["address"]),
+                                                    1 if m.get("inverted") else 0, int(m.get("trim", 100)))
+                                        for m in config["consists"])))
+    if "layout" in config:
+        sections.append((b"G", layout(config["layout"])))
+
+    table = bytearray(b"RC" + bytes([VERSION, len(sections)]))
+    for kind, payload in sections:
+        table += kind + struct.pack(">H", len(payload)) + payload
+    return bytes(table + struct.pack(">H", crc16(table)))
+
+
+def dump(table):
+    if table[:2] != b"RC" or table[2] != VERSION or crc16(table[:-2]) != struct.unpack(">H", table[-2:])[0]:
+        sys.exit("not a valid configuration table")
+    offset = 4
+    for _ in range(table[3]):
+        kind, length = chr(table[offset]), struct.unpack(">H", table[offset + 1:offset + 3])[0]
+        payload = table[offset + 3:offset + 3 + length]
+        offset += 3 + length
+        if kind in "LA":
+            for i in range(0, length, 2 + NAME_SIZE):
+                address = struct.unpack(">H", payload[i:i + 2])[0]
+                print("%s 0x%04x %s" % (kind, address, payload[i + 2:i + 2 + NAME_SIZE].rstrip(b"\x00").decode()))
+        else:
+            print("%s %d bytes: %s" % (kind, length, payload.hex()))
+    print("%d bytes, version %d" % (len(table), table[2]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile a layout configuration for TrackConfig")
+    parser.add_argument("source", help="JSON configuration, or the table with --dump")
+    parser.add_argument("output", nargs="?", default="data/config.bin")
+    parser.add_argument("--dump", action="store_true", help="print a compiled table")
+    args = parser.parse_args()
+
+    if args.dump:
+        with open(args.source, "rb") as f:
+            dump(f.read())
+        return
+
+    with open(args.source) as f:
+        table = compile_config(json.load(f))
+    with open(args.output, "wb") as f:
+        f.write(table)
+    print("%s: %d bytes" % (args.output, len(table)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+# Railuino - Hacking your Märklin
+#
+# PC side of TrackSerialLink: shows the CAN frames a board running
+# examples/03.Tools/SerialLink sends over USB, and sends frames given
+# on the command line. Each packet is a 13 byte frame (identifier,
+# length, 8 data bytes) and its CRC-16/CCITT, COBS encoded and ended
+# by a zero byte. Needs pyserial.
+#
+#   python tools/seriallink.py /dev/ttyUSB0
+#   python tools/seriallink.py /dev/ttyUSB0 --send "0008df24 6 00 00 40 05 01 2c"
+
+import argparse
+import struct
+import sys
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out, block = bytearray(), bytearray()
+    for byte in data:
+        if byte == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(byte)
+    return bytes(out + bytes([len(block) + 1]) + block + b"\x00")
+
+
+def cobs_decode(data):
+    out, i = bytearray(), 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def pack(can_id, payload):
+    frame = struct.pack(">IB", can_id & 0x1FFFFFFF, len(payload)) + bytes(payload).ljust(8, b"\x00")
+    return cobs_encode(frame + struct.pack(">H", crc16(frame)))
+
+
+def unpack(packet):
+    data = cobs_decode(packet)
+    if data is None or len(data) != 15 or crc16(data[:13]) != struct.unpack(">H", data[13:])[0]:
+        return None
+    can_id, length = struct.unpack(">IB", data[:5])
+    return can_id, data[5:5 + min(length, 8)]
+
+
+def describe(can_id, payload):
+    command = (can_id >> 17) & 0xFF
+    response = "R" if can_id & 0x10000 else " "
+    return "%04x %s %02x %d %s" % (can_id & 0xFFFF, response, command, len(payload),
+                                    " ".join("%02x" % b for b in payload))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Talk to a TrackSerialLink")
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=921600)
+    parser.add_argument("--send", action="append", default=[],
+                        help='frame as "<id hex> <length> <data hex>..."')
+    args = parser.parse_args()
+
+    import serial  # Only needed when talking to a board
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+
+    for text in args.send:
+        fields = text.split()
+        port.write(pack(int(fields[0], 16), [int(b, 16) for b in fields[2:2 + int(fields[1])]]))
+
+    buffer, errors = bytearray(), 0
+    try:
+        while True:
+            buffer += port.read(port.in_waiting or 1)
+            while b"\x00" in buffer:
+                packet, _, buffer = buffer.partition(b"\x00")
+                if not packet:
+                    continue
+                frame = unpack(bytes(packet))
+                if frame is None:
+                    errors += 1  # Boot messages or a damaged packet
+                    continue
+                print(describe(*frame))
+    except KeyboardInterrupt:
+        print("%d packets skipped" % errors, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()